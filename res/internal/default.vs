@@ -1,10 +1,24 @@
 #version 420 core
 
 layout(location = 0) in vec3 a_VertPos;
+// Per-instance model matrix, occupies locations 3 to 6
+layout(location = 3) in mat4 a_InstanceMatrix;
 
-uniform mat4 u_MVP = mat4(1.0);
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec3 u_ViewPos;
+    float u_Time;
+};
+layout(std140, binding = 1) uniform ObjectData
+{
+    mat4 u_ModelMatrix;
+    mat4 u_MVP;
+};
 
 void main()
 {
-    gl_Position = u_MVP * vec4(a_VertPos, 1.0);
+    gl_Position = u_MVP * a_InstanceMatrix * vec4(a_VertPos, 1.0);
 }
\ No newline at end of file
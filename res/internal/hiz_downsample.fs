@@ -0,0 +1,18 @@
+#version 420 core
+
+// The level above the one being written. It's bound as the texture's only level,
+// so level 0 of the fetches below is always the level above
+uniform sampler2D u_Depth;
+
+// Writes the furthest depth of the 2x2 texels above, so that every texel of the pyramid
+// holds the furthest depth of the whole area it covers
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy) * 2;
+    float depth0 = texelFetch(u_Depth, coord, 0).r;
+    float depth1 = texelFetch(u_Depth, coord + ivec2(1, 0), 0).r;
+    float depth2 = texelFetch(u_Depth, coord + ivec2(0, 1), 0).r;
+    float depth3 = texelFetch(u_Depth, coord + ivec2(1, 1), 0).r;
+
+    gl_FragDepth = max(max(depth0, depth1), max(depth2, depth3));
+}
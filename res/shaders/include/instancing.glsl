@@ -0,0 +1,11 @@
+#include "uniform_blocks.glsl"
+
+// Model matrix of the instance being drawn, filled in by the Renderer.
+// A mat4 attribute takes up 4 locations, so this occupies locations 3 to 6
+layout(location = 3) in mat4 a_InstanceMatrix;
+
+// The scene's model matrix is applied on top of the instance's own transform
+mat4 GetModelMatrix()
+{
+    return u_ModelMatrix * a_InstanceMatrix;
+}
@@ -0,0 +1,30 @@
+#include "uniform_blocks.glsl"
+
+const float AMBIENT_LIGHT_STRENGTH = 0.1;
+const float SPECULAR_STRENGTH = 0.5;
+
+uniform vec3 u_LightPos = vec3(1.2, 1.0, 2.0);
+uniform vec4 u_LightColor = vec4(1.0);
+
+// Returns the ambient, diffuse and specular light of a single point light added together
+vec4 CalculatePhongLighting(vec3 fragPos, vec3 normal)
+{
+    // Ambient light
+    vec4 ambientLight = u_LightColor * AMBIENT_LIGHT_STRENGTH;
+    
+    // Calculate diffuse light
+    normal = normalize(normal);
+    vec3 lightDir = normalize(u_LightPos - fragPos);
+
+    float diffuseImpact = max(dot(normal, lightDir), 0.0);
+    vec4 diffuseLight = u_LightColor * diffuseImpact;
+
+    // Calculate specular light
+    vec3 viewDir = normalize(u_ViewPos - fragPos);
+    vec3 reflectDir = reflect(-lightDir, normal);
+
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
+    vec4 specularLight = spec * u_LightColor * SPECULAR_STRENGTH;
+
+    return ambientLight + diffuseLight + specularLight;
+}
@@ -0,0 +1,14 @@
+// Uniform blocks filled in by the Renderer, shared by every shader
+layout(std140, binding = 0) uniform FrameData
+{
+    mat4 u_View;
+    mat4 u_Projection;
+    mat4 u_ViewProjection;
+    vec3 u_ViewPos;
+    float u_Time;
+};
+layout(std140, binding = 1) uniform ObjectData
+{
+    mat4 u_ModelMatrix;
+    mat4 u_MVP;
+};
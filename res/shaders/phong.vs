@@ -1,18 +1,27 @@
 #version 420 core
 
+#pragma variant TEXTURED
+
+#include "include/instancing.glsl"
+
 layout(location = 0) in vec3 a_Pos;
+layout(location = 1) in vec2 a_UV;
 layout(location = 2) in vec3 a_Normal;
 
 out vec3 o_FragPos;
 out vec3 o_Normal;
-
-uniform mat4 u_ModelMatrix = mat4(1.0);
-uniform mat4 u_MVP = mat4(1.0);
+#ifdef TEXTURED
+out vec2 o_UV;
+#endif
 
 void main()
 {    
-    gl_Position = u_MVP * vec4(a_Pos, 1.0);
+    mat4 modelMatrix = GetModelMatrix();
+    gl_Position = u_ViewProjection * modelMatrix * vec4(a_Pos, 1.0);
     
-    o_FragPos = vec3(u_ModelMatrix * vec4(a_Pos, 1.0));
-    o_Normal = mat3(transpose(inverse(u_ModelMatrix))) * a_Normal;
+    o_FragPos = vec3(modelMatrix * vec4(a_Pos, 1.0));
+    o_Normal = mat3(transpose(inverse(modelMatrix))) * a_Normal;
+#ifdef TEXTURED
+    o_UV = a_UV;
+#endif
 }
\ No newline at end of file
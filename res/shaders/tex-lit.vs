@@ -1,5 +1,7 @@
 #version 420 core
 
+#include "include/instancing.glsl"
+
 layout(location = 0) in vec3 a_Pos;
 layout(location = 1) in vec2 a_UV;
 layout(location = 2) in vec3 a_Normal;
@@ -8,14 +10,12 @@ out vec3 o_FragPos;
 out vec2 o_UV;
 out vec3 o_Normal;
 
-uniform mat4 u_ModelMatrix = mat4(1.0);
-uniform mat4 u_MVP = mat4(1.0);
-
 void main()
 {    
-    gl_Position = u_MVP * vec4(a_Pos, 1.0);
+    mat4 modelMatrix = GetModelMatrix();
+    gl_Position = u_ViewProjection * modelMatrix * vec4(a_Pos, 1.0);
     
-    o_FragPos = vec3(u_ModelMatrix * vec4(a_Pos, 1.0));
-    o_Normal = mat3(transpose(inverse(u_ModelMatrix))) * a_Normal;
+    o_FragPos = vec3(modelMatrix * vec4(a_Pos, 1.0));
+    o_Normal = mat3(transpose(inverse(modelMatrix))) * a_Normal;
     o_UV = a_UV;
 }
\ No newline at end of file
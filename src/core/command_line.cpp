@@ -0,0 +1,207 @@
+#include "command_line.hpp"
+
+#include "core/log.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+bool CommandLine::Parse(int argc, char **argv, CommandLineOptions &options)
+{
+    for(int i = 1; i < argc; i++)
+    {
+        const char *argument = argv[i];
+
+        // Fetches the value following the current argument, the flags below all take exactly one
+        auto nextValue = [&](const char *&value)
+        {
+            if(i + 1 >= argc)
+            {
+                Log::LogError(std::string("Missing value after ") + argument);
+                return false;
+            }
+            value = argv[++i];
+            return true;
+        };
+        auto nextUnsigned = [&](unsigned int &value)
+        {
+            const char *text = nullptr;
+            if(!nextValue(text))
+                return false;
+
+            char *end = nullptr;
+            long number = strtol(text, &end, 10);
+            if(end == text || *end != '\0' || number <= 0)
+            {
+                Log::LogError(std::string("Expected a positive number after ") + argument + ", got '" + text + "'");
+                return false;
+            }
+            value = (unsigned int)number;
+            return true;
+        };
+
+        const char *value = nullptr;
+        if(strcmp(argument, "-h") == 0 || strcmp(argument, "--help") == 0)
+        {
+            options.showHelp = true;
+        }
+        else if(strcmp(argument, "--headless") == 0)
+        {
+            options.headless = true;
+        }
+        else if(strcmp(argument, "--model") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            options.modelPath = value;
+        }
+        else if(strcmp(argument, "--shader") == 0)
+        {
+            // Both stages are given one after the other
+            if(!nextValue(value))
+                return false;
+            options.vertShaderPath = value;
+            if(!nextValue(value))
+                return false;
+            options.fragShaderPath = value;
+        }
+        else if(strcmp(argument, "--output") == 0 || strcmp(argument, "-o") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            options.outputPath = value;
+        }
+        else if(strcmp(argument, "--width") == 0)
+        {
+            if(!nextUnsigned(options.width))
+                return false;
+        }
+        else if(strcmp(argument, "--height") == 0)
+        {
+            if(!nextUnsigned(options.height))
+                return false;
+        }
+        else if(strcmp(argument, "--frames") == 0)
+        {
+            if(!nextUnsigned(options.frames))
+                return false;
+        }
+        else if(strcmp(argument, "--software") == 0)
+        {
+            options.software = true;
+        }
+        else if(strcmp(argument, "--batch") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            options.batchInputs.push_back(value);
+            options.headless = true;
+        }
+        else if(strcmp(argument, "--output-dir") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            options.outputDirectory = value;
+        }
+        else if(strcmp(argument, "--sizes") == 0)
+        {
+            // Comma separated, e.g. 64,256,512
+            if(!nextValue(value))
+                return false;
+            options.thumbnailSizes.clear();
+            const char *text = value;
+            while(*text != '\0')
+            {
+                char *end = nullptr;
+                long number = strtol(text, &end, 10);
+                if(end == text || (*end != ',' && *end != '\0') || number <= 0)
+                {
+                    Log::LogError(std::string("Expected a comma separated list of positive numbers after --sizes, got '") + value + "'");
+                    return false;
+                }
+                options.thumbnailSizes.push_back((unsigned int)number);
+                text = *end == ',' ? end + 1 : end;
+            }
+            if(options.thumbnailSizes.empty())
+            {
+                Log::LogError("--sizes needs at least one size");
+                return false;
+            }
+        }
+        else if(strcmp(argument, "--threads") == 0)
+        {
+            if(!nextUnsigned(options.threads))
+                return false;
+        }
+        else if(strcmp(argument, "--turntable") == 0)
+        {
+            if(!nextUnsigned(options.turntableFrames))
+                return false;
+            options.headless = true;
+        }
+        else if(strcmp(argument, "--turntable-step") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            char *end = nullptr;
+            options.turntableStep = strtof(value, &end);
+            if(end == value || *end != '\0')
+            {
+                Log::LogError(std::string("Expected a number of degrees after --turntable-step, got '") + value + "'");
+                return false;
+            }
+        }
+        else if(strcmp(argument, "--continuous") == 0)
+        {
+            options.continuous = true;
+        }
+        else if(strcmp(argument, "--max-fps") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            char *end = nullptr;
+            options.maxFPS = strtof(value, &end);
+            if(end == value || *end != '\0' || options.maxFPS < 0.0f)
+            {
+                Log::LogError(std::string("Expected a frame rate (0 for uncapped) after --max-fps, got '") + value + "'");
+                return false;
+            }
+        }
+        else if(strcmp(argument, "--trace") == 0)
+        {
+            if(!nextValue(value))
+                return false;
+            options.tracePath = value;
+        }
+        else
+        {
+            Log::LogError(std::string("Unknown argument '") + argument + "'");
+            return false;
+        }
+    }
+    return true;
+}
+
+void CommandLine::PrintUsage(const char *programName)
+{
+    printf("Usage: %s [options]\n", programName);
+    printf("  -h, --help              Show this message\n");
+    printf("  --headless              Render offscreen without a window and write the frame into an image\n");
+    printf("  --model <path>          OBJ file to render, the built in cube if left out\n");
+    printf("  --shader <vert> <frag>  Shader to render the model with, the default shader if left out\n");
+    printf("  -o, --output <path>     Where the headless render is written to (PNG), render.png by default\n");
+    printf("  --width <pixels>        Width of the headless render\n");
+    printf("  --height <pixels>       Height of the headless render\n");
+    printf("  --frames <count>        Frames drawn before the headless render is read back\n");
+    printf("  --software              Rasterize on the CPU, headless renders fall back to it entirely when no GL context can be created\n");
+    printf("  --batch <dir|list>      Render thumbnails of every OBJ in a directory or list file (one path per line), can be repeated\n");
+    printf("  --output-dir <path>     Where the thumbnails are written to, thumbnails/ by default\n");
+    printf("  --sizes <a,b,...>       Thumbnail sizes in pixels, 256 by default\n");
+    printf("  --threads <count>       Worker threads of the batch and the turntable writers, picked from the core count by default\n");
+    printf("  --turntable <frames>    Render frames circling the model, written as a numbered PNG sequence based on --output\n");
+    printf("                          (e.g. spin_%%04d.png), or as raw RGBA frames to stdout with --output -\n");
+    printf("  --turntable-step <deg>  Degrees per turntable frame, a full turn over all frames by default\n");
+    printf("  --continuous            Redraw the window every frame, by default it's only redrawn when something changed\n");
+    printf("  --max-fps <fps>         Frame rate cap of the window, 60 by default, 0 for uncapped\n");
+    printf("  --trace <path>          Write the CPU profiler's zones as a Chrome trace (JSON) on exit\n");
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Everything the application can be told from the command line
+struct CommandLineOptions
+{
+    bool showHelp = false;
+
+    // Renders without a window, UI or file dialogs and writes the result into an image
+    bool headless = false;
+    // Left empty to use the built in cube and the default shader
+    std::string modelPath;
+    std::string vertShaderPath;
+    std::string fragShaderPath;
+    std::string outputPath = "render.png";
+    unsigned int width = 1270;
+    unsigned int height = 720;
+    // Frames drawn before the image is read back, more frames give streamed textures and occlusion data time to settle
+    unsigned int frames = 1;
+    // Rasterize on the CPU instead of the GPU
+    bool software = false;
+
+    // Directories (searched recursively) and list files of models to render thumbnails of, implies headless
+    std::vector<std::string> batchInputs;
+    std::string outputDirectory = "thumbnails";
+    // Every model gets one square PNG per size
+    std::vector<unsigned int> thumbnailSizes = { 256 };
+    // Threads for both parsing and encoding in batch mode and for writing turntable frames, 0 picks based on the core count
+    unsigned int threads = 0;
+
+    // Frames of a turntable around the model, 0 renders a single image. Implies headless
+    unsigned int turntableFrames = 0;
+    // Degrees the camera moves per frame, 0 spreads a full turn over all of the frames
+    float turntableStep = 0.0f;
+
+    // Redraw the window every frame instead of only when something changed
+    bool continuous = false;
+    // Frame rate cap of the window, 0 leaves it uncapped
+    float maxFPS = 60.0f;
+
+    // Where the CPU trace gets written on exit, nowhere if left empty
+    std::string tracePath;
+};
+
+class CommandLine
+{
+    public:
+    // Returns false (after logging why) if the arguments couldn't be parsed
+    static bool Parse(int argc, char **argv, CommandLineOptions &options);
+    static void PrintUsage(const char *programName);
+};
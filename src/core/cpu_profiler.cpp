@@ -0,0 +1,133 @@
+#include "cpu_profiler.hpp"
+
+#include "log.hpp"
+
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+// Zone names are string literals, but thread names can come from anywhere
+static std::string EscapeJSON(const std::string &text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for(char c: text)
+    {
+        if(c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if((unsigned char)c < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", (unsigned int)c);
+            escaped += code;
+        }
+        else
+            escaped += c;
+    }
+    return escaped;
+}
+
+void CPUProfiler::SetThreadName(const std::string &name)
+{
+    ThreadBuffer &buffer = GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(_mutex);
+    buffer.name = name;
+}
+
+void CPUProfiler::RecordZone(const char *name, int64_t start, int64_t end)
+{
+    ThreadBuffer &buffer = GetThreadBuffer();
+
+    // Only this thread ever writes to the buffer. Releasing the slot's values keeps the previous count ahead of them,
+    // so a WriteChromeTrace that sees any of them also sees a count telling it the slot is being overwritten.
+    // Releasing the count makes the event visible before the count that includes it
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    ZoneSlot &slot = buffer.events[index % EVENTS_PER_THREAD];
+    slot.name.store(name, std::memory_order_release);
+    slot.start.store(start, std::memory_order_release);
+    slot.end.store(end, std::memory_order_release);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+bool CPUProfiler::WriteChromeTrace(const std::string &path)
+{
+    std::ofstream file(path);
+    if(!file)
+    {
+        Log::LogError("Couldn't open '" + path + "' for the CPU trace");
+        return false;
+    }
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    size_t eventCount = 0;
+    std::vector<ZoneEvent> events;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(const std::unique_ptr<ThreadBuffer> &buffer: _threads)
+    {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+            << ",\"args\":{\"name\":\"" << EscapeJSON(buffer->name) << "\"}}";
+        first = false;
+
+        // The thread keeps recording while its ring gets copied. Whatever it could have overwritten
+        // in the meantime is dropped afterwards, rather than ending up in the trace half written
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t begin = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+        events.clear();
+        for(uint64_t i = begin; i < written; i++)
+        {
+            const ZoneSlot &slot = buffer->events[i % EVENTS_PER_THREAD];
+            ZoneEvent event;
+            event.name = slot.name.load(std::memory_order_acquire);
+            event.start = slot.start.load(std::memory_order_acquire);
+            event.end = slot.end.load(std::memory_order_acquire);
+            events.push_back(event);
+        }
+
+        // Acquiring the slots' values makes this count at least as new as any of them. The thread can be in the middle of
+        // writing the event after the count, into the slot of the oldest event still counted,
+        // so everything before writtenAfter + 1 - EVENTS_PER_THREAD may have been overwritten
+        uint64_t writtenAfter = buffer->written.load(std::memory_order_acquire);
+        uint64_t overwritten = writtenAfter + 1 > EVENTS_PER_THREAD ? writtenAfter + 1 - EVENTS_PER_THREAD : 0;
+        size_t skip = (size_t)std::min<uint64_t>(overwritten > begin ? overwritten - begin : 0, events.size());
+
+        char line[64];
+        for(size_t i = skip; i < events.size(); i++)
+        {
+            const ZoneEvent &event = events[i];
+            // Microseconds, the nanoseconds stay as decimals
+            snprintf(line, sizeof(line), ",\"ts\":%.3f,\"dur\":%.3f}", event.start / 1000.0, (event.end - event.start) / 1000.0);
+            file << ",\n{\"name\":\"" << EscapeJSON(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id << line;
+            eventCount++;
+        }
+    }
+    file << "\n]}\n";
+
+    if(!file)
+    {
+        Log::LogError("Failed writing the CPU trace to '" + path + "'");
+        return false;
+    }
+    Log::LogInfo("Wrote " + std::to_string(eventCount) + " zones of " + std::to_string(_threads.size()) + " threads to '" + path + "'");
+    return true;
+}
+
+CPUProfiler::ThreadBuffer &CPUProfiler::GetThreadBuffer()
+{
+    if(_threadBuffer == nullptr)
+    {
+        std::unique_ptr<ThreadBuffer> buffer = std::make_unique<ThreadBuffer>();
+        buffer->events = std::make_unique<ZoneSlot[]>(EVENTS_PER_THREAD);
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        buffer->id = (unsigned int)_threads.size() + 1;
+        buffer->name = "Thread " + std::to_string(buffer->id);
+        _threadBuffer = buffer.get();
+        _threads.push_back(std::move(buffer));
+    }
+    return *_threadBuffer;
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "misc/singleton.hpp"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Times the code from here to the end of the enclosing block on the calling thread, see CPUProfiler.
+// The name has to be a string literal, only the pointer gets stored. Defining CPU_PROFILER_DISABLED compiles every zone out
+#ifdef CPU_PROFILER_DISABLED
+    #define PROFILE_ZONE(name) ((void)0)
+#else
+    #define PROFILE_ZONE(name) CPUProfileZone PROFILE_ZONE_CONCAT(_profileZone, __LINE__)(name)
+#endif
+#define PROFILE_ZONE_CONCAT(a, b) PROFILE_ZONE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE_CONCAT_INNER(a, b) a##b
+
+// Records where the CPU time goes, for finding what makes loading slow or a frame hitch without attaching a profiler.
+// Every thread writes its zones into a ring buffer of its own, so recording a zone takes two clock reads and no locking.
+// Once a ring is full the oldest zones get overwritten, so a trace always holds the last stretch of time of every thread.
+// The trace can be written out at any time in Chrome's trace event format (chrome://tracing, ui.perfetto.dev)
+class CPUProfiler final : public Singleton<CPUProfiler>
+{
+    friend class Singleton<CPUProfiler>;
+
+    public:
+    // About a minute of the main thread at 60 fps, 1.5 MB per thread
+    static constexpr size_t EVENTS_PER_THREAD = 65536;
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    struct ZoneEvent
+    {
+        const char *name = nullptr;
+        // Nanoseconds since the profiler was created
+        int64_t start = 0;
+        int64_t end = 0;
+    };
+    // A ZoneEvent in the ring. WriteChromeTrace reads the slots while their thread may be overwriting them,
+    // atomics make that a well defined race, and on x86 they cost the same as plain stores
+    struct ZoneSlot
+    {
+        std::atomic<const char*> name = nullptr;
+        std::atomic<int64_t> start = 0;
+        std::atomic<int64_t> end = 0;
+    };
+    struct ThreadBuffer
+    {
+        // Guarded by the profiler's mutex, the events aren't
+        std::string name;
+        unsigned int id = 0;
+        std::unique_ptr<ZoneSlot[]> events;
+        // Zones ever recorded, the ring index is this modulo EVENTS_PER_THREAD
+        std::atomic<uint64_t> written = 0;
+    };
+
+    std::atomic<bool> _enabled = true;
+    Clock::time_point _epoch = Clock::now();
+
+    std::mutex _mutex;
+    // Outlive their threads, so the zones of a finished worker still end up in the trace
+    std::vector<std::unique_ptr<ThreadBuffer>> _threads;
+    inline static thread_local ThreadBuffer *_threadBuffer = nullptr;
+
+    private:
+    CPUProfiler() = default;
+    ~CPUProfiler() = default;
+
+    public:
+    // Zones started while disabled aren't recorded, the ones already recorded are kept
+    inline void SetEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+    inline bool isEnabled() const { return _enabled.load(std::memory_order_relaxed); }
+
+    // Shows up as the thread's name in the trace, threads without one are numbered in the order they recorded their first zone
+    void SetThreadName(const std::string &name);
+
+    inline int64_t Now() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _epoch).count(); }
+    void RecordZone(const char *name, int64_t start, int64_t end);
+
+    // Can be called while the other threads keep recording. Returns false if the file couldn't be written
+    bool WriteChromeTrace(const std::string &path);
+
+    private:
+    ThreadBuffer &GetThreadBuffer();
+};
+
+// Records a zone from its construction to its destruction, use PROFILE_ZONE
+class CPUProfileZone
+{
+    private:
+    const char *_name;
+    // Negative if the profiler was disabled when the zone started
+    int64_t _start;
+
+    public:
+    explicit CPUProfileZone(const char *name)
+        : _name(name), _start(CPUProfiler::getInstance().isEnabled() ? CPUProfiler::getInstance().Now() : -1)
+    {
+    }
+    ~CPUProfileZone()
+    {
+        if(_start >= 0)
+            CPUProfiler::getInstance().RecordZone(_name, _start, CPUProfiler::getInstance().Now());
+    }
+    CPUProfileZone(const CPUProfileZone &other) = delete;
+    CPUProfileZone &operator=(const CPUProfileZone &other) = delete;
+};
@@ -0,0 +1,141 @@
+#include "file_watcher.hpp"
+
+#include "log.hpp"
+
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+void FileWatcher::Start()
+{
+    #ifdef __linux__
+    if(_running)
+        return;
+
+    _inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(_inotifyFD == -1)
+    {
+        Log::LogWarning("Couldn't initialize inotify, file watching disabled");
+        return;
+    }
+
+    _running = true;
+    _thread = std::thread(&FileWatcher::WatchLoop, this);
+    #endif
+}
+void FileWatcher::Stop()
+{
+    #ifdef __linux__
+    if(!_running)
+        return;
+
+    _running = false;
+    if(_thread.joinable())
+        _thread.join();
+
+    close(_inotifyFD);
+    _inotifyFD = -1;
+    _watchedDirectories.clear();
+    #endif
+}
+
+void FileWatcher::Watch(const std::string &path)
+{
+    #ifdef __linux__
+    if(!_running)
+        return;
+
+    std::string directory = std::filesystem::path(path).parent_path().generic_string();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _watchedFiles.insert(path);
+
+    for(const auto &watchedDirectory: _watchedDirectories)
+    {
+        if(watchedDirectory.second == directory)
+            return;
+    }
+
+    int watchDescriptor = inotify_add_watch(_inotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE);
+    if(watchDescriptor == -1)
+    {
+        Log::LogWarning("Couldn't watch directory '" + directory + "' for changes");
+        return;
+    }
+    _watchedDirectories[watchDescriptor] = directory;
+    #endif
+}
+void FileWatcher::Unwatch(const std::string &path)
+{
+    // The directory stays watched since other files in it might still be of interest,
+    // events for files that aren't watched anymore just get ignored
+    std::lock_guard<std::mutex> lock(_mutex);
+    _watchedFiles.erase(path);
+    _changedFiles.erase(path);
+}
+
+std::vector<std::string> FileWatcher::ConsumeChangedFiles(std::chrono::milliseconds quietPeriod)
+{
+    std::vector<std::string> changedFiles;
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for(auto it = _changedFiles.begin(); it != _changedFiles.end();)
+    {
+        if(now - it->second >= quietPeriod)
+        {
+            changedFiles.push_back(it->first);
+            it = _changedFiles.erase(it);
+        }
+        else
+            it++;
+    }
+    return changedFiles;
+}
+
+void FileWatcher::WatchLoop()
+{
+    #ifdef __linux__
+    // Large enough to hold a bunch of events at once, aligned the way inotify_event expects
+    alignas(struct inotify_event) char buffer[4096];
+
+    pollfd pollFD;
+    pollFD.fd = _inotifyFD;
+    pollFD.events = POLLIN;
+
+    while(_running)
+    {
+        // Wake up regularly so that Stop() doesn't have to wait for the next event
+        if(poll(&pollFD, 1, 100) <= 0)
+            continue;
+
+        ssize_t length = read(_inotifyFD, buffer, sizeof(buffer));
+        if(length <= 0)
+            continue;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(char *ptr = buffer; ptr < buffer + length;)
+        {
+            const inotify_event *event = (const inotify_event*)ptr;
+            ptr += sizeof(inotify_event) + event->len;
+
+            auto directoryIt = _watchedDirectories.find(event->wd);
+            if(event->len == 0 || directoryIt == _watchedDirectories.end())
+                continue;
+
+            std::string path = directoryIt->second + "/" + event->name;
+            if(_watchedFiles.find(path) != _watchedFiles.end())
+                _changedFiles[path] = Clock::now();
+        }
+    }
+    #endif
+}
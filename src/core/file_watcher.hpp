@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// Watches files for changes on a background thread (inotify on Linux, does nothing on other platforms).
+// The directories of the files get watched rather than the files themselves because most editors
+// save by writing a temporary file and renaming it over the original, which would drop a watch on the file
+class FileWatcher final
+{
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    int _inotifyFD = -1;
+    std::thread _thread;
+    std::atomic<bool> _running = false;
+
+    std::mutex _mutex;
+    std::unordered_set<std::string> _watchedFiles;
+    // inotify watch descriptor -> watched directory
+    std::unordered_map<int, std::string> _watchedDirectories;
+    // Changed file -> time of its latest change event
+    std::unordered_map<std::string, Clock::time_point> _changedFiles;
+
+    public:
+    FileWatcher() = default;
+    ~FileWatcher();
+    FileWatcher(const FileWatcher &other) = delete;
+    FileWatcher &operator=(const FileWatcher &other) = delete;
+
+    public:
+    void Start();
+    void Stop();
+
+    // Expects a canonical path so that it matches the paths reported back
+    void Watch(const std::string &path);
+    void Unwatch(const std::string &path);
+
+    // Returns the files that changed and haven't changed again for at least the quiet period.
+    // This coalesces the bursts of events an editor produces while saving into a single change
+    std::vector<std::string> ConsumeChangedFiles(std::chrono::milliseconds quietPeriod);
+
+    private:
+    void WatchLoop();
+};
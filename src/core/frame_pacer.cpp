@@ -0,0 +1,230 @@
+#include "frame_pacer.hpp"
+
+#include "log.hpp"
+#include "cpu_profiler.hpp"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/resource.h>
+#endif
+
+void FramePacer::Init(GLFWwindow *window)
+{
+    _window = window;
+
+    _previousFocusCallback = glfwSetWindowFocusCallback(window, OnWindowFocus);
+    _previousCursorEnterCallback = glfwSetCursorEnterCallback(window, OnCursorEnter);
+    _previousCursorPosCallback = glfwSetCursorPosCallback(window, OnCursorPos);
+    _previousMouseButtonCallback = glfwSetMouseButtonCallback(window, OnMouseButton);
+    _previousScrollCallback = glfwSetScrollCallback(window, OnScroll);
+    _previousKeyCallback = glfwSetKeyCallback(window, OnKey);
+    _previousCharCallback = glfwSetCharCallback(window, OnChar);
+    _previousRefreshCallback = glfwSetWindowRefreshCallback(window, OnRefresh);
+    _previousFramebufferSizeCallback = glfwSetFramebufferSizeCallback(window, OnFramebufferSize);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    _minimized = width == 0 || height == 0;
+
+    _lastFrameStart = Clock::now();
+    _intervalStart = _lastFrameStart;
+    _intervalCPUSeconds = GetProcessCPUSeconds();
+    _framesToDraw = REDRAW_FRAMES;
+}
+void FramePacer::DeInit()
+{
+    if(_window == nullptr)
+        return;
+
+    // Hands the window back to ImGui, so that it finds its own callbacks installed when it shuts down
+    glfwSetWindowFocusCallback(_window, _previousFocusCallback);
+    glfwSetCursorEnterCallback(_window, _previousCursorEnterCallback);
+    glfwSetCursorPosCallback(_window, _previousCursorPosCallback);
+    glfwSetMouseButtonCallback(_window, _previousMouseButtonCallback);
+    glfwSetScrollCallback(_window, _previousScrollCallback);
+    glfwSetKeyCallback(_window, _previousKeyCallback);
+    glfwSetCharCallback(_window, _previousCharCallback);
+    glfwSetWindowRefreshCallback(_window, _previousRefreshCallback);
+    glfwSetFramebufferSizeCallback(_window, _previousFramebufferSizeCallback);
+    _window = nullptr;
+
+    if(_stats.idleSeconds > 0.0)
+    {
+        Log::LogInfo("Idle CPU usage: " + std::to_string(_stats.idleCPUSeconds / _stats.idleSeconds * 100.0) + "% of a core over "
+            + std::to_string(_stats.idleSeconds) + " s idle, " + std::to_string(_stats.drawnFrames) + " frames drawn");
+    }
+}
+
+void FramePacer::WaitForEvents()
+{
+    PROFILE_ZONE("FramePacer::WaitForEvents");
+    // Nothing to draw (or nothing visible to draw into), sleep until an event's callback asks for a frame.
+    // The timeout keeps the hot-reloading going
+    if(!WantsFrame())
+        glfwWaitEventsTimeout(IDLE_POLL_INTERVAL);
+
+    // Waiting out the rest of the frame in glfwWaitEventsTimeout rather than sleeping keeps the input handled on time
+    _drawing = WantsFrame();
+    if(_drawing && settings.maxFPS > 0.0f)
+    {
+        Clock::time_point nextFrameStart = _lastFrameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / settings.maxFPS));
+        for(Clock::time_point now = Clock::now(); now < nextFrameStart; now = Clock::now())
+            glfwWaitEventsTimeout(std::chrono::duration<double>(nextFrameStart - now).count());
+    }
+    // Taken out right away, so that whatever asks for a redraw during this frame gets the next one
+    if(_drawing && _framesToDraw > 0)
+        _framesToDraw--;
+
+    glfwPollEvents();
+}
+
+bool FramePacer::BeginFrame()
+{
+    // Something asked for a redraw after the loop woke up only to poll, draw it right away instead of a poll interval later
+    if(!_drawing && WantsFrame())
+    {
+        _drawing = true;
+        if(_framesToDraw > 0)
+            _framesToDraw--;
+    }
+
+    if(_drawing)
+    {
+        _lastFrameStart = Clock::now();
+        _intervalFrames++;
+        _stats.drawnFrames++;
+    }
+    else
+        _stats.idleWakeups++;
+
+    UpdateMeasurements();
+    return _drawing;
+}
+
+void FramePacer::RequestRedraw(unsigned int frames)
+{
+    // An animation or pending work would otherwise keep a minimized window's loop spinning without drawing anything
+    if(_minimized)
+        return;
+    if(frames > _framesToDraw)
+        _framesToDraw = frames;
+}
+
+bool FramePacer::WantsFrame() const
+{
+    if(_minimized)
+        return false;
+    return !settings.renderOnDemand || _framesToDraw > 0;
+}
+
+void FramePacer::UpdateMeasurements()
+{
+    Clock::time_point now = Clock::now();
+    double intervalSeconds = std::chrono::duration<double>(now - _intervalStart).count();
+    if(intervalSeconds < MEASURE_INTERVAL)
+        return;
+
+    double cpuSeconds = GetProcessCPUSeconds();
+    double intervalCPUSeconds = cpuSeconds - _intervalCPUSeconds;
+
+    _stats.fps = (float)(_intervalFrames / intervalSeconds);
+    _stats.cpuUsage = (float)(intervalCPUSeconds / intervalSeconds * 100.0);
+    // Only intervals without a single frame count as idle, one that merely ended with the loop going to sleep doesn't
+    if(_intervalFrames == 0)
+    {
+        _stats.idleCPUUsage = _stats.cpuUsage;
+        _stats.idleSeconds += intervalSeconds;
+        _stats.idleCPUSeconds += intervalCPUSeconds;
+    }
+
+    _intervalStart = now;
+    _intervalCPUSeconds = cpuSeconds;
+    _intervalFrames = 0;
+}
+
+double FramePacer::GetProcessCPUSeconds()
+{
+    #ifdef _WIN32
+        FILETIME creationTime, exitTime, kernelTime, userTime;
+        if(!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+            return 0.0;
+        // Both are counted in 100 ns steps
+        auto toSeconds = [](const FILETIME &time) { return (double)(((unsigned long long)time.dwHighDateTime << 32) | time.dwLowDateTime) * 1e-7; };
+        return toSeconds(kernelTime) + toSeconds(userTime);
+    #else
+        rusage usage;
+        if(getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0.0;
+        return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e-6;
+    #endif
+}
+
+#pragma region Callbacks
+// Every event that could change what's on screen asks for a redraw after ImGui got to see it
+void FramePacer::OnWindowFocus(GLFWwindow *window, int focused)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousFocusCallback != nullptr)
+        pacer._previousFocusCallback(window, focused);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnCursorEnter(GLFWwindow *window, int entered)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousCursorEnterCallback != nullptr)
+        pacer._previousCursorEnterCallback(window, entered);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnCursorPos(GLFWwindow *window, double x, double y)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousCursorPosCallback != nullptr)
+        pacer._previousCursorPosCallback(window, x, y);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnMouseButton(GLFWwindow *window, int button, int action, int mods)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousMouseButtonCallback != nullptr)
+        pacer._previousMouseButtonCallback(window, button, action, mods);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnScroll(GLFWwindow *window, double x, double y)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousScrollCallback != nullptr)
+        pacer._previousScrollCallback(window, x, y);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnKey(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousKeyCallback != nullptr)
+        pacer._previousKeyCallback(window, key, scancode, action, mods);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnChar(GLFWwindow *window, unsigned int codepoint)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousCharCallback != nullptr)
+        pacer._previousCharCallback(window, codepoint);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnRefresh(GLFWwindow *window)
+{
+    // The window got uncovered or restored and its contents are damaged
+    FramePacer &pacer = getInstance();
+    if(pacer._previousRefreshCallback != nullptr)
+        pacer._previousRefreshCallback(window);
+    pacer.RequestRedraw();
+}
+void FramePacer::OnFramebufferSize(GLFWwindow *window, int width, int height)
+{
+    FramePacer &pacer = getInstance();
+    if(pacer._previousFramebufferSizeCallback != nullptr)
+        pacer._previousFramebufferSizeCallback(window, width, height);
+    pacer._minimized = width == 0 || height == 0;
+    pacer.RequestRedraw();
+}
+#pragma endregion
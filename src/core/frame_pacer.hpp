@@ -0,0 +1,122 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include "misc/singleton.hpp"
+
+#include <chrono>
+
+struct FramePacerSettings
+{
+    // Only draw when something changed, the main loop sleeps in between. Off draws every frame like a game loop
+    bool renderOnDemand = true;
+    // Frames per second at most, 0 leaves the frame rate uncapped
+    float maxFPS = 60.0f;
+};
+
+struct FramePacerStats
+{
+    unsigned long long drawnFrames = 0;
+    // Times the main loop woke up without having to draw, e.g. to poll for hot-reloaded files
+    unsigned long long idleWakeups = 0;
+    // Over the last measurement interval
+    float fps = 0.0f;
+    // Process CPU time in percent of a single core, all threads included
+    float cpuUsage = 0.0f;
+    // CPU usage of the last interval in which no frame was drawn at all
+    float idleCPUUsage = 0.0f;
+    // Totals over every idle interval since Init()
+    double idleSeconds = 0.0;
+    double idleCPUSeconds = 0.0;
+};
+
+// Decides when the main loop draws a frame. Input, window events, asset loads, animation and UI interaction mark the
+// frame dirty through RequestRedraw(), as long as nothing does the loop blocks in glfwWaitEventsTimeout instead of
+// redrawing an unchanged scene. Frames that do get drawn are spaced out to stay below the frame rate cap.
+// Nothing gets drawn while the window is minimized, no matter what asks for it
+class FramePacer final : public Singleton<FramePacer>
+{
+    friend class Singleton<FramePacer>;
+
+    public:
+    // ImGui only reacts to input on the frame after it arrives and the occlusion data lags a few frames behind,
+    // so a change keeps the loop drawing for a couple of frames until the picture settled
+    static constexpr unsigned int REDRAW_FRAMES = 4;
+    // How often an idle loop still wakes up, for the hot-reloading which has no window event to wake it
+    static constexpr double IDLE_POLL_INTERVAL = 0.25;
+    // Length of the intervals the frame rate and CPU usage are measured over
+    static constexpr double MEASURE_INTERVAL = 1.0;
+
+    FramePacerSettings settings;
+
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    GLFWwindow *_window = nullptr;
+    // The callbacks that were installed before ours (ImGui's), ours pass every event on to them
+    GLFWwindowfocusfun _previousFocusCallback = nullptr;
+    GLFWcursorenterfun _previousCursorEnterCallback = nullptr;
+    GLFWcursorposfun _previousCursorPosCallback = nullptr;
+    GLFWmousebuttonfun _previousMouseButtonCallback = nullptr;
+    GLFWscrollfun _previousScrollCallback = nullptr;
+    GLFWkeyfun _previousKeyCallback = nullptr;
+    GLFWcharfun _previousCharCallback = nullptr;
+    GLFWwindowrefreshfun _previousRefreshCallback = nullptr;
+    GLFWframebuffersizefun _previousFramebufferSizeCallback = nullptr;
+
+    // Frames still to be drawn after the current one
+    unsigned int _framesToDraw = REDRAW_FRAMES;
+    // Whether the current pass through the loop draws a frame
+    bool _drawing = false;
+    // The framebuffer is 0x0 while the window is minimized
+    bool _minimized = false;
+    Clock::time_point _lastFrameStart;
+
+    Clock::time_point _intervalStart;
+    double _intervalCPUSeconds = 0.0;
+    unsigned long long _intervalFrames = 0;
+
+    FramePacerStats _stats;
+
+    private:
+    FramePacer() = default;
+    ~FramePacer() = default;
+
+    public:
+    // Hooks the window's input callbacks, call after UIManager::Init() so that ImGui's callbacks get chained
+    void Init(GLFWwindow *window);
+    // Logs the idle CPU usage
+    void DeInit();
+
+    // Handles the window events. Sleeps until an event arrives if there's nothing to draw,
+    // otherwise only until the frame rate cap allows the next frame
+    void WaitForEvents();
+    // Returns true if a frame should be drawn now. Call once per loop after everything that could request a redraw ran.
+    // Always false while the window is minimized
+    bool BeginFrame();
+
+    // Makes the next frames get drawn, safe to call from anywhere on the main thread.
+    // Something that changes every frame (an animation) asks for a single frame every frame.
+    // Ignored while the window is minimized, restoring it redraws anyway
+    void RequestRedraw(unsigned int frames = REDRAW_FRAMES);
+
+    inline bool isMinimized() const { return _minimized; }
+    inline const FramePacerStats &getStats() const { return _stats; }
+
+    private:
+    bool WantsFrame() const;
+    void UpdateMeasurements();
+    // CPU time the whole process used so far, in seconds
+    static double GetProcessCPUSeconds();
+
+    static void OnWindowFocus(GLFWwindow *window, int focused);
+    static void OnCursorEnter(GLFWwindow *window, int entered);
+    static void OnCursorPos(GLFWwindow *window, double x, double y);
+    static void OnMouseButton(GLFWwindow *window, int button, int action, int mods);
+    static void OnScroll(GLFWwindow *window, double x, double y);
+    static void OnKey(GLFWwindow *window, int key, int scancode, int action, int mods);
+    static void OnChar(GLFWwindow *window, unsigned int codepoint);
+    static void OnRefresh(GLFWwindow *window);
+    static void OnFramebufferSize(GLFWwindow *window, int width, int height);
+};
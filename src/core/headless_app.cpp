@@ -0,0 +1,199 @@
+#include "headless_app.hpp"
+
+#include <glad/glad.h>
+
+#include <glm/mat4x4.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include "core/log.hpp"
+#include "core/resource_manager.hpp"
+#include "core/scene.hpp"
+#include "core/headless_context.hpp"
+#include "core/thumbnail_batch.hpp"
+#include "core/turntable_capture.hpp"
+#include "rendering/renderer.hpp"
+#include "rendering/render_target.hpp"
+#include "rendering/texture_streamer.hpp"
+#include "rendering/geometry_arena.hpp"
+#include "rendering/shader_cache.hpp"
+#include "rendering/shader_compiler.hpp"
+#include "rendering/software_rasterizer.hpp"
+
+#include <chrono>
+
+int HeadlessApp::Run(const CommandLineOptions &options)
+{
+    // stdout carries the captured frames, the log mustn't end up in between them
+    if(options.turntableFrames > 0 && options.outputPath == "-")
+        Log::SetOutputStream(std::cerr);
+
+    auto startupStart = std::chrono::steady_clock::now();
+
+    HeadlessContext context;
+    if(!context.Create(4, 2))
+    {
+        if(options.software)
+        {
+            Log::LogWarning("Couldn't create a headless GL context, rendering without one");
+            return RenderWithoutGL(options);
+        }
+        Log::LogFatal("Couldn't create a headless GL context. Exiting application...");
+        return -1;
+    }
+
+    if(!gladLoadGLLoader((GLADloadproc)HeadlessContext::GetProcAddress))
+    {
+        Log::LogFatal("glad failed to initialize. Exiting application...");
+        return -1;
+    }
+
+    TextureStreamer::getInstance().Init();
+    ShaderCache::getInstance().Init();
+    ShaderCompiler::getInstance().Init((GLADloadproc)HeadlessContext::GetProcAddress);
+    ResourceManager::getInstance().Init();
+
+    // Resource loading, the same internal resources the windowed viewer starts with
+    Scene &scene = Scene::getInstance();
+    scene.shader = ResourceManager::getInstance().LoadShaderFromFiles("res/internal/default.vs", "res/internal/default.fs");
+    ResourceManager::getInstance().LoadTextureFromFile("res/internal/ui_image_missing.jpg", false);
+    ResourceManager::getInstance().LoadTextureFromFile("res/internal/tex_missing.jpg", false);
+
+    Renderer::getInstance().Init((GLADloadproc)HeadlessContext::GetProcAddress);
+    if(options.software)
+        Renderer::getInstance().settings.backend = RenderBackend::SOFTWARE;
+
+    int exitCode = 0;
+    if(!options.vertShaderPath.empty())
+    {
+        Shader *shader = ResourceManager::getInstance().LoadShaderFromFiles(options.vertShaderPath, options.fragShaderPath);
+        if(shader != nullptr)
+            scene.shader = shader;
+        else
+            exitCode = -1;
+    }
+    // A batch brings its own models
+    if(!options.modelPath.empty() && options.batchInputs.empty())
+    {
+        // Unreadable files and models without faces come back as nullptr, so a missing input fails the render
+        scene.model = ResourceManager::getInstance().LoadModelFromOBJFile(options.modelPath);
+        if(scene.model == nullptr)
+        {
+            Log::LogError("Failed loading the model '" + options.modelPath + "'");
+            exitCode = -1;
+        }
+    }
+
+    float startupTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+    Log::LogInfo("Startup took " + std::to_string(startupTimeMs) + " ms");
+
+    if(exitCode == 0 && !options.batchInputs.empty())
+    {
+        exitCode = ThumbnailBatch(options).Run();
+    }
+    else if(exitCode == 0 && options.turntableFrames > 0)
+    {
+        exitCode = TurntableCapture(options).Run();
+    }
+    else if(exitCode == 0)
+    {
+        RenderTarget target(glm::uvec2(options.width, options.height));
+
+        // Same camera the windowed viewer starts out with
+        CameraData camera;
+        camera.projection = glm::perspective(45.0f, (float)options.width / (float)options.height, 0.1f, 100.0f);
+        camera.view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.25f, -5.0f));
+        camera.position = glm::vec3(glm::inverse(camera.view)[3]);
+        camera.viewportSize = target.getSize();
+        Renderer::getInstance().SetCamera(camera);
+
+        auto renderStart = std::chrono::steady_clock::now();
+        for(unsigned int frame = 0; frame < options.frames; frame++)
+        {
+            Renderer::getInstance().SetTime((float)frame / 60.0f);
+            ResourceManager::getInstance().Update();
+            ShaderCompiler::getInstance().Update();
+
+            target.Bind();
+            Renderer::getInstance().DrawScene();
+        }
+
+        std::vector<unsigned char> pixels = target.ReadPixels();
+        float renderTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+        Log::LogInfo("Rendered " + std::to_string(options.frames) + " frame(s) at " + std::to_string(options.width) + "x" + std::to_string(options.height)
+            + " in " + std::to_string(renderTimeMs) + " ms");
+
+        if(stbi_write_png(options.outputPath.c_str(), (int)options.width, (int)options.height, 4, pixels.data(), (int)options.width * 4) != 0)
+        {
+            Log::LogInfo("Wrote '" + options.outputPath + "'");
+        }
+        else
+        {
+            Log::LogError("Failed writing '" + options.outputPath + "'");
+            exitCode = -1;
+        }
+    }
+
+    ResourceManager::getInstance().DeInit();
+    Renderer::getInstance().DeInit();
+    GeometryArena::getInstance().DeInit();
+    TextureStreamer::getInstance().DeInit();
+
+    context.Destroy();
+    return exitCode;
+}
+
+int HeadlessApp::RenderWithoutGL(const CommandLineOptions &options)
+{
+    // Models normally live in GL buffers, so only a single model parsed straight from its file can be drawn
+    if(!options.batchInputs.empty() || options.turntableFrames > 0)
+    {
+        Log::LogFatal("Batches and turntables need a GL context. Exiting application...");
+        return -1;
+    }
+    if(options.modelPath.empty())
+    {
+        Log::LogFatal("Rendering without a GL context needs a model given with --model. Exiting application...");
+        return -1;
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::string error;
+    std::string contents = ResourceManager::ReadFile(options.modelPath);
+    // Same checks as LoadModelFromOBJFile on the GL path, a missing or empty model fails the render
+    if(contents.empty() || !ResourceManager::ParseOBJ(contents, vertices, indices, error) || indices.empty())
+    {
+        Log::LogError("Failed loading the model '" + options.modelPath + "' " + error);
+        return -1;
+    }
+
+    // Same camera and background as the GL path
+    glm::mat4 view = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -1.25f, -5.0f));
+    glm::mat4 projection = glm::perspective(45.0f, (float)options.width / (float)options.height, 0.1f, 100.0f);
+    glm::vec4 background = RendererSettings().bgColor;
+
+    auto renderStart = std::chrono::steady_clock::now();
+    SoftwareRasterizer rasterizer;
+    rasterizer.Resize(glm::uvec2(options.width, options.height));
+    rasterizer.SetCamera(view, projection, glm::vec3(glm::inverse(view)[3]));
+    for(unsigned int frame = 0; frame < options.frames; frame++)
+    {
+        rasterizer.Clear(glm::vec4(background.x, background.y, background.z, 1.0f));
+        rasterizer.DrawMesh(vertices, indices, glm::mat4(1.0f), SoftwareMaterial());
+    }
+    std::vector<unsigned char> pixels = rasterizer.ReadPixels();
+    float renderTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+    Log::LogInfo("Rendered " + std::to_string(options.frames) + " frame(s) at " + std::to_string(options.width) + "x" + std::to_string(options.height)
+        + " on " + std::to_string(rasterizer.getThreadCount()) + " threads in " + std::to_string(renderTimeMs) + " ms");
+
+    if(stbi_write_png(options.outputPath.c_str(), (int)options.width, (int)options.height, 4, pixels.data(), (int)options.width * 4) == 0)
+    {
+        Log::LogError("Failed writing '" + options.outputPath + "'");
+        return -1;
+    }
+    Log::LogInfo("Wrote '" + options.outputPath + "'");
+    return 0;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "command_line.hpp"
+
+// Runs the renderer without a window: creates an EGL context, draws the requested model into an offscreen
+// render target and writes the result into a PNG. No UI or file dialogs get touched, so it works on machines without a display
+class HeadlessApp
+{
+    public:
+    // Returns the process exit code
+    static int Run(const CommandLineOptions &options);
+
+    private:
+    // Renders the model with the software rasterizer alone, for machines where not even a headless GL context can be created
+    static int RenderWithoutGL(const CommandLineOptions &options);
+};
@@ -0,0 +1,136 @@
+#include "headless_context.hpp"
+
+#include "core/log.hpp"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+
+HeadlessContext::~HeadlessContext()
+{
+    Destroy();
+}
+
+bool HeadlessContext::Create(int majorVersion, int minorVersion)
+{
+    // The surfaceless platform needs no display server at all, it's looked up through the client extensions
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    bool hasSurfaceless = clientExtensions != nullptr && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr;
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    if(hasSurfaceless)
+    {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay != nullptr)
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if(display == EGL_NO_DISPLAY)
+    {
+        hasSurfaceless = false;
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    EGLint eglMajor = 0, eglMinor = 0;
+    if(display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+    {
+        Log::LogError("Failed initializing an EGL display");
+        return false;
+    }
+    _display = display;
+
+    if(!eglBindAPI(EGL_OPENGL_API))
+    {
+        Log::LogError("EGL display doesn't support desktop OpenGL");
+        Destroy();
+        return false;
+    }
+
+    // The config only matters for the pbuffer, the frames get drawn into framebuffer objects
+    const EGLint configAttributes[] =
+    {
+        EGL_SURFACE_TYPE, hasSurfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if(!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+    {
+        // Contexts without any config need EGL_KHR_no_config_context, which the surfaceless platform has
+        config = nullptr;
+        if(!hasSurfaceless)
+        {
+            Log::LogError("No EGL config supports desktop OpenGL pbuffers");
+            Destroy();
+            return false;
+        }
+    }
+
+    const EGLint contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    _context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if(_context == EGL_NO_CONTEXT)
+    {
+        Log::LogError("Failed creating an OpenGL " + std::to_string(majorVersion) + "." + std::to_string(minorVersion) + " core context through EGL");
+        _context = nullptr;
+        Destroy();
+        return false;
+    }
+
+    if(!hasSurfaceless)
+    {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        _surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        if(_surface == EGL_NO_SURFACE)
+        {
+            Log::LogError("Failed creating an EGL pbuffer surface");
+            _surface = nullptr;
+            Destroy();
+            return false;
+        }
+    }
+
+    EGLSurface surface = _surface != nullptr ? (EGLSurface)_surface : EGL_NO_SURFACE;
+    if(!eglMakeCurrent(display, surface, surface, (EGLContext)_context))
+    {
+        Log::LogError("Failed making the EGL context current");
+        Destroy();
+        return false;
+    }
+
+    Log::LogInfo(std::string("Created a headless context through EGL ") + std::to_string(eglMajor) + "." + std::to_string(eglMinor)
+        + (hasSurfaceless ? " (surfaceless)" : " (pbuffer)"));
+    return true;
+}
+
+void HeadlessContext::Destroy()
+{
+    if(_display == nullptr)
+        return;
+
+    EGLDisplay display = (EGLDisplay)_display;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if(_surface != nullptr)
+        eglDestroySurface(display, (EGLSurface)_surface);
+    if(_context != nullptr)
+        eglDestroyContext(display, (EGLContext)_context);
+    eglTerminate(display);
+
+    _surface = nullptr;
+    _context = nullptr;
+    _display = nullptr;
+}
+
+void *HeadlessContext::GetProcAddress(const char *name)
+{
+    return (void*)eglGetProcAddress(name);
+}
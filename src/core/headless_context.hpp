@@ -0,0 +1,27 @@
+#pragma once
+
+// A GL context without a window, created through EGL. Uses the surfaceless platform when the driver has it
+// (Mesa, including llvmpipe on machines without a GPU) and falls back to a tiny pbuffer surface otherwise.
+// Nothing is ever presented, everything gets drawn into framebuffers created by the caller
+class HeadlessContext
+{
+    private:
+    // EGL types are kept out of the header so that including it doesn't pull in the EGL headers
+    void *_display = nullptr;
+    void *_context = nullptr;
+    void *_surface = nullptr;
+
+    public:
+    HeadlessContext() = default;
+    ~HeadlessContext();
+    HeadlessContext(const HeadlessContext &other) = delete;
+    HeadlessContext &operator=(const HeadlessContext &other) = delete;
+
+    public:
+    // Creates a core profile context of at least the given version and makes it current on the calling thread
+    bool Create(int majorVersion, int minorVersion);
+    void Destroy();
+
+    // Loader for glad and the functions glad doesn't load
+    static void *GetProcAddress(const char *name);
+};
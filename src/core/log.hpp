@@ -6,6 +6,7 @@
 #include <string>
 #include <fstream>
 #include <ctime>
+#include <mutex>
 
 enum LogLevel
 {
@@ -22,6 +23,9 @@ class Log final
     private:
     // NOTE: A bit mask might be better
     inline static LogLevel _levelFilter = LogLevel::Info;
+    inline static std::ostream *_output = &std::cout;
+    // Worker threads log too, this keeps their lines from interleaving
+    inline static std::mutex _mutex;
 
     private:
     Log() {}
@@ -32,6 +36,11 @@ class Log final
     {
         Log::_levelFilter = filter;
     }
+    // Used to move the log out of the way when stdout carries data, e.g. frames piped into an encoder
+    static void SetOutputStream(std::ostream &stream)
+    {
+        Log::_output = &stream;
+    }
 
     static void LogInfo(const char *message)            { Log::LogMessage(LogLevel::Info, message); }
     static void LogInfo(const std::string &message)     { Log::LogMessage(LogLevel::Info, message); }
@@ -59,12 +68,18 @@ class Log final
         }
 
         // Get the current time in HH:MM:SS format
+        // localtime() returns a buffer shared by every thread, these variants fill in our own
         time_t rawCurrentTime;
         time(&rawCurrentTime);
-        tm *currentTime = localtime(&rawCurrentTime);
+        tm currentTime;
+#ifdef _WIN32
+        localtime_s(&currentTime, &rawCurrentTime);
+#else
+        localtime_r(&rawCurrentTime, &currentTime);
+#endif
         
         char currentTimeStr[9];
-        strftime(currentTimeStr, 9, "%T", currentTime);
+        strftime(currentTimeStr, 9, "%T", &currentTime);
 
         // Get the log level
         // NOTE: There is probably a more elegant and better way of converting the enum to a string but I can't be arsed right now
@@ -96,7 +111,8 @@ class Log final
             break;
         }
 
-        std::cout << "[" << currentTimeStr << "] " << logLevelStr << ": " << message << std::endl;
+        std::lock_guard<std::mutex> lock(Log::_mutex);
+        *Log::_output << "[" << currentTimeStr << "] " << logLevelStr << ": " << message << std::endl;
 
         // TODO: Log message event so the message gets printed out to the Console UI window as well
     }
@@ -7,10 +7,48 @@
 #include <tinyobjloader/tiny_obj_loader.h>
 
 #include "log.hpp"
+#include "cpu_profiler.hpp"
 #include "misc/utils.hpp"
+#include "rendering/texture_streamer.hpp"
+#include "rendering/shader_cache.hpp"
+#include "rendering/shader_compiler.hpp"
+#include "rendering/shader_preprocessor.hpp"
+#include "misc/hash.hpp"
 
 #include <fstream>
 #include <sstream>
+#include <filesystem>
+#include <chrono>
+#include <cstring>
+
+// How long a file has to stay untouched after a change before it gets reloaded.
+// Editors often write a file several times while saving, this makes sure it only gets reloaded once
+static constexpr std::chrono::milliseconds HOT_RELOAD_QUIET_PERIOD(200);
+
+// Used to confirm a content hash hit. Reads the file without logging since a missing file only means the contents don't match
+static bool FileHasContents(const std::string &path, const void *data, size_t size)
+{
+    std::error_code error;
+    if(std::filesystem::file_size(path, error) != size || error)
+        return false;
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<char> fileContents(size);
+    if(!file.read(fileContents.data(), (std::streamsize)size))
+        return false;
+    return memcmp(fileContents.data(), data, size) == 0;
+}
+
+static int GetPixelFormatFromChannelCount(int channels)
+{
+    switch(channels)
+    {
+        case 1:  return GL_RED;
+        case 2:  return GL_RG;
+        case 4:  return GL_RGBA;
+        default: return GL_RGB;
+    }
+}
 
 std::string ResourceManager::ReadFile(const std::string &path)
 {
@@ -37,6 +75,28 @@ std::string ResourceManager::ReadFile(const std::string &path)
         return "";
     }
 }
+std::vector<unsigned char> ResourceManager::ReadBinaryFile(const std::string &path)
+{
+    std::ifstream fileStream(path, std::ios::binary | std::ios::ate);
+    if(!fileStream.is_open())
+    {
+        Log::LogError("Couldn't read file, path: " + path);
+        return {};
+    }
+
+    // The stream was opened at the end of the file so its size can be read right away
+    // and the whole file can be read in one go without any reallocations
+    std::streamsize size = fileStream.tellg();
+    fileStream.seekg(0, std::ios::beg);
+
+    std::vector<unsigned char> contents(size);
+    if(size > 0 && !fileStream.read((char*)contents.data(), size))
+    {
+        Log::LogError("Couldn't read file, path: " + path);
+        return {};
+    }
+    return contents;
+}
 std::pair<std::string, std::string> ResourceManager::ParseFileNameAndExtension(const std::string &path)
 {
     std::vector<std::string> splitPath = SplitString(path, '/');
@@ -46,10 +106,62 @@ std::pair<std::string, std::string> ResourceManager::ParseFileNameAndExtension(c
 
     return make_pair(fileName, extension);
 }
+std::string ResourceManager::CanonicalizePath(const std::string &path)
+{
+    // weakly_canonical is used instead of canonical so that paths to files
+    // that don't exist (yet) still get normalized rather than throwing
+    std::error_code error;
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(std::filesystem::path(path), error);
+    if(error)
+        return std::filesystem::path(path).lexically_normal().generic_string();
+    
+    return canonicalPath.generic_string();
+}
+
+void ResourceManager::LogDeduplicationReport() const
+{
+    Log::LogInfo("Resource deduplication: " + std::to_string(_dedupStats.sharedTextures) + " textures shared (" + std::to_string(_dedupStats.textureBytesSaved / 1024) + " KiB saved), " 
+                + std::to_string(_dedupStats.sharedModels) + " models shared (" + std::to_string(_dedupStats.modelBytesSaved / 1024) + " KiB saved)");
+}
+
+void ResourceManager::Init()
+{
+    _fileWatcher.Start();
+}
+void ResourceManager::DeInit()
+{
+    _fileWatcher.Stop();
+}
+
+bool ResourceManager::Update()
+{
+    std::vector<std::string> changedFiles = _fileWatcher.ConsumeChangedFiles(HOT_RELOAD_QUIET_PERIOD);
+    if(changedFiles.empty())
+        return false;
+    PROFILE_ZONE("ResourceManager::Update");
+
+    // Collect the shaders first so that a shader whose files changed together (eg. a shared include) only gets rebuilt once
+    std::unordered_set<std::string> shadersToReload;
+    for(const std::string &path: changedFiles)
+    {
+        if(_loadedTextures.find(path) != _loadedTextures.end())
+            ReloadTexture(path);
+
+        for(const auto &variantSet: _shaderVariantSets)
+        {
+            if(variantSet.second.UsesFile(path))
+                shadersToReload.insert(variantSet.first);
+        }
+    }
+    for(const std::string &name: shadersToReload)
+        ReloadShader(name);
+    return true;
+}
 
 #pragma region Shaders
 Shader* ResourceManager::LoadShaderFromFiles(const std::string &vertShaderPath, const std::string &fragShaderPath)
 {
+    PROFILE_ZONE("ResourceManager::LoadShaderFromFiles");
     // Get rid of the file extension and get the name of the shader
     std::vector<std::string> splitVertPath = SplitString(vertShaderPath, '/');
     std::string shaderName = SplitString(splitVertPath[splitVertPath.size() - 1], '.')[0];
@@ -60,15 +172,75 @@ Shader* ResourceManager::LoadShaderFromFiles(const std::string &vertShaderPath,
         return const_cast<Shader*>(GetShader(shaderName));
     }
 
-    std::string vertShaderSource = ReadFile(vertShaderPath);
-    std::string fragShaderSource = ReadFile(fragShaderPath);
+    auto loadStart = std::chrono::steady_clock::now();
 
-    Shader *shader = new Shader(vertShaderSource.c_str(), fragShaderSource.c_str());
+    ShaderVariantSet variantSet;
+    if(!PreprocessShader(vertShaderPath, fragShaderPath, variantSet))
+        return nullptr;
+    // Shaders start out with all of their variant keys disabled
+    auto sources = GetVariantSources(variantSet, 0);
+
+    // Skips compiling and linking if the program binary was cached during an earlier launch
+    ShaderCache &shaderCache = ShaderCache::getInstance();
+    unsigned int cacheHitsBefore = shaderCache.getStats().hits;
+    Shader *shader = shaderCache.LoadOrCompile(sources.first, sources.second);
+    bool fromCache = shaderCache.getStats().hits != cacheHitsBefore;
+
+    float loadTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
     AddLoadedShader(shader, shaderName);
-    Log::LogInfo("Loaded new shader, name: '" + shaderName + "'");
+    if(shader != nullptr)
+        AddShaderVariantSet(shaderName, std::move(variantSet));
+    Log::LogInfo("Loaded new shader, name: '" + shaderName + "' in " + std::to_string(loadTimeMs) + " ms" + (fromCache ? " (cached binary)" : ""));
     return shader;
 }
 
+void ResourceManager::LoadShaderFromFilesAsync(const std::string &vertShaderPath, const std::string &fragShaderPath)
+{
+    PROFILE_ZONE("ResourceManager::LoadShaderFromFilesAsync");
+    // Get rid of the file extension and get the name of the shader
+    std::string shaderName = ParseFileNameAndExtension(vertShaderPath).first;
+
+    if(_loadedShaders.find(shaderName) != _loadedShaders.end() || _pendingShaders.find(shaderName) != _pendingShaders.end())
+    {
+        Log::LogWarning("Stopped loading shader '" + shaderName + "' because it's been loaded already");
+        return;
+    }
+
+    ShaderVariantSet variantSet;
+    if(!PreprocessShader(vertShaderPath, fragShaderPath, variantSet))
+        return;
+    auto sources = GetVariantSources(variantSet, 0);
+
+    // A cached binary loads about as fast as polling a compile job would, so it doesn't need to go through the compiler
+    Shader *cachedShader = ShaderCache::getInstance().TryLoad(sources.first, sources.second);
+    if(cachedShader != nullptr)
+    {
+        AddLoadedShader(cachedShader, shaderName);
+        AddShaderVariantSet(shaderName, std::move(variantSet));
+        Log::LogInfo("Loaded new shader, name: '" + shaderName + "' (cached binary)");
+        return;
+    }
+
+    _pendingShaders.insert(shaderName);
+    auto submitTime = std::chrono::steady_clock::now();
+    ShaderCompiler::getInstance().Submit(sources.first, sources.second, [this, shaderName, variantSet, sources, submitTime](Shader *shader)
+    {
+        _pendingShaders.erase(shaderName);
+        if(shader == nullptr)
+        {
+            Log::LogError("Failed compiling shader '" + shaderName + "'");
+            return;
+        }
+
+        ShaderCache::getInstance().Store(sources.first, sources.second, *shader);
+        AddLoadedShader(shader, shaderName);
+        AddShaderVariantSet(shaderName, variantSet);
+
+        float compileTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - submitTime).count();
+        Log::LogInfo("Loaded new shader, name: '" + shaderName + "' after " + std::to_string(compileTimeMs) + " ms of background compilation");
+    });
+}
+
 const Shader* const ResourceManager::GetShader(const std::string &name)
 {
     for(const auto &shader: _loadedShaders)
@@ -97,6 +269,30 @@ void ResourceManager::UnloadShader(const std::string &name)
         {
             shader.second->Unbind();
             _loadedShaders.erase(shader.first);
+
+            auto variantSetIt = _shaderVariantSets.find(name);
+            if(variantSetIt != _shaderVariantSets.end())
+            {
+                ShaderVariantSet variantSet = std::move(variantSetIt->second);
+                _shaderVariantSets.erase(variantSetIt);
+                for(auto &variant: variantSet.inactiveVariants)
+                    delete variant.second;
+
+                // Stop watching the source files unless another shader was built from them as well (eg. a shared include)
+                std::vector<std::string> sourceFiles = variantSet.includedFiles;
+                sourceFiles.push_back(variantSet.vertPath);
+                sourceFiles.push_back(variantSet.fragPath);
+                for(const std::string &path: sourceFiles)
+                {
+                    bool isUsed = false;
+                    for(const auto &otherVariantSet: _shaderVariantSets)
+                        isUsed |= otherVariantSet.second.UsesFile(path);
+                    if(!isUsed)
+                        _fileWatcher.Unwatch(path);
+                }
+            }
+            _shaderReloadGenerations.erase(name);
+
             Log::LogInfo("Unloaded shader '" + name + "'");
             return;
         }
@@ -104,13 +300,215 @@ void ResourceManager::UnloadShader(const std::string &name)
 
     Log::LogInfo("Failed unloading shader '" + name +"', shader not among loaded shaders");
 }
+
+void ResourceManager::ReloadShader(const std::string &name)
+{
+    PROFILE_ZONE("ResourceManager::ReloadShader");
+    auto variantSetIt = _shaderVariantSets.find(name);
+    if(variantSetIt == _shaderVariantSets.end())
+        return;
+    ShaderVariantSet &variantSet = variantSetIt->second;
+
+    ShaderVariantSet reloadedSet;
+    if(!PreprocessShader(variantSet.vertPath, variantSet.fragPath, reloadedSet))
+    {
+        Log::LogWarning("Skipped reloading shader '" + name + "', its source files couldn't be read");
+        return;
+    }
+
+    // The keys might have been reordered, added or removed, so carry the active variant over by the names of its keys
+    uint32_t activeMask = 0;
+    for(const std::string &key: ShaderPreprocessor::GetEnabledKeys(variantSet.variantKeys, variantSet.activeMask))
+    {
+        int keyIndex = FindIndexOfElement<std::string>(reloadedSet.variantKeys, key);
+        if(keyIndex != -1)
+            activeMask |= 1u << keyIndex;
+    }
+
+    // Every other variant was built from the old sources, they get recompiled when they're selected again
+    for(auto &variant: variantSet.inactiveVariants)
+        delete variant.second;
+    variantSet.inactiveVariants.clear();
+
+    // If the new program fails to compile, the old one stays in use with the keys it was built with, which is as close as it gets
+    reloadedSet.activeMask = activeMask;
+    reloadedSet.requestedMask = activeMask;
+    // Includes might have been added or removed, so the watched files are updated as well
+    AddShaderVariantSet(name, std::move(reloadedSet));
+    ShaderVariantSet &newVariantSet = _shaderVariantSets[name];
+
+    unsigned int generation = ++_shaderReloadGenerations[name];
+    auto sources = GetVariantSources(newVariantSet, activeMask);
+
+    // Going back to an earlier version of the file (eg. undoing an edit) can hit the binary cache
+    Shader *cachedShader = ShaderCache::getInstance().TryLoad(sources.first, sources.second);
+    if(cachedShader != nullptr)
+    {
+        ActivateShaderVariant(name, activeMask, cachedShader, false);
+        Log::LogInfo("Reloaded shader '" + name + "' (cached binary)");
+        return;
+    }
+
+    Log::LogInfo("Recompiling shader '" + name + "'");
+    ShaderCompiler::getInstance().Submit(sources.first, sources.second, [this, name, generation, activeMask, sources](Shader *shader)
+    {
+        if(shader == nullptr)
+        {
+            Log::LogError("Failed reloading shader '" + name + "', keeping the previous version");
+            return;
+        }
+
+        ShaderCache::getInstance().Store(sources.first, sources.second, *shader);
+        // The shader was either unloaded or edited again while this version was compiling
+        if(_loadedShaders.find(name) == _loadedShaders.end() || _shaderReloadGenerations[name] != generation)
+        {
+            delete shader;
+            return;
+        }
+
+        ActivateShaderVariant(name, activeMask, shader, false);
+        Log::LogInfo("Reloaded shader '" + name + "'");
+    });
+}
+
+const ShaderVariantSet *ResourceManager::GetShaderVariantSet(const std::string &name) const
+{
+    auto it = _shaderVariantSets.find(name);
+    return it != _shaderVariantSets.end() ? &it->second : nullptr;
+}
+
+void ResourceManager::SetShaderVariant(const std::string &name, uint32_t mask)
+{
+    auto variantSetIt = _shaderVariantSets.find(name);
+    if(variantSetIt == _shaderVariantSets.end())
+        return;
+    ShaderVariantSet &variantSet = variantSetIt->second;
+
+    variantSet.requestedMask = mask;
+    if(mask == variantSet.activeMask)
+        return;
+
+    // Switching back to a variant that has been used before is just a swap
+    auto cachedVariantIt = variantSet.inactiveVariants.find(mask);
+    if(cachedVariantIt != variantSet.inactiveVariants.end())
+    {
+        ActivateShaderVariant(name, mask, cachedVariantIt->second, true);
+        return;
+    }
+
+    auto sources = GetVariantSources(variantSet, mask);
+    Shader *cachedShader = ShaderCache::getInstance().TryLoad(sources.first, sources.second);
+    if(cachedShader != nullptr)
+    {
+        ActivateShaderVariant(name, mask, cachedShader, true);
+        return;
+    }
+
+    unsigned int generation = _shaderReloadGenerations[name];
+    ShaderCompiler::getInstance().Submit(sources.first, sources.second, [this, name, generation, mask, sources](Shader *shader)
+    {
+        auto variantSetIt = _shaderVariantSets.find(name);
+        if(shader == nullptr || variantSetIt == _shaderVariantSets.end() || _shaderReloadGenerations[name] != generation)
+        {
+            if(shader == nullptr)
+                Log::LogError("Failed compiling a variant of shader '" + name + "'");
+            delete shader;
+            return;
+        }
+        ShaderCache::getInstance().Store(sources.first, sources.second, *shader);
+
+        // Another variant might have been selected while this one was compiling, it's kept around for later in that case
+        ShaderVariantSet &variantSet = variantSetIt->second;
+        if(variantSet.requestedMask == mask && variantSet.activeMask != mask)
+            ActivateShaderVariant(name, mask, shader, true);
+        else if(variantSet.inactiveVariants.find(mask) == variantSet.inactiveVariants.end() && variantSet.activeMask != mask)
+            variantSet.inactiveVariants[mask] = shader;
+        else
+            delete shader;
+    });
+}
+
+bool ResourceManager::PreprocessShader(const std::string &vertShaderPath, const std::string &fragShaderPath, ShaderVariantSet &variantSet)
+{
+    PreprocessedShader vertShader = ShaderPreprocessor::Process(vertShaderPath);
+    PreprocessedShader fragShader = ShaderPreprocessor::Process(fragShaderPath);
+    if(!vertShader.succeeded || !fragShader.succeeded)
+        return false;
+
+    variantSet.vertPath = CanonicalizePath(vertShaderPath);
+    variantSet.fragPath = CanonicalizePath(fragShaderPath);
+    variantSet.vertSource = std::move(vertShader.source);
+    variantSet.fragSource = std::move(fragShader.source);
+
+    // Both stages get compiled with the same defines, so the keys and includes of both are merged together
+    variantSet.includedFiles = std::move(vertShader.includedFiles);
+    for(const std::string &path: fragShader.includedFiles)
+    {
+        if(std::find(variantSet.includedFiles.begin(), variantSet.includedFiles.end(), path) == variantSet.includedFiles.end())
+            variantSet.includedFiles.push_back(path);
+    }
+    variantSet.variantKeys = std::move(vertShader.variantKeys);
+    for(const std::string &key: fragShader.variantKeys)
+    {
+        if(std::find(variantSet.variantKeys.begin(), variantSet.variantKeys.end(), key) == variantSet.variantKeys.end() && variantSet.variantKeys.size() < ShaderPreprocessor::MAX_VARIANT_KEYS)
+            variantSet.variantKeys.push_back(key);
+    }
+    return true;
+}
+
+std::pair<std::string, std::string> ResourceManager::GetVariantSources(const ShaderVariantSet &variantSet, uint32_t mask)
+{
+    std::vector<std::string> defines = ShaderPreprocessor::GetEnabledKeys(variantSet.variantKeys, mask);
+    return std::make_pair(ShaderPreprocessor::InjectDefines(variantSet.vertSource, defines), ShaderPreprocessor::InjectDefines(variantSet.fragSource, defines));
+}
+
+void ResourceManager::AddShaderVariantSet(const std::string &name, ShaderVariantSet variantSet)
+{
+    _fileWatcher.Watch(variantSet.vertPath);
+    _fileWatcher.Watch(variantSet.fragPath);
+    for(const std::string &path: variantSet.includedFiles)
+        _fileWatcher.Watch(path);
+
+    _shaderVariantSets[name] = std::move(variantSet);
+}
+
+void ResourceManager::ActivateShaderVariant(const std::string &name, uint32_t mask, Shader *variant, bool keepPrevious)
+{
+    auto shaderIt = _loadedShaders.find(name);
+    auto variantSetIt = _shaderVariantSets.find(name);
+    if(shaderIt == _loadedShaders.end() || variantSetIt == _shaderVariantSets.end())
+    {
+        delete variant;
+        return;
+    }
+    Shader *shader = shaderIt->second;
+    ShaderVariantSet &variantSet = variantSetIt->second;
+
+    // Keep the values set through the UI for every uniform that still exists with the same type
+    for(ShaderUniform &newUniform: variant->getUniforms())
+    {
+        const ShaderUniform *oldUniform = shader->FindUniform(newUniform.getID());
+        if(oldUniform != nullptr && oldUniform->getType() == newUniform.getType())
+            newUniform.TakeValueFrom(*oldUniform);
+    }
+
+    // This only gets called from the UI, ResourceManager::Update() and ShaderCompiler::Update(), none of which run
+    // in the middle of drawing the scene, so the whole frame is always drawn with either the old or the new program.
+    // After the swap, the variant object holds the previous program
+    shader->SwapProgram(*variant);
+    variantSet.inactiveVariants.erase(mask);
+    if(keepPrevious)
+        variantSet.inactiveVariants[variantSet.activeMask] = variant;
+    else
+        delete variant;
+    variantSet.activeMask = mask;
+}
 #pragma endregion
 
 #pragma region Textures
-Texture* ResourceManager::LoadTextureFromFile(const std::string &path)
+Texture* ResourceManager::LoadTextureFromFile(const std::string &path, bool allowStreaming)
 {
-    std::vector<std::string> splitPath = SplitString(path, '/');
-    
+    PROFILE_ZONE("ResourceManager::LoadTextureFromFile");
     auto fileNameAndExtension = ParseFileNameAndExtension(path);
     if(fileNameAndExtension.second.compare("jpg") != 0 && fileNameAndExtension.second.compare("png") != 0)
     {
@@ -118,64 +516,216 @@ Texture* ResourceManager::LoadTextureFromFile(const std::string &path)
         return nullptr;
     }
 
-    if(GetTexture(fileNameAndExtension.first) != nullptr)
+    // Textures are keyed by the full path rather than the file name
+    // so that two different files with the same name don't collide
+    std::string canonicalPath = CanonicalizePath(path);
+    if(_loadedTextures.find(canonicalPath) != _loadedTextures.end())
     {
-        Log::LogWarning("Stopped loading texture '" + fileNameAndExtension.first + "' because it's been loaded already");
-        return const_cast<Texture*>(GetTexture(fileNameAndExtension.first));
+        Log::LogWarning("Stopped loading texture '" + canonicalPath + "' because it's been loaded already");
+        return _loadedTextures[canonicalPath];
     }
 
-    int width, height;
-    unsigned char *data = stbi_load(path.c_str(), &width, &height, nullptr, 0);
-    Texture *tex = new Texture(GL_TEXTURE_2D, glm::vec2(width, height), GL_RGB, GL_RGB, (void*)data);
+    std::vector<unsigned char> fileContents = ReadBinaryFile(path);
+    if(fileContents.empty())
+        return nullptr;
     
-    AddLoadedTexture(tex, fileNameAndExtension.first);
-    Log::LogInfo("Loaded new texture '" + fileNameAndExtension.first + "'");
+    // If a texture with the exact same contents has already been loaded under a different path,
+    // share its GPU object rather than decoding and uploading the same image again
+    uint64_t contentHash = Hash64(fileContents.data(), fileContents.size());
+    auto sameContentsIt = _textureContentHashes.find(contentHash);
+    if(sameContentsIt != _textureContentHashes.end() && FileHasContents(sameContentsIt->second.path, fileContents.data(), fileContents.size()))
+    {
+        Texture *sharedTex = sameContentsIt->second.resource;
+        size_t bytesSaved = (size_t)sharedTex->getSize().x * sharedTex->getSize().y * sharedTex->getChannelCount();
+        _dedupStats.sharedTextures++;
+        _dedupStats.textureBytesSaved += bytesSaved;
+
+        AddLoadedTexture(sharedTex, canonicalPath);
+        _fileWatcher.Watch(canonicalPath);
+        Log::LogInfo("Texture '" + canonicalPath + "' has the same contents as an already loaded texture, sharing it (" + std::to_string(bytesSaved / 1024) + " KiB saved)");
+        return sharedTex;
+    }
+
+    int width, height, channels;
+    unsigned char *data = stbi_load_from_memory(fileContents.data(), (int)fileContents.size(), &width, &height, &channels, 0);
+    if(data == nullptr)
+    {
+        Log::LogError("Texture loading failed, couldn't decode image '" + path + "': " + stbi_failure_reason());
+        return nullptr;
+    }
+
+    int format = GetPixelFormatFromChannelCount(channels);
+    bool streamed = allowStreaming && TextureStreamer::getInstance().settings.enabled;
+    Texture *tex = new Texture(GL_TEXTURE_2D, glm::vec2(width, height), format, format, (void*)data, 0, streamed);
+    
+    AddLoadedTexture(tex, canonicalPath);
+    // A collision keeps the entry of the texture that was loaded first
+    _textureContentHashes.insert(std::make_pair(contentHash, ContentHashEntry<Texture>{ tex, canonicalPath }));
+    _fileWatcher.Watch(canonicalPath);
+    Log::LogInfo("Loaded new texture '" + canonicalPath + "'");
     return tex;
 }
 
-const Texture* const ResourceManager::GetTexture(const std::string &name)
+const Texture* const ResourceManager::GetTexture(const std::string &path)
 {
-    for(const auto &tex: _loadedTextures)
+    auto it = _loadedTextures.find(CanonicalizePath(path));
+    if(it != _loadedTextures.end())
     {
-        if(tex.first.compare(name) == 0)
-        {
-            return _loadedTextures[tex.first];
-        }
+        return it->second;
     }
-    Log::LogWarning("Couldn't find texture '" + name + "' among loaded textures");
+    Log::LogWarning("Couldn't find texture '" + path + "' among loaded textures");
     return nullptr;
 }
 
-void ResourceManager::AddLoadedTexture(Texture *texture, std::string name)
+void ResourceManager::AddLoadedTexture(Texture *texture, std::string path)
 {
     if(texture != nullptr)
     {
-        _loadedTextures.insert(std::make_pair(name, texture));
+        _loadedTextures.insert(std::make_pair(CanonicalizePath(path), texture));
     }
 }
 
-void ResourceManager::UnloadTexture(const std::string &name)
+void ResourceManager::UnloadTexture(const std::string &path)
 {
-    for(const auto &tex: _loadedTextures)
+    std::string canonicalPath = CanonicalizePath(path);
+    auto it = _loadedTextures.find(canonicalPath);
+    if(it != _loadedTextures.end())
     {
-        if(tex.first.compare(name) == 0)
+        Texture *tex = it->second;
+        // delete tex.second.get();
+        _loadedTextures.erase(it);
+        _fileWatcher.Unwatch(canonicalPath);
+
+        // Only forget the contents of the texture once no other path shares it anymore
+        bool isShared = false;
+        for(const auto &entry: _loadedTextures)
         {
-            // delete tex.second.get();
-            _loadedTextures.erase(name);
-            Log::LogInfo("Unloaded texture '" + name + "'");
-            return;
+            if(entry.second == tex)
+            {
+                isShared = true;
+                break;
+            }
+        }
+        if(!isShared)
+        {
+            for(auto hashIt = _textureContentHashes.begin(); hashIt != _textureContentHashes.end(); hashIt++)
+            {
+                if(hashIt->second.resource == tex)
+                {
+                    _textureContentHashes.erase(hashIt);
+                    break;
+                }
+            }
+        }
+
+        Log::LogInfo("Unloaded texture '" + canonicalPath + "'");
+        return;
+    }
+
+    Log::LogInfo("Failed unloading texture '" + canonicalPath +"', texture not among loaded textures");
+}
+
+void ResourceManager::ReloadTexture(const std::string &path)
+{
+    PROFILE_ZONE("ResourceManager::ReloadTexture");
+    std::string canonicalPath = CanonicalizePath(path);
+    auto it = _loadedTextures.find(canonicalPath);
+    if(it == _loadedTextures.end())
+        return;
+    Texture *tex = it->second;
+
+    // The file might have been caught in the middle of being written, the next change event retries
+    std::vector<unsigned char> fileContents = ReadBinaryFile(canonicalPath);
+    if(fileContents.empty())
+        return;
+
+    uint64_t contentHash = Hash64(fileContents.data(), fileContents.size());
+    auto oldHashIt = _textureContentHashes.end();
+    for(auto hashIt = _textureContentHashes.begin(); hashIt != _textureContentHashes.end(); hashIt++)
+    {
+        if(hashIt->second.resource == tex)
+        {
+            oldHashIt = hashIt;
+            break;
         }
     }
+    // Saving without changing anything still triggers a change event
+    if(oldHashIt != _textureContentHashes.end() && oldHashIt->first == contentHash)
+        return;
+
+    int width, height, channels;
+    unsigned char *data = stbi_load_from_memory(fileContents.data(), (int)fileContents.size(), &width, &height, &channels, 0);
+    if(data == nullptr)
+    {
+        Log::LogError("Failed reloading texture '" + canonicalPath + "', keeping the previous version: " + stbi_failure_reason());
+        return;
+    }
 
-    Log::LogInfo("Failed unloading texture '" + name +"', texture not among loaded textures");
+    // NOTE: Paths that share this texture because they had identical contents get the new image as well
+    int format = GetPixelFormatFromChannelCount(channels);
+    tex->Respecify(glm::uvec2(width, height), format, format, (void*)data);
+
+    if(oldHashIt != _textureContentHashes.end())
+        _textureContentHashes.erase(oldHashIt);
+    _textureContentHashes.insert(std::make_pair(contentHash, ContentHashEntry<Texture>{ tex, canonicalPath }));
+
+    Log::LogInfo("Reloaded texture '" + canonicalPath + "'");
 }
 #pragma endregion
 
 #pragma region Models
 Model *ResourceManager::LoadModelFromOBJFile(const std::string &path)
 {
+    PROFILE_ZONE("ResourceManager::LoadModelFromOBJFile");
+    std::string canonicalPath = CanonicalizePath(path);
+    if(_loadedModels.find(canonicalPath) != _loadedModels.end())
+    {
+        Log::LogWarning("Stopped loading model '" + canonicalPath + "' because it's been loaded already");
+        return _loadedModels[canonicalPath];
+    }
+
+    // ReadFile already logged why the file couldn't be read
     std::string objFileContents = ReadFile(path);
+    if(objFileContents.empty())
+        return nullptr;
+
+    // Share the GPU buffers of an already loaded model with identical contents instead of parsing the file again
+    uint64_t contentHash = Hash64(objFileContents.data(), objFileContents.size());
+    auto sameContentsIt = _modelContentHashes.find(contentHash);
+    if(sameContentsIt != _modelContentHashes.end() && FileHasContents(sameContentsIt->second.path, objFileContents.data(), objFileContents.size()))
+    {
+        Model *sharedModel = sameContentsIt->second.resource;
+        size_t bytesSaved = sizeof(Vertex) * sharedModel->getVertices().size() + sizeof(unsigned int) * sharedModel->getIndices().size();
+        _dedupStats.sharedModels++;
+        _dedupStats.modelBytesSaved += bytesSaved;
+
+        AddLoadedModel(sharedModel, canonicalPath);
+        Log::LogInfo("Model '" + canonicalPath + "' has the same contents as an already loaded model, sharing it (" + std::to_string(bytesSaved / 1024) + " KiB saved)");
+        return sharedModel;
+    }
     
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::string error;
+    if(!ParseOBJ(objFileContents, vertices, indices, error))
+    {
+        Log::LogError(error);
+        return nullptr;
+    }
+    if(indices.empty())
+    {
+        Log::LogError("Model '" + canonicalPath + "' doesn't have any faces");
+        return nullptr;
+    }
+
+    Model *model = new Model(std::move(vertices), std::move(indices));
+    AddLoadedModel(model, canonicalPath);
+    _modelContentHashes.insert(std::make_pair(contentHash, ContentHashEntry<Model>{ model, canonicalPath }));
+    return model;
+}
+bool ResourceManager::ParseOBJ(const std::string &objFileContents, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, std::string &error)
+{
+    PROFILE_ZONE("ResourceManager::ParseOBJ");
     tinyobj::ObjReaderConfig config;
     config.mtl_search_path = "";
     config.triangulate = true;
@@ -184,97 +734,144 @@ Model *ResourceManager::LoadModelFromOBJFile(const std::string &path)
     tinyobj::ObjReader reader;
     reader.ParseFromString(objFileContents, "", config);
 
-    if(reader.Valid())
+    if(!reader.Valid())
     {
-        auto &attrib = reader.GetAttrib();
-        auto &shapes = reader.GetShapes();
+        error = reader.Error();
+        return false;
+    }
+
+    auto &attrib = reader.GetAttrib();
+    auto &shapes = reader.GetShapes();
+
+    vertices.clear();
+    indices.clear();
 
-        std::vector<Vertex> vertices;
+    // OBJ corners that reference the same position, UV and normal turn into the same vertex,
+    // so shared corners are only stored (and transformed by the GPU) once
+    struct CornerKey
+    {
+        int vertexIndex, texcoordIndex, normalIndex;
+        bool operator==(const CornerKey &other) const
+        {
+            return vertexIndex == other.vertexIndex && texcoordIndex == other.texcoordIndex && normalIndex == other.normalIndex;
+        }
+    };
+    struct CornerKeyHash
+    {
+        size_t operator()(const CornerKey &key) const
+        {
+            return Hash64(&key, sizeof(CornerKey));
+        }
+    };
+    std::unordered_map<CornerKey, unsigned int, CornerKeyHash> vertexIndices;
 
-        // Loop through each shape
-        for(const auto &shape: shapes)
+    // Loop through each shape
+    for(const auto &shape: shapes)
+    {
+        // Loop through all of the indices of the given shape to construct Vertices
+        for(const auto &index: shape.mesh.indices)
         {
-            // Loop through all of the indices of the given shape to construct Vertices
-            for(const auto &index: shape.mesh.indices)
+            CornerKey key = { index.vertex_index, index.texcoord_index, index.normal_index };
+            auto existingIt = vertexIndices.find(key);
+            if(existingIt != vertexIndices.end())
             {
-                glm::vec3 pos(0.0f);
-                // 3 * index is here because each vertex has 3 position coordinates
-                // Acts basically the same way as the stride for OpenGL vert attrib ptrs
-                {
-                    float x = attrib.vertices[(3 * index.vertex_index) + 0];
-                    float y = attrib.vertices[(3 * index.vertex_index) + 1];
-                    float z = attrib.vertices[(3 * index.vertex_index) + 2];
-                    pos = glm::vec3(x, y, z);
-                }
+                indices.push_back(existingIt->second);
+                continue;
+            }
 
-                glm::vec2 uv(0.0f);
-                // Only include UV coordinates if they are present
-                if(index.texcoord_index >= 0)
-                {
-                    // The OBJ file format uses the coordinate system of 0 being the bottom of the image.
-                    // OpenGL uses a system where 1 is the bottom of the image, therefore the
-                    // vertical UV coordinate must be flipped
-                    float u = attrib.texcoords[(2 * index.texcoord_index) + 0];
-                    float v = 1.0f - attrib.texcoords[(2 * index.texcoord_index) + 1];
-                    uv = glm::vec2(u, v);
-                }
+            glm::vec3 pos(0.0f);
+            // 3 * index is here because each vertex has 3 position coordinates
+            // Acts basically the same way as the stride for OpenGL vert attrib ptrs
+            {
+                float x = attrib.vertices[(3 * index.vertex_index) + 0];
+                float y = attrib.vertices[(3 * index.vertex_index) + 1];
+                float z = attrib.vertices[(3 * index.vertex_index) + 2];
+                pos = glm::vec3(x, y, z);
+            }
 
-                glm::vec3 normal(0.0f);
-                if(index.normal_index >= 0)
-                {
-                    float x = attrib.normals[(3 * index.normal_index) + 0];
-                    float y = attrib.normals[(3 * index.normal_index) + 1]; 
-                    float z = attrib.normals[(3 * index.normal_index) + 2]; 
-                    normal = glm::vec3(x, y, z);
-                }
+            glm::vec2 uv(0.0f);
+            // Only include UV coordinates if they are present
+            if(index.texcoord_index >= 0)
+            {
+                // The OBJ file format uses the coordinate system of 0 being the bottom of the image.
+                // OpenGL uses a system where 1 is the bottom of the image, therefore the
+                // vertical UV coordinate must be flipped
+                float u = attrib.texcoords[(2 * index.texcoord_index) + 0];
+                float v = 1.0f - attrib.texcoords[(2 * index.texcoord_index) + 1];
+                uv = glm::vec2(u, v);
+            }
 
-                Vertex newVert(pos, uv, normal);
-                vertices.push_back(std::move(newVert));
+            glm::vec3 normal(0.0f);
+            if(index.normal_index >= 0)
+            {
+                float x = attrib.normals[(3 * index.normal_index) + 0];
+                float y = attrib.normals[(3 * index.normal_index) + 1]; 
+                float z = attrib.normals[(3 * index.normal_index) + 2]; 
+                normal = glm::vec3(x, y, z);
             }
-        }
 
-        std::string name = ParseFileNameAndExtension(path).first;
-        Model *model = new Model(std::move(vertices));
-        AddLoadedModel(model, name);
-        return model;
-    }
-    else
-    {
-        Log::LogError(reader.Error());
-        return nullptr;
+            Vertex newVert(pos, uv, normal);
+            unsigned int newIndex = (unsigned int)vertices.size();
+            vertices.push_back(std::move(newVert));
+            vertexIndices.insert(std::make_pair(key, newIndex));
+            indices.push_back(newIndex);
+        }
     }
+
+    return true;
 }
-const Model* const ResourceManager::GetModel(const std::string &name)
+const Model* const ResourceManager::GetModel(const std::string &path)
 {
-    for(const auto &model: _loadedModels)
-        {
-            if(model.first.compare(name) == 0)
-            {
-                return _loadedModels[model.first];
-            }
-        }
-        Log::LogWarning("Couldn't find model '" + name + "' among loaded models");
-        return nullptr;
+    auto it = _loadedModels.find(CanonicalizePath(path));
+    if(it != _loadedModels.end())
+    {
+        return it->second;
+    }
+    Log::LogWarning("Couldn't find model '" + path + "' among loaded models");
+    return nullptr;
 }
-void ResourceManager::AddLoadedModel(Model *model, std::string name)
+void ResourceManager::AddLoadedModel(Model *model, std::string path)
 {
     if(model != nullptr)
     {
-        _loadedModels.insert(std::make_pair(name, model));
+        _loadedModels.insert(std::make_pair(CanonicalizePath(path), model));
     }
 }
-void ResourceManager::UnloadModel(const std::string &name)
+void ResourceManager::UnloadModel(const std::string &path)
 {
-    for(const auto &model: _loadedModels)
+    std::string canonicalPath = CanonicalizePath(path);
+    auto it = _loadedModels.find(canonicalPath);
+    if(it != _loadedModels.end())
     {
-        if(model.first.compare(name) == 0)
+        Model *model = it->second;
+        _loadedModels.erase(it);
+
+        // Only forget the contents of the model once no other path shares it anymore
+        bool isShared = false;
+        for(const auto &entry: _loadedModels)
         {
-            _loadedModels.erase(name);
-            Log::LogInfo("Unloaded model '" + name + "'");
-            return;
+            if(entry.second == model)
+            {
+                isShared = true;
+                break;
+            }
         }
+        if(!isShared)
+        {
+            for(auto hashIt = _modelContentHashes.begin(); hashIt != _modelContentHashes.end(); hashIt++)
+            {
+                if(hashIt->second.resource == model)
+                {
+                    _modelContentHashes.erase(hashIt);
+                    break;
+                }
+            }
+        }
+
+        Log::LogInfo("Unloaded model '" + canonicalPath + "'");
+        return;
     }
 
-    Log::LogInfo("Failed unloading model '" + name +"', model not among loaded models");
+    Log::LogInfo("Failed unloading model '" + canonicalPath +"', model not among loaded models");
 }
 #pragma endregion
\ No newline at end of file
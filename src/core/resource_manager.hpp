@@ -4,16 +4,69 @@
 #include "rendering/shader.hpp"
 #include "rendering/texture.hpp"
 #include "rendering/model.hpp"
+#include "file_watcher.hpp"
 
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <memory>
 #include <utility>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
 
+// Shaders are keyed by their name, textures and models are keyed by the canonical path of the file they were loaded from
 using LoadedShadersMap = std::unordered_map<std::string, Shader*>;
 using LoadedTexturesMap = std::unordered_map<std::string, Texture*>;
 using LoadedModelsMap = std::unordered_map<std::string, Model*>;
 
+// Holds how many resources ended up sharing a GPU object with an already loaded resource
+// of identical contents and how much memory that saved
+struct DeduplicationStats
+{
+    unsigned int sharedTextures = 0;
+    unsigned int sharedModels = 0;
+    size_t textureBytesSaved = 0;
+    size_t modelBytesSaved = 0;
+};
+
+// A resource known by the hash of its file's contents. Hashes can collide, so before sharing the resource
+// the contents of a new file get compared with the file the hash was taken of
+template<typename T>
+struct ContentHashEntry
+{
+    T *resource = nullptr;
+    std::string path;
+};
+
+// The preprocessed sources of a shader and the programs compiled from them.
+// Every combination of the variant keys declared in the sources (see ShaderPreprocessor) is its own program.
+// A variant gets compiled the first time it's selected and is then cached by the bitmask of its enabled keys
+struct ShaderVariantSet
+{
+    // Canonical paths of the files the shader was built from, used for hot-reloading
+    std::string vertPath;
+    std::string fragPath;
+    std::vector<std::string> includedFiles;
+
+    // Preprocessed sources without any variant #defines
+    std::string vertSource;
+    std::string fragSource;
+    std::vector<std::string> variantKeys;
+
+    uint32_t activeMask = 0;
+    // The mask that was selected last, differs from the active mask while its variant is compiling
+    uint32_t requestedMask = 0;
+    // The variants that aren't in use right now. The active variant's program lives in the loaded Shader itself
+    // so that everything holding a pointer to the shader keeps working when switching variants
+    std::unordered_map<uint32_t, Shader*> inactiveVariants;
+
+    bool UsesFile(const std::string &path) const
+    {
+        return vertPath == path || fragPath == path || std::find(includedFiles.begin(), includedFiles.end(), path) != includedFiles.end();
+    }
+};
+
 class ResourceManager final : public Singleton<ResourceManager>
 {
     friend class Singleton<ResourceManager>;
@@ -22,6 +75,19 @@ class ResourceManager final : public Singleton<ResourceManager>
     LoadedShadersMap _loadedShaders;
     LoadedTexturesMap _loadedTextures;
     LoadedModelsMap _loadedModels;
+    // Names of the shaders that are still being compiled by the ShaderCompiler
+    std::unordered_set<std::string> _pendingShaders;
+
+    // Content hash -> resource, used to make identical files share one GPU object
+    std::unordered_map<uint64_t, ContentHashEntry<Texture>> _textureContentHashes;
+    std::unordered_map<uint64_t, ContentHashEntry<Model>> _modelContentHashes;
+    DeduplicationStats _dedupStats;
+
+    // Hot-reloading
+    FileWatcher _fileWatcher;
+    std::unordered_map<std::string, ShaderVariantSet> _shaderVariantSets;
+    // Increases with every reload of a shader so that a slow compile can't overwrite the result of a newer edit
+    std::unordered_map<std::string, unsigned int> _shaderReloadGenerations;
 
     private:
     ResourceManager() = default;
@@ -38,22 +104,60 @@ class ResourceManager final : public Singleton<ResourceManager>
     inline const LoadedShadersMap  &getLoadedShaders()  { return _loadedShaders;  }
     inline const LoadedTexturesMap &getLoadedTextures() { return _loadedTextures; }
     inline const LoadedModelsMap   &getLoadedModels()   { return _loadedModels; }
+    inline const DeduplicationStats &getDeduplicationStats() const { return _dedupStats; }
+
+    // Starts/stops watching the files of the loaded shaders and textures for changes
+    void Init();
+    void DeInit();
+    // Reloads the shaders and textures whose files changed on disk, must be called once per frame on the GL thread.
+    // Returns true if any of the watched files changed
+    bool Update();
 
     static std::string ReadFile(const std::string &path);
+    static std::vector<unsigned char> ReadBinaryFile(const std::string &path);
     static std::pair<std::string, std::string> ParseFileNameAndExtension(const std::string &path);
+    // Returns the absolute, normalized version of the path so that the same file always maps to the same key
+    static std::string CanonicalizePath(const std::string &path);
+
+    void LogDeduplicationReport() const;
 
     Shader *LoadShaderFromFiles(const std::string &vertShaderPath, const std::string &fragShaderPath);
+    // Compiles the shader over the next frames without blocking.
+    // The shader only gets added to the loaded shaders (and becomes selectable) once it's linked
+    void LoadShaderFromFilesAsync(const std::string &vertShaderPath, const std::string &fragShaderPath);
+    inline size_t getPendingShaderCount() const { return _pendingShaders.size(); }
     const Shader* const GetShader(const std::string &name);
     void AddLoadedShader(Shader *shader, std::string name);
     void UnloadShader(const std::string &name);
+    // Recompiles the shader in the background and swaps the new program in once it's linked.
+    // The old program stays in use if the new one fails to compile
+    void ReloadShader(const std::string &name);
+    // Returns nullptr if there's no shader of that name
+    const ShaderVariantSet *GetShaderVariantSet(const std::string &name) const;
+    // Switches the shader to the variant with the given keys enabled. A variant that hasn't been used before
+    // gets compiled in the background first, the shader keeps using the current variant until then
+    void SetShaderVariant(const std::string &name, uint32_t mask);
 
-    Texture *LoadTextureFromFile(const std::string &path);
-    const Texture* const GetTexture(const std::string &name);
-    void AddLoadedTexture(Texture *texture, std::string name);
-    void UnloadTexture(const std::string &name);
+    // Streamed textures only get their smaller mip levels uploaded at first, see TextureStreamer
+    Texture *LoadTextureFromFile(const std::string &path, bool allowStreaming = true);
+    const Texture* const GetTexture(const std::string &path);
+    void AddLoadedTexture(Texture *texture, std::string path);
+    void UnloadTexture(const std::string &path);
+    // Decodes the file again and replaces the image of the already loaded texture with it
+    void ReloadTexture(const std::string &path);
 
     Model *LoadModelFromOBJFile(const std::string &path);
-    const Model* const GetModel(const std::string &name);
-    void AddLoadedModel(Model *model, std::string name);
-    void UnloadModel(const std::string &name);
+    // Turns the contents of an OBJ file into indexed vertices without touching GL or the loaded resources,
+    // so it's safe to call from any thread. Returns false and sets the error if the file couldn't be parsed
+    static bool ParseOBJ(const std::string &objFileContents, std::vector<Vertex> &vertices, std::vector<unsigned int> &indices, std::string &error);
+    const Model* const GetModel(const std::string &path);
+    void AddLoadedModel(Model *model, std::string path);
+    void UnloadModel(const std::string &path);
+
+    private:
+    static bool PreprocessShader(const std::string &vertShaderPath, const std::string &fragShaderPath, ShaderVariantSet &variantSet);
+    static std::pair<std::string, std::string> GetVariantSources(const ShaderVariantSet &variantSet, uint32_t mask);
+    void AddShaderVariantSet(const std::string &name, ShaderVariantSet variantSet);
+    // Makes the loaded shader use the given program. The previous program is either kept as an inactive variant or deleted
+    void ActivateShaderVariant(const std::string &name, uint32_t mask, Shader *variant, bool keepPrevious);
 };
\ No newline at end of file
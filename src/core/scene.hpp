@@ -5,8 +5,20 @@
 #include "rendering/texture.hpp"
 #include "rendering/model.hpp"
 
+#include <glm/mat4x4.hpp>
+
 #include <vector>
 
+// A single object placed in the scene.
+// Objects sharing the same model and shader get drawn together in one instanced draw call
+struct SceneObject
+{
+    // nullptr uses the scene's current model/shader, the ones that are opened in the UI
+    Model *model = nullptr;
+    Shader *shader = nullptr;
+    glm::mat4 transform = glm::mat4(1.0f);
+};
+
 struct Scene final: public Singleton<Scene>
 {
     friend class Singleton<Scene>;
@@ -14,6 +26,12 @@ struct Scene final: public Singleton<Scene>
     Model *model = nullptr;
     Shader *shader = nullptr;
     std::vector<Texture*> textures;
+    // Applied on top of the transform of every object in the scene
+    glm::mat4 modelMatrix = glm::mat4(1.0f);
+    // Slowly turns the model around, which keeps the viewer drawing every frame for as long as it's on
+    bool spinModel = false;
+    // Starts out as a single object showing the current model
+    std::vector<SceneObject> objects = { SceneObject() };
 
     private:
     Scene() = default;
@@ -22,5 +40,6 @@ struct Scene final: public Singleton<Scene>
         model = nullptr;
         shader = nullptr;
         textures.clear();
+        objects.clear();
     }
 };
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include "thumbnail_batch.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stb/stb_image_write.h>
+
+#include "core/log.hpp"
+#include "core/cpu_profiler.hpp"
+#include "core/resource_manager.hpp"
+#include "core/scene.hpp"
+#include "rendering/renderer.hpp"
+#include "rendering/render_target.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+
+namespace fs = std::filesystem;
+
+void ThumbnailBatch::StageStats::Record(Clock::time_point start, Clock::time_point end, bool succeeded)
+{
+    if(succeeded)
+        processed++;
+    else
+        failed++;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    firstStart = std::min(firstStart, start);
+    lastEnd = std::max(lastEnd, end);
+    busySeconds += std::chrono::duration<double>(end - start).count();
+}
+
+ThumbnailBatch::ThumbnailBatch(const CommandLineOptions &options)
+    : _options(options),
+    _threads(options.threads != 0 ? options.threads : std::max(std::thread::hardware_concurrency() / 2, 1u)),
+    // Parsed models and raw images are large, so only a few of them may wait in between the stages
+    _renderQueue(2 * _threads), _encodeQueue(2 * _threads)
+{
+}
+
+int ThumbnailBatch::Run()
+{
+    if(!CollectAssets())
+        return -1;
+    if(_assets.empty())
+    {
+        Log::LogWarning("No models found to render thumbnails of");
+        return 0;
+    }
+    Log::LogInfo("Rendering thumbnails of " + std::to_string(_assets.size()) + " models on " + std::to_string(_threads) + " parse and encode threads");
+
+    auto batchStart = Clock::now();
+
+    // The paths are tiny, so the whole list gets queued up front
+    for(const Asset &asset: _assets)
+        _parseQueue.Push(asset);
+    _parseQueue.Close();
+
+    // The last parse worker to run out of work lets the render loop know nothing else is coming
+    std::atomic<unsigned int> activeParseWorkers = _threads;
+    std::vector<std::thread> parseWorkers, encodeWorkers;
+    for(unsigned int i = 0; i < _threads; i++)
+    {
+        parseWorkers.emplace_back([this, &activeParseWorkers]()
+        {
+            ParseWorker();
+            if(--activeParseWorkers == 0)
+                _renderQueue.Close();
+        });
+        encodeWorkers.emplace_back(&ThumbnailBatch::EncodeWorker, this);
+    }
+
+    RenderLoop();
+    _encodeQueue.Close();
+
+    for(std::thread &worker: parseWorkers)
+        worker.join();
+    for(std::thread &worker: encodeWorkers)
+        worker.join();
+
+    double totalSeconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+    printf("\nThumbnail batch finished in %.2f s (%.1f assets/s overall)\n", totalSeconds, _encodeStats.processed / std::max(totalSeconds, 1e-6));
+    PrintStageStats("Parse", _parseStats, _threads);
+    PrintStageStats("Render", _renderStats, 1);
+    PrintStageStats("Encode", _encodeStats, _threads);
+
+    unsigned int failed = _parseStats.failed + _renderStats.failed + _encodeStats.failed;
+    if(failed > 0)
+        printf("%u of %zu assets failed, see the log above\n", failed, _assets.size());
+    return failed > 0 ? 1 : 0;
+}
+
+void ThumbnailBatch::FrameBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float aspectRatio, glm::mat4 &view, glm::mat4 &projection, glm::vec3 &position)
+{
+    const float FOV = glm::radians(35.0f);
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    // The bounding sphere fits into the frustum no matter which way the camera looks at it
+    float radius = std::max(glm::length(boundsMax - boundsMin) * 0.5f, 0.0001f);
+    // The narrower of the two FOVs decides how far back the camera has to be
+    float halfFOV = FOV * 0.5f;
+    if(aspectRatio < 1.0f)
+        halfFOV = std::atan(std::tan(halfFOV) * aspectRatio);
+    float distance = radius / std::sin(halfFOV);
+
+    glm::vec3 direction = glm::normalize(glm::vec3(1.0f, 0.6f, 1.0f));
+    position = center + direction * distance;
+    view = glm::lookAt(position, center, glm::vec3(0.0f, 1.0f, 0.0f));
+    // Tight near and far planes keep the depth precision where the model is
+    projection = glm::perspective(FOV, aspectRatio, std::max(distance - radius * 1.1f, distance * 0.001f), distance + radius * 1.1f);
+}
+
+bool ThumbnailBatch::CollectAssets()
+{
+    auto isOBJ = [](const fs::path &path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+        return extension == ".obj";
+    };
+
+    std::error_code error;
+    for(const std::string &input: _options.batchInputs)
+    {
+        fs::path inputPath(input);
+        if(fs::is_directory(inputPath, error))
+        {
+            // Mirroring the directory structure keeps models of the same name in different folders apart
+            for(const fs::directory_entry &entry: fs::recursive_directory_iterator(inputPath, fs::directory_options::skip_permission_denied, error))
+            {
+                if(!entry.is_regular_file(error) || !isOBJ(entry.path()))
+                    continue;
+
+                Asset asset;
+                asset.path = entry.path().string();
+                asset.outputName = fs::relative(entry.path(), inputPath, error).replace_extension().generic_string();
+                _assets.push_back(asset);
+            }
+        }
+        else if(fs::is_regular_file(inputPath, error) && isOBJ(inputPath))
+        {
+            Asset asset;
+            asset.path = inputPath.string();
+            asset.outputName = inputPath.stem().string();
+            _assets.push_back(asset);
+        }
+        else if(fs::is_regular_file(inputPath, error))
+        {
+            // A list of models, one per line. Relative paths are relative to the list itself
+            std::ifstream listFile(inputPath);
+            std::string line;
+            while(std::getline(listFile, line))
+            {
+                line.erase(0, line.find_first_not_of(" \t\r"));
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if(line.empty() || line[0] == '#')
+                    continue;
+
+                fs::path modelPath(line);
+                if(modelPath.is_relative())
+                    modelPath = inputPath.parent_path() / modelPath;
+
+                Asset asset;
+                asset.path = modelPath.string();
+                asset.outputName = modelPath.stem().string();
+                _assets.push_back(asset);
+            }
+        }
+        else
+        {
+            Log::LogError("Batch input '" + input + "' is neither a directory, an OBJ file nor a list of models");
+            return false;
+        }
+    }
+    return true;
+}
+
+void ThumbnailBatch::ParseWorker()
+{
+    CPUProfiler::getInstance().SetThreadName("Parse worker");
+
+    Asset asset;
+    while(_parseQueue.Pop(asset))
+    {
+        PROFILE_ZONE("Parse model");
+        auto start = Clock::now();
+
+        ParsedAsset parsed;
+        parsed.asset = std::move(asset);
+        // ReadFile logs why a file couldn't be read
+        std::string contents = ResourceManager::ReadFile(parsed.asset.path);
+        if(contents.empty())
+            parsed.error = "Couldn't read '" + parsed.asset.path + "' or it's empty";
+        else if(!ResourceManager::ParseOBJ(contents, parsed.vertices, parsed.indices, parsed.error))
+            parsed.error = "Failed parsing '" + parsed.asset.path + "': " + parsed.error;
+        else if(parsed.indices.empty())
+            parsed.error = "'" + parsed.asset.path + "' doesn't have any faces";
+
+        _parseStats.Record(start, Clock::now(), parsed.error.empty());
+        if(!parsed.error.empty())
+        {
+            Log::LogError(parsed.error);
+            continue;
+        }
+        _renderQueue.Push(std::move(parsed));
+    }
+}
+
+void ThumbnailBatch::RenderLoop()
+{
+    Renderer &renderer = Renderer::getInstance();
+    Scene &scene = Scene::getInstance();
+
+    // Every thumbnail is a single model, culling would only cost time
+    renderer.settings.frustumCulling = false;
+    renderer.settings.occlusionCulling = false;
+    scene.objects = { SceneObject() };
+    scene.modelMatrix = glm::mat4(1.0f);
+
+    // Rendered once at the largest size, the smaller ones get scaled down from it by the encode workers
+    unsigned int size = *std::max_element(_options.thumbnailSizes.begin(), _options.thumbnailSizes.end());
+    RenderTarget target(glm::uvec2(size, size));
+
+    ParsedAsset parsed;
+    while(_renderQueue.Pop(parsed))
+    {
+        PROFILE_ZONE("Render thumbnail");
+        auto start = Clock::now();
+
+        Model *model = new Model(std::move(parsed.vertices), std::move(parsed.indices));
+
+        CameraData camera;
+        FrameBounds(model->getBoundsMin(), model->getBoundsMax(), 1.0f, camera.view, camera.projection, camera.position);
+        camera.viewportSize = target.getSize();
+        renderer.SetCamera(camera);
+
+        scene.model = model;
+        target.Bind();
+        renderer.DrawScene();
+
+        RenderedAsset rendered;
+        rendered.asset = std::move(parsed.asset);
+        rendered.pixels = target.ReadPixels();
+        rendered.size = size;
+
+        // Reading the pixels waited for the GPU, so the model's geometry can be freed right away
+        scene.model = nullptr;
+        delete model;
+
+        _renderStats.Record(start, Clock::now(), true);
+        _encodeQueue.Push(std::move(rendered));
+    }
+}
+
+void ThumbnailBatch::EncodeWorker()
+{
+    CPUProfiler::getInstance().SetThreadName("Encode worker");
+
+    RenderedAsset rendered;
+    while(_encodeQueue.Pop(rendered))
+    {
+        PROFILE_ZONE("Encode thumbnail");
+        auto start = Clock::now();
+        bool succeeded = true;
+
+        fs::path outputBase = fs::path(_options.outputDirectory) / rendered.asset.outputName;
+        std::error_code error;
+        fs::create_directories(outputBase.parent_path(), error);
+
+        std::vector<unsigned char> scaled;
+        for(unsigned int size: _options.thumbnailSizes)
+        {
+            const unsigned char *pixels = rendered.pixels.data();
+            if(size != rendered.size)
+            {
+                // Box filter, every output pixel averages the block of source pixels it covers
+                scaled.resize((size_t)size * size * 4);
+                for(unsigned int y = 0; y < size; y++)
+                {
+                    unsigned int sourceY0 = y * rendered.size / size, sourceY1 = std::max((y + 1) * rendered.size / size, sourceY0 + 1);
+                    for(unsigned int x = 0; x < size; x++)
+                    {
+                        unsigned int sourceX0 = x * rendered.size / size, sourceX1 = std::max((x + 1) * rendered.size / size, sourceX0 + 1);
+                        unsigned int sum[4] = { 0, 0, 0, 0 };
+                        for(unsigned int sourceY = sourceY0; sourceY < sourceY1; sourceY++)
+                        {
+                            const unsigned char *row = rendered.pixels.data() + ((size_t)sourceY * rendered.size + sourceX0) * 4;
+                            for(unsigned int i = 0; i < (sourceX1 - sourceX0) * 4; i++)
+                                sum[i % 4] += row[i];
+                        }
+                        unsigned int count = (sourceX1 - sourceX0) * (sourceY1 - sourceY0);
+                        for(int channel = 0; channel < 4; channel++)
+                            scaled[((size_t)y * size + x) * 4 + channel] = (unsigned char)(sum[channel] / count);
+                    }
+                }
+                pixels = scaled.data();
+            }
+
+            std::string outputPath = outputBase.string() + "_" + std::to_string(size) + ".png";
+            if(stbi_write_png(outputPath.c_str(), (int)size, (int)size, 4, pixels, (int)size * 4) == 0)
+            {
+                Log::LogError("Failed writing thumbnail '" + outputPath + "'");
+                succeeded = false;
+            }
+        }
+
+        _encodeStats.Record(start, Clock::now(), succeeded);
+    }
+}
+
+void ThumbnailBatch::PrintStageStats(const char *name, StageStats &stats, unsigned int threads) const
+{
+    unsigned int processed = stats.processed;
+    if(processed == 0 && stats.failed == 0)
+    {
+        printf("  %-7s nothing processed\n", name);
+        return;
+    }
+
+    double seconds = std::max(std::chrono::duration<double>(stats.lastEnd - stats.firstStart).count(), 1e-6);
+    // How much of the stage's time span its threads actually spent working rather than waiting on the other stages
+    double utilization = stats.busySeconds / (seconds * threads);
+    printf("  %-7s %6u assets in %7.2f s, %8.1f assets/s (%u thread%s, %3.0f%% busy)\n",
+        name, processed, seconds, processed / seconds, threads, threads == 1 ? "" : "s", utilization * 100.0);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "command_line.hpp"
+#include "misc/concurrent_queue.hpp"
+#include "rendering/model.hpp"
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+
+// Renders preview images of lots of models in one go. Work is split into three stages that all run at the same time:
+// worker threads read and parse the OBJ files, the GL thread renders them, and worker threads again scale and encode the PNGs.
+// The queues in between the stages are bounded so a slow stage holds the others back instead of piling up memory
+class ThumbnailBatch
+{
+    private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Asset
+    {
+        std::string path;
+        // Path of the output images without the size suffix and extension, relative to the output directory
+        std::string outputName;
+    };
+    struct ParsedAsset
+    {
+        Asset asset;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        std::string error;
+    };
+    struct RenderedAsset
+    {
+        Asset asset;
+        // RGBA8, top row first, rendered at the largest requested size
+        std::vector<unsigned char> pixels;
+        unsigned int size = 0;
+    };
+
+    // Per-stage counters, the time span runs from the first item the stage started on to the last one it finished
+    struct StageStats
+    {
+        std::atomic<unsigned int> processed = 0;
+        std::atomic<unsigned int> failed = 0;
+        std::mutex mutex;
+        Clock::time_point firstStart = Clock::time_point::max();
+        Clock::time_point lastEnd = Clock::time_point::min();
+        // Summed over all of the stage's threads
+        double busySeconds = 0.0;
+
+        void Record(Clock::time_point start, Clock::time_point end, bool succeeded);
+    };
+
+    const CommandLineOptions &_options;
+    std::vector<Asset> _assets;
+    // Used by both the parse and the encode stage
+    unsigned int _threads;
+
+    ConcurrentQueue<Asset> _parseQueue;
+    ConcurrentQueue<ParsedAsset> _renderQueue;
+    ConcurrentQueue<RenderedAsset> _encodeQueue;
+
+    StageStats _parseStats;
+    StageStats _renderStats;
+    StageStats _encodeStats;
+
+    public:
+    explicit ThumbnailBatch(const CommandLineOptions &options);
+    ThumbnailBatch(const ThumbnailBatch &other) = delete;
+    ThumbnailBatch &operator=(const ThumbnailBatch &other) = delete;
+
+    public:
+    // Must be called on the thread the GL context is current on, after the renderer was initialized.
+    // Returns the process exit code
+    int Run();
+
+    // Camera looking at the bounds from above and to the side, pulled back just far enough for the whole box to fit
+    static void FrameBounds(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax, float aspectRatio, glm::mat4 &view, glm::mat4 &projection, glm::vec3 &position);
+
+    private:
+    // Fills _assets from the directories (searched recursively for .obj files) and list files (one path per line)
+    bool CollectAssets();
+
+    void ParseWorker();
+    void RenderLoop();
+    void EncodeWorker();
+
+    void PrintStageStats(const char *name, StageStats &stats, unsigned int threads) const;
+};
@@ -0,0 +1,183 @@
+#include "turntable_capture.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <stb/stb_image_write.h>
+
+#include "core/log.hpp"
+#include "core/scene.hpp"
+#include "core/thumbnail_batch.hpp"
+#include "rendering/renderer.hpp"
+#include "rendering/render_target.hpp"
+#include "rendering/async_readback.hpp"
+
+#include <filesystem>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cctype>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+TurntableCapture::TurntableCapture(const CommandLineOptions &options)
+    : _options(options), _toStandardOutput(options.outputPath == "-"),
+    // Frames have to reach stdout in order, which only a single writer guarantees. Image files can be written in any order
+    _writerCount(_toStandardOutput ? 1 : (options.threads != 0 ? options.threads : std::max(std::thread::hardware_concurrency() / 2, 1u))),
+    _writeQueue(READBACK_SLOTS + 2 * _writerCount)
+{
+}
+
+int TurntableCapture::Run()
+{
+    if(!_toStandardOutput && !MakePathFormat(_options.outputPath, _pathFormat))
+    {
+        Log::LogError("The output path '" + _options.outputPath + "' may only contain a single %d conversion for the frame number");
+        return -1;
+    }
+
+    Renderer &renderer = Renderer::getInstance();
+    Scene &scene = Scene::getInstance();
+    glm::uvec2 size(_options.width, _options.height);
+
+    // Without a model the renderer falls back to its unit cube
+    glm::vec3 boundsMin(-0.5f), boundsMax(0.5f);
+    if(scene.model != nullptr)
+    {
+        boundsMin = scene.model->getBoundsMin();
+        boundsMax = scene.model->getBoundsMax();
+    }
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+
+    CameraData camera;
+    glm::mat4 startView;
+    glm::vec3 startPosition;
+    ThumbnailBatch::FrameBounds(boundsMin, boundsMax, (float)size.x / (float)size.y, startView, camera.projection, startPosition);
+    camera.viewportSize = size;
+
+    float step = _options.turntableStep != 0.0f ? glm::radians(_options.turntableStep) : glm::radians(360.0f) / (float)_options.turntableFrames;
+
+    if(_toStandardOutput)
+    {
+        #ifdef _WIN32
+            _setmode(_fileno(stdout), _O_BINARY);
+        #endif
+        Log::LogInfo("Writing " + std::to_string(_options.turntableFrames) + " raw RGBA frames of " + std::to_string(size.x) + "x" + std::to_string(size.y) + " to stdout");
+    }
+    else
+    {
+        char firstPath[1024];
+        snprintf(firstPath, sizeof(firstPath), _pathFormat.c_str(), 0);
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::path(firstPath).parent_path();
+        if(!directory.empty())
+            std::filesystem::create_directories(directory, error);
+        Log::LogInfo("Writing " + std::to_string(_options.turntableFrames) + " frames to '" + _pathFormat + "' on " + std::to_string(_writerCount) + " threads");
+    }
+
+    std::vector<std::thread> writers;
+    for(unsigned int i = 0; i < _writerCount; i++)
+        writers.emplace_back(&TurntableCapture::WriterLoop, this);
+
+    RenderTarget target(size);
+    AsyncReadback readback(size, READBACK_SLOTS);
+    CapturedFrame captured;
+
+    auto captureStart = std::chrono::steady_clock::now();
+    for(unsigned int frame = 0; frame < _options.turntableFrames; frame++)
+    {
+        // Hand over whatever the GPU already finished, and only wait for it once every pixel buffer is in flight
+        while(readback.Collect(captured.pixels, captured.index, false))
+            HandOver(captured);
+        if(readback.isFull() && readback.Collect(captured.pixels, captured.index, true))
+            HandOver(captured);
+
+        // Spinning the world around the model's center is the same as the camera circling it
+        glm::mat4 spin = glm::translate(glm::mat4(1.0f), center) * glm::rotate(glm::mat4(1.0f), step * (float)frame, glm::vec3(0.0f, 1.0f, 0.0f)) * glm::translate(glm::mat4(1.0f), -center);
+        camera.view = startView * spin;
+        camera.position = glm::vec3(glm::inverse(camera.view)[3]);
+        renderer.SetCamera(camera);
+        renderer.SetTime((float)frame / 60.0f);
+
+        target.Bind();
+        renderer.DrawScene();
+        readback.Start(target.getFramebuffer(), frame);
+    }
+    while(readback.Collect(captured.pixels, captured.index, true))
+        HandOver(captured);
+    double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - captureStart).count();
+
+    _writeQueue.Close();
+    for(std::thread &writer: writers)
+        writer.join();
+    double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - captureStart).count();
+
+    const AsyncReadbackStats &readbackStats = readback.getStats();
+    Log::LogInfo("Rendered " + std::to_string(_options.turntableFrames) + " frames in " + std::to_string(renderSeconds) + " s ("
+        + std::to_string(_options.turntableFrames / std::max(renderSeconds, 1e-6)) + " fps), written out after " + std::to_string(totalSeconds) + " s");
+    Log::LogInfo("Readback stalls: " + std::to_string(readbackStats.stalls) + " (" + std::to_string(readbackStats.stallTimeMs) + " ms), waiting on writers: "
+        + std::to_string(_writerWaitSeconds * 1000.0) + " ms");
+
+    if(_failedWrites > 0)
+    {
+        Log::LogError("Failed writing " + std::to_string(_failedWrites) + " frames");
+        return -1;
+    }
+    return 0;
+}
+
+bool TurntableCapture::MakePathFormat(const std::string &outputPath, std::string &format)
+{
+    size_t conversion = outputPath.find('%');
+    if(conversion == std::string::npos)
+    {
+        std::filesystem::path path(outputPath);
+        format = (path.parent_path() / path.stem()).string() + "_%04d" + path.extension().string();
+        return true;
+    }
+
+    // Only a zero padded width is allowed in between, anything else could read arguments that aren't there
+    size_t end = conversion + 1;
+    while(end < outputPath.size() && std::isdigit((unsigned char)outputPath[end]))
+        end++;
+    if(end >= outputPath.size() || outputPath[end] != 'd' || outputPath.find('%', end) != std::string::npos)
+        return false;
+
+    format = outputPath;
+    return true;
+}
+
+void TurntableCapture::HandOver(CapturedFrame &frame)
+{
+    // Only blocks when the writers fall behind by more than the queue holds
+    auto waitStart = std::chrono::steady_clock::now();
+    _writeQueue.Push(std::move(frame));
+    _writerWaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+    frame = CapturedFrame();
+}
+
+void TurntableCapture::WriterLoop()
+{
+    CapturedFrame frame;
+    while(_writeQueue.Pop(frame))
+    {
+        if(_toStandardOutput)
+        {
+            if(fwrite(frame.pixels.data(), 1, frame.pixels.size(), stdout) != frame.pixels.size())
+                _failedWrites++;
+            continue;
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), _pathFormat.c_str(), (int)frame.index);
+        if(stbi_write_png(path, (int)_options.width, (int)_options.height, 4, frame.pixels.data(), (int)_options.width * 4) == 0)
+            _failedWrites++;
+    }
+
+    if(_toStandardOutput)
+        fflush(stdout);
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "command_line.hpp"
+#include "misc/concurrent_queue.hpp"
+
+#include <string>
+#include <vector>
+#include <atomic>
+
+// Records a turntable of the current model: the camera circles it at a fixed angular step and every frame is read back
+// through a ring of pixel buffers, so the GL thread never waits on glReadPixels. Background threads write the frames out,
+// either as a numbered PNG sequence or as raw RGBA8 frames on stdout for piping into an encoder
+class TurntableCapture
+{
+    public:
+    // Pixel buffers in flight, enough for the GPU to be a few frames behind without the CPU waiting on it
+    static constexpr unsigned int READBACK_SLOTS = 4;
+
+    private:
+    struct CapturedFrame
+    {
+        unsigned long long index = 0;
+        // RGBA8, top row first
+        std::vector<unsigned char> pixels;
+    };
+
+    const CommandLineOptions &_options;
+    bool _toStandardOutput = false;
+    // printf format of the image paths with a single integer conversion for the frame index
+    std::string _pathFormat;
+    unsigned int _writerCount = 1;
+
+    ConcurrentQueue<CapturedFrame> _writeQueue;
+    std::atomic<unsigned int> _failedWrites = 0;
+    // Time the GL thread spent waiting for the writers to make room in the queue
+    double _writerWaitSeconds = 0.0;
+
+    public:
+    explicit TurntableCapture(const CommandLineOptions &options);
+    TurntableCapture(const TurntableCapture &other) = delete;
+    TurntableCapture &operator=(const TurntableCapture &other) = delete;
+
+    public:
+    // Must be called on the thread the GL context is current on, after the scene's model and shader were loaded.
+    // Returns the process exit code
+    int Run();
+
+    // "-" means stdout. A path with a single %d style conversion (e.g. frames/spin_%04d.png) is used as it is,
+    // any other path gets _%04d inserted in front of its extension. Returns false for paths with unusable conversions
+    static bool MakePathFormat(const std::string &outputPath, std::string &format);
+
+    private:
+    void HandOver(CapturedFrame &frame);
+    void WriterLoop();
+};
@@ -6,9 +6,20 @@
 
 #include "core/log.hpp"
 #include "core/resource_manager.hpp"
+#include "core/frame_pacer.hpp"
+#include "core/cpu_profiler.hpp"
+#include "rendering/texture_streamer.hpp"
+#include "rendering/geometry_arena.hpp"
+#include "rendering/dynamic_resolution.hpp"
+#include "rendering/gpu_profiler.hpp"
 #include "misc/utils.hpp"
 
+#include <glm/gtc/matrix_transform.hpp>
+
 #include <utility>
+#include <algorithm>
+#include <cstdio>
+#include <cfloat>
 
 #define ARRAY_SIZE(x) sizeof(x)/sizeof(x[0]) 
 
@@ -36,6 +47,7 @@ void UIManager::DeInit()
 
 void UIManager::DrawUI()
 {
+    PROFILE_ZONE("UIManager::DrawUI");
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
@@ -46,12 +58,18 @@ void UIManager::DrawUI()
         DrawRendererPropertiesWindow();
     if(_showShaderProperties)
         DrawShaderPropertiesWindow();
+    if(_showGPUProfiler)
+        DrawGPUProfilerWindow();
     
     #ifdef _DEBUG
     if(_showImGuiDemoWindow)
         ImGui::ShowDemoWindow();
     #endif
 
+    // A widget held with the keyboard or a blinking text cursor changes the UI without any new input arriving
+    if(ImGui::IsAnyItemActive())
+        FramePacer::getInstance().RequestRedraw(1);
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
@@ -121,6 +139,17 @@ void UIManager::DrawMainMenuBar()
             }
         }
 
+        ImGui::Separator();
+        static bool recordCPUZones = CPUProfiler::getInstance().isEnabled();
+        if(ImGui::MenuItem("Record CPU trace", "", &recordCPUZones, true))
+            CPUProfiler::getInstance().SetEnabled(recordCPUZones);
+        if(ImGui::MenuItem("Save CPU trace..."))
+        {
+            std::string path = pfd::save_file("Save CPU trace", "trace.json", {"Chrome trace files", "*.json"}).result();
+            if(!path.empty())
+                CPUProfiler::getInstance().WriteChromeTrace(path);
+        }
+
         ImGui::EndMenu();
     }
     
@@ -128,6 +157,7 @@ void UIManager::DrawMainMenuBar()
     {
         ImGui::MenuItem("Renderer properties", "", &_showRendererProperties, true);
         ImGui::MenuItem("Shader properties", "", &_showShaderProperties, true);
+        ImGui::MenuItem("GPU profiler", "", &_showGPUProfiler, true);
         #ifdef _DEBUG
         ImGui::Separator();
         ImGui::MenuItem("ImGui demo", "", &_showImGuiDemoWindow, true);
@@ -150,6 +180,121 @@ void UIManager::DrawRendererPropertiesWindow()
         static bool renderWireframe = false;
         UIManager::DrawWidgetCheckbox("Draw wireframe", &renderWireframe);
         rendererSettings.renderMode = renderWireframe ? RenderMode::WIREFRAME : RenderMode::TRIANGLES;
+
+        static bool softwareBackend = rendererSettings.backend == RenderBackend::SOFTWARE;
+        UIManager::DrawWidgetCheckbox("Software rasterizer", &softwareBackend);
+        rendererSettings.backend = softwareBackend ? RenderBackend::SOFTWARE : RenderBackend::OPENGL;
+        if(const SoftwareRasterizer *softwareRasterizer = Renderer::getInstance().getSoftwareRasterizer(); softwareRasterizer != nullptr && softwareBackend)
+        {
+            const SoftwareRasterizerStats &softwareStats = softwareRasterizer->getStats();
+            ImGui::Text("Triangles: %u (%u culled, %u clipped, %u tile entries)", softwareStats.triangles, softwareStats.culledTriangles, softwareStats.clippedTriangles, softwareStats.binnedTriangles);
+            ImGui::Text("Vertex %.2f ms, binning %.2f ms, raster %.2f ms on %u threads", softwareStats.vertexTimeMs, softwareStats.binTimeMs, softwareStats.rasterTimeMs, softwareRasterizer->getThreadCount());
+        }
+
+        const RendererStats &rendererStats = Renderer::getInstance().getStats();
+        ImGui::Text("Uniform uploads last frame: %u", rendererStats.uniformUploads);
+        ImGui::Text("Draw calls last frame: %u (%u instances)", rendererStats.drawCalls, rendererStats.instances);
+        UIManager::DrawWidgetCheckbox("Multi-draw indirect", &rendererSettings.multiDrawIndirect);
+        ImGui::Text("Indirect commands: %u (%s)", rendererStats.indirectCommands, rendererStats.usedMultiDrawIndirect ? "multi-draw" : "one draw call each");
+        const GeometryArenaStats arenaStats = GeometryArena::getInstance().getStats();
+        ImGui::Text("Geometry pools: %u (%.2f / %.2f MB used)", arenaStats.pools, arenaStats.usedBytes / (1024.0f * 1024.0f), arenaStats.allocatedBytes / (1024.0f * 1024.0f));
+        const StreamBufferStats &streamStats = Renderer::getInstance().getStreamBuffer().getStats();
+        ImGui::Text("Streamed last frame: %.2f / %.2f KB (%s)", streamStats.usedBytes / 1024.0f, streamStats.frameSize / 1024.0f, streamStats.persistent ? "persistent" : "orphaning");
+        ImGui::Text("Stream buffer stalls: %u (%.2f ms total)", streamStats.stalls, streamStats.stallTimeMs);
+        ImGui::Text("State changes last frame: %u (%u avoided)", rendererStats.stateChanges, rendererStats.stateChangesAvoided);
+
+        UIManager::DrawWidgetCheckbox("Frustum culling", &rendererSettings.frustumCulling);
+        UIManager::DrawWidgetCheckbox("Occlusion culling", &rendererSettings.occlusionCulling);
+        ImGui::Text("Visible objects: %u (%u culled, %u occluded)", rendererStats.visibleObjects, rendererStats.culledObjects, rendererStats.occludedObjects);
+        if(rendererSettings.occlusionCulling)
+            ImGui::Text("Occlusion data is %u frames old", Renderer::getInstance().getHiZBuffer().getStats().latencyFrames);
+        ImGui::Text("Cull time: %.3f ms", rendererStats.cullTimeMs);
+
+        ImGui::Separator();
+
+        static DynamicResolution &dynamicResolution = DynamicResolution::getInstance();
+        UIManager::DrawWidgetCheckbox("Dynamic resolution", &dynamicResolution.settings.enabled);
+        UIManager::DrawWidgetFloat("Target frame time (ms)", &dynamicResolution.settings.targetFrameTimeMs);
+        ImGui::AlignTextToFramePadding();
+        ImGui::Text("Scale range"); ImGui::SameLine();
+        ImGui::PushID("ResolutionScale");
+        ImGui::DragFloatRange2("", &dynamicResolution.settings.minScale, &dynamicResolution.settings.maxScale, 0.01f, 0.1f, 1.0f, "%.2f");
+        ImGui::PopID();
+        const DynamicResolutionStats &resolutionStats = dynamicResolution.getStats();
+        ImGui::Text("Rendering at %ux%u of %ux%u (%.0f%%)", resolutionStats.renderSize.x, resolutionStats.renderSize.y,
+            resolutionStats.outputSize.x, resolutionStats.outputSize.y, resolutionStats.scale * 100.0f);
+        ImGui::Text("Scene GPU time: %.2f ms (%.2f ms at the current scale)", resolutionStats.gpuTimeMs, resolutionStats.smoothedGpuTimeMs);
+
+        ImGui::Separator();
+
+        // Lays out copies of the current model in a grid centered on the origin
+        ImGui::Text("Scene objects: %zu", Scene::getInstance().objects.size());
+        static int gridSize[3] = { 1, 1, 1 };
+        static float gridSpacing = 1.5f;
+        ImGui::AlignTextToFramePadding();
+        ImGui::Text("Grid size"); ImGui::SameLine();
+        ImGui::PushID("GridSize");
+        ImGui::DragInt3("", gridSize, 1.0f, 1, 100);
+        ImGui::PopID();
+        UIManager::DrawWidgetFloat("Grid spacing", &gridSpacing);
+        if(ImGui::Button("Create grid"))
+        {
+            std::vector<SceneObject> &objects = Scene::getInstance().objects;
+            objects.clear();
+            objects.reserve((size_t)gridSize[0] * gridSize[1] * gridSize[2]);
+
+            glm::vec3 gridOffset = glm::vec3(gridSize[0] - 1, gridSize[1] - 1, gridSize[2] - 1) * gridSpacing * 0.5f;
+            for(int x = 0; x < gridSize[0]; x++)
+            {
+                for(int y = 0; y < gridSize[1]; y++)
+                {
+                    for(int z = 0; z < gridSize[2]; z++)
+                    {
+                        SceneObject object;
+                        object.transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z) * gridSpacing - gridOffset);
+                        objects.push_back(object);
+                    }
+                }
+            }
+        }
+
+        ImGui::Separator();
+
+        ImGui::Text("Texture streaming");
+        static TextureStreamer &textureStreamer = TextureStreamer::getInstance();
+        // Only affects textures loaded after the checkbox was changed
+        UIManager::DrawWidgetCheckbox("Stream new textures", &textureStreamer.settings.enabled);
+        
+        static int vramBudgetMB = (int)(textureStreamer.settings.vramBudget / (1024 * 1024));
+        ImGui::AlignTextToFramePadding();
+        ImGui::Text("VRAM budget (MB)"); ImGui::SameLine();
+        ImGui::PushID("VRAMBudget");
+        if(ImGui::DragInt("", &vramBudgetMB, 1.0f, 1, 8192))
+            textureStreamer.settings.vramBudget = (size_t)vramBudgetMB * 1024 * 1024;
+        ImGui::PopID();
+
+        const TextureStreamerStats &streamingStats = textureStreamer.getStats();
+        ImGui::Text("Streamed textures: %u (%u pending)", streamingStats.streamedTextures, streamingStats.pendingTextures);
+        ImGui::Text("Resident: %.2f MB", streamingStats.residentBytes / (1024.0f * 1024.0f));
+        ImGui::Text("Uploaded last frame: %.2f KB", streamingStats.uploadedBytesLastFrame / 1024.0f);
+
+        ImGui::Separator();
+
+        ImGui::Text("Frame pacing");
+        static FramePacer &framePacer = FramePacer::getInstance();
+        UIManager::DrawWidgetCheckbox("Render on demand", &framePacer.settings.renderOnDemand);
+        UIManager::DrawWidgetCheckbox("Spin model", &Scene::getInstance().spinModel);
+        ImGui::AlignTextToFramePadding();
+        ImGui::Text("Frame rate cap"); ImGui::SameLine();
+        ImGui::PushID("MaxFPS");
+        ImGui::DragFloat("", &framePacer.settings.maxFPS, 1.0f, 0.0f, 1000.0f, framePacer.settings.maxFPS > 0.0f ? "%.0f fps" : "uncapped");
+        ImGui::PopID();
+
+        // Only updates while frames are drawn, so the idle usage shows the last interval the viewer slept through
+        const FramePacerStats &pacerStats = framePacer.getStats();
+        ImGui::Text("Frames drawn: %llu (%llu idle wakeups)", pacerStats.drawnFrames, pacerStats.idleWakeups);
+        ImGui::Text("%.1f fps, CPU usage %.1f%% of a core", pacerStats.fps, pacerStats.cpuUsage);
+        ImGui::Text("Idle CPU usage: %.2f%% of a core", pacerStats.idleCPUUsage);
     }
     ImGui::End();
 }
@@ -339,57 +484,98 @@ void UIManager::DrawShaderPropertiesWindow()
                         continue;
                     }
 
-                    ResourceManager::getInstance().LoadShaderFromFiles(shaderSource.first, shaderSource.second);
+                    // Compiled in the background so the UI doesn't freeze, the shader shows up in the combo once it's linked
+                    ResourceManager::getInstance().LoadShaderFromFilesAsync(shaderSource.first, shaderSource.second);
                 }
             }
         }
 
+        size_t pendingShaderCount = ResourceManager::getInstance().getPendingShaderCount();
+        if(pendingShaderCount > 0)
+            ImGui::Text("Compiling %zu shader(s)...", pendingShaderCount);
+
+        // Feature toggles declared in the shader's sources with '#pragma variant'
+        const ShaderVariantSet *variantSet = !loadedShaderNames.empty() ? ResourceManager::getInstance().GetShaderVariantSet(loadedShaderNames[currentShader]) : nullptr;
+        if(variantSet != nullptr && !variantSet->variantKeys.empty())
+        {
+            ImGui::Separator();
+            ImGui::Text("Shader variants:");
+
+            uint32_t requestedMask = variantSet->requestedMask;
+            for(size_t i = 0; i < variantSet->variantKeys.size(); i++)
+            {
+                bool isEnabled = (requestedMask & (1u << i)) != 0;
+                if(ImGui::Checkbox(variantSet->variantKeys[i].c_str(), &isEnabled))
+                    requestedMask ^= 1u << i;
+            }
+            if(requestedMask != variantSet->requestedMask)
+                ResourceManager::getInstance().SetShaderVariant(loadedShaderNames[currentShader], requestedMask);
+
+            if(variantSet->requestedMask != variantSet->activeMask)
+                ImGui::Text("Compiling variant...");
+        }
+
         ImGui::Separator();
 
         ImGui::Text("Shader uniforms:");
         if(Scene::getInstance().shader != nullptr)
         {
             // Shader uniforms display and editing
-            const std::vector<ShaderUniform*> &shaderUniforms = Scene::getInstance().shader->getUniforms();          
+            std::vector<ShaderUniform> &shaderUniforms = Scene::getInstance().shader->getUniforms();          
             // NOTE: a vector of pairs of ShaderUniformType and vector of ShaderUniform*
             // might be a cool thing to implement into the shader so that there are is central
             // list of each uniform type and their respective place in the uniforms list on shader create
             // so that the entire list doesn't have to be looped over all the time
             std::vector<ShaderUniform*> texUniforms = Scene::getInstance().shader->getUniformsOfType(ShaderUniformType::TEX2D);  
+            // Switching to a different shader variant can add texture uniforms, which need a slot in the scene's textures as well
+            while(Scene::getInstance().textures.size() < texUniforms.size())
+                Scene::getInstance().textures.push_back(new Texture());
 
             // Draw the appropriate UI control widget for each uniform present in the shader given its type
-            for(ShaderUniform* const uniform: shaderUniforms)
+            for(ShaderUniform &uniform: shaderUniforms)
             {
-                switch(uniform->getType())
+                switch(uniform.getType())
                 {
+                    // The uniforms only get uploaded to the GPU when marked as dirty, so every edit has to mark them
                     case ShaderUniformType::INT:
-                        DrawWidgetInt(uniform->getName().c_str(), (int*)uniform->value);
+                        if(DrawWidgetInt(uniform.getName().c_str(), uniform.getValuePtr<int>()))
+                            uniform.MarkDirty();
                     break;
 
                     case ShaderUniformType::UINT:
-                        DrawWidgetUnsignedInt(uniform->getName().c_str(), (unsigned int*)uniform->value);
+                        if(DrawWidgetUnsignedInt(uniform.getName().c_str(), uniform.getValuePtr<unsigned int>()))
+                            uniform.MarkDirty();
                     break;
 
                     case ShaderUniformType::FLOAT:
-                        DrawWidgetFloat(uniform->getName().c_str(), (float*)uniform->value);
+                        if(DrawWidgetFloat(uniform.getName().c_str(), uniform.getValuePtr<float>()))
+                            uniform.MarkDirty();
                     break;
 
                     case ShaderUniformType::BOOL:
-                        DrawWidgetCheckbox(uniform->getName().c_str(), (bool*)uniform->value);
+                    {
+                        // Bools are stored as ints like GLSL does, so the checkbox edits a copy
+                        bool value = uniform.getValue<bool>();
+                        if(DrawWidgetCheckbox(uniform.getName().c_str(), &value))
+                            uniform.SetValue<bool>(value);
+                    }
                     break;
 
 
                     case ShaderUniformType::VEC2:
-                        DrawWidgetVec2(uniform->getName().c_str(), (float*)uniform->value);
+                        if(DrawWidgetVec2(uniform.getName().c_str(), (float*)uniform.getValuePtr<glm::vec2>()))
+                            uniform.MarkDirty();
                     break;
 
                     case ShaderUniformType::VEC3:
-                        DrawWidgetVec3(uniform->getName().c_str(), (float*)uniform->value);
+                        if(DrawWidgetVec3(uniform.getName().c_str(), (float*)uniform.getValuePtr<glm::vec3>()))
+                            uniform.MarkDirty();
                     break;
 
                     case ShaderUniformType::VEC4:
                         // NOTE: Some sort of differenciation between regular vec4 and color would be great
-                        DrawWidgetColor(uniform->getName().c_str(), (float*)uniform->value);
+                        if(DrawWidgetColor(uniform.getName().c_str(), (float*)uniform.getValuePtr<glm::vec4>()))
+                            uniform.MarkDirty();
                     break;
 
 
@@ -405,21 +591,17 @@ void UIManager::DrawShaderPropertiesWindow()
 
 
                     case ShaderUniformType::TEX2D:
+                    {
                         // unsigned int texBindTarget = std::distance(texUniforms.begin(), std::find(texUniforms.begin(), texUniforms.end(), uniform));
 
                         // Set the bind target of the current texture uniform to be its place in the list of uniforms of type TEX2D
                         // This means that textures will get the bind target by the way they are declared (eg. the first declared sampler2D uniform will be GL_TEXTURE0, the next one GL_TEXTURE1 and so on)
-                        unsigned int texBindTarget = FindIndexOfElement<ShaderUniform*>(texUniforms, uniform);
-                        Texture *newTex = DrawWidgetTex2D(uniform->getName().c_str(), (Texture*)uniform->value, texBindTarget);
-                        // If a new texture was loaded using the Tex2D widget, delete the default empty texture and set the uniform's value to be the newly loaded texture
-                        if(newTex != nullptr)
-                        {
-                            if(((Texture*)(uniform->value))->getID() == 0)
-                            {
-                                delete((Texture*)(uniform->value));
-                            }
-                            uniform->value = (void*)newTex;
-                        }
+                        unsigned int texBindTarget = FindIndexOfElement<ShaderUniform*>(texUniforms, &uniform);
+                        Texture *texture = uniform.getValue<Texture*>();
+                        // The widget either picks a newly loaded texture or clears the uniform (nullptr, drawn with the missing texture)
+                        if(DrawWidgetTex2D(uniform.getName().c_str(), &texture, texBindTarget))
+                            uniform.SetValue<Texture*>(texture);
+                    }
                     break;
                 }
             }
@@ -427,99 +609,183 @@ void UIManager::DrawShaderPropertiesWindow()
     }
     ImGui::End();
 }
+void UIManager::DrawGPUProfilerWindow()
+{
+    if(ImGui::Begin("GPU profiler", &_showGPUProfiler, _windowFlags))
+    {
+        static GPUProfiler &profiler = GPUProfiler::getInstance();
+        if(!profiler.isSupported())
+        {
+            ImGui::Text("Timestamp queries aren't supported by the GL implementation");
+            ImGui::End();
+            return;
+        }
+
+        UIManager::DrawWidgetCheckbox("Profile frames", &profiler.settings.enabled);
+        const GPUProfilerStats &profilerStats = profiler.getStats();
+        ImGui::Text("Profiled frames: %llu (%llu dropped), results are %u frames old", profilerStats.profiledFrames, profilerStats.droppedFrames, profilerStats.latencyFrames);
+
+        if(ImGui::Button("Export CSV..."))
+        {
+            std::string path = pfd::save_file("Export GPU profile", "gpu_profile.csv", {"CSV files", "*.csv"}).result();
+            if(!path.empty())
+                profiler.ExportCSV(path);
+        }
+
+        ImGui::Separator();
+
+        // Averages over the last frames, the scopes that weren't seen lately (e.g. a disabled pass) are grayed out
+        static unsigned int selectedScope = 0;
+        const std::vector<GPUScopeStats> &scopes = profiler.getScopeStats();
+        unsigned long long latestFrame = 0;
+        for(const GPUScopeStats &scope: scopes)
+            latestFrame = std::max(latestFrame, scope.lastSeenFrame);
+
+        ImGui::Text("%-28s %8s %8s %8s", "Scope (ms)", "avg", "min", "max");
+        for(unsigned int i = 0; i < scopes.size(); i++)
+        {
+            const GPUScopeStats &scope = scopes[i];
+            bool stale = scope.lastSeenFrame + GPUProfiler::FRAME_LATENCY < latestFrame;
+            char label[128];
+            snprintf(label, sizeof(label), "%*s%-*s %8.3f %8.3f %8.3f", scope.depth * 2, "", 28 - (int)scope.depth * 2, scope.name.c_str(), scope.averageMs, scope.minMs, scope.maxMs);
+
+            if(stale)
+            {
+                ImGui::TextDisabled("%s", label);
+                continue;
+            }
+            ImGui::PushID((int)i);
+            if(ImGui::Selectable(label, selectedScope == i))
+                selectedScope = i;
+            ImGui::PopID();
+        }
+
+        if(selectedScope < scopes.size() && !scopes[selectedScope].history.empty())
+        {
+            const GPUScopeStats &scope = scopes[selectedScope];
+            ImGui::Separator();
+
+            // The history is a ring, the offset makes the plot start at its oldest sample
+            int sampleCount = (int)scope.history.size();
+            int offset = sampleCount < (int)GPUProfiler::HISTORY_SIZE ? 0 : (int)scope.historyNext;
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%s: %.3f ms", scope.name.c_str(), scope.lastMs);
+            ImGui::PlotLines("##GPUScopeHistory", scope.history.data(), sampleCount, offset, overlay, 0.0f, scope.maxMs * 1.1f, ImVec2(ImGui::GetWindowWidth() - 20.0f, 60.0f));
+
+            // How the samples are spread between the fastest and the slowest one
+            static constexpr int BUCKET_COUNT = 32;
+            float buckets[BUCKET_COUNT] = {};
+            float bucketSize = std::max(scope.maxMs - scope.minMs, 1e-6f) / BUCKET_COUNT;
+            for(float sample: scope.history)
+                buckets[std::min((int)((sample - scope.minMs) / bucketSize), BUCKET_COUNT - 1)] += 1.0f;
+            snprintf(overlay, sizeof(overlay), "%.3f - %.3f ms", scope.minMs, scope.maxMs);
+            ImGui::PlotHistogram("##GPUScopeHistogram", buckets, BUCKET_COUNT, 0, overlay, 0.0f, FLT_MAX, ImVec2(ImGui::GetWindowWidth() - 20.0f, 60.0f));
+        }
+    }
+    ImGui::End();
+}
 #pragma endregion
 
 #pragma region Widgets
 #pragma region Base types
-void UIManager::DrawWidgetInt(const char* const label, int* const value)
+bool UIManager::DrawWidgetInt(const char* const label, int* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Int" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::DragInt("", value, 1);
+    bool changed = ImGui::DragInt("", value, 1);
     ImGui::PopID();
+    return changed;
 }
-void UIManager::DrawWidgetUnsignedInt(const char* const label, unsigned int* const value)
+bool UIManager::DrawWidgetUnsignedInt(const char* const label, unsigned int* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "UInt" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::DragInt("", (int*)value, 1, 0, UINT_MAX, "%i");
+    bool changed = ImGui::DragInt("", (int*)value, 1, 0, UINT_MAX, "%i");
     ImGui::PopID();
+    return changed;
 }
-void UIManager::DrawWidgetFloat(const char* const label, float* const value)
+bool UIManager::DrawWidgetFloat(const char* const label, float* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Float" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::DragFloat("", value, 0.5f);
+    bool changed = ImGui::DragFloat("", value, 0.5f);
     ImGui::PopID();
+    return changed;
 }
-void UIManager::DrawWidgetCheckbox(const char* const label, bool* const value)
+bool UIManager::DrawWidgetCheckbox(const char* const label, bool* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Checkbox" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::Checkbox("", value);
+    bool changed = ImGui::Checkbox("", value);
     ImGui::PopID();
+    return changed;
 }
 #pragma endregion
 
 #pragma region Vectors
-void UIManager::DrawWidgetVec2(const char* const label, float* const value)
+bool UIManager::DrawWidgetVec2(const char* const label, float* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Vec2" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::DragFloat2("", value, 0.5f);
+    bool changed = ImGui::DragFloat2("", value, 0.5f);
     ImGui::PopID();
+    return changed;
 }
-void UIManager::DrawWidgetVec3(const char* const label, float* const value)
+bool UIManager::DrawWidgetVec3(const char* const label, float* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Vec3" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::DragFloat3("", value, 0.5f);
+    bool changed = ImGui::DragFloat3("", value, 0.5f);
     ImGui::PopID();
+    return changed;
 }
-void UIManager::DrawWidgetVec4(const char* const label, float* const value)
+bool UIManager::DrawWidgetVec4(const char* const label, float* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Vec4" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::DragFloat4("", value, 0.5f);
+    bool changed = ImGui::DragFloat4("", value, 0.5f);
     ImGui::PopID();
+    return changed;
 }
-void UIManager::DrawWidgetColor(const char* const label, float* const value)
+bool UIManager::DrawWidgetColor(const char* const label, float* const value)
 {
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
     std::string widgetID = "Color" + std::string(label);
     ImGui::PushID(widgetID.c_str());
-    ImGui::ColorEdit4("", value);
+    bool changed = ImGui::ColorEdit4("", value);
     ImGui::PopID();
+    return changed;
 }
 #pragma endregion
 
-Texture* UIManager::DrawWidgetTex2D(const char* const label, Texture* const value, unsigned int bindTarget)
+bool UIManager::DrawWidgetTex2D(const char* const label, Texture** const value, unsigned int bindTarget)
 {
     auto &texturesInScene = Scene::getInstance().textures; // List of the currently loaded textures in the scene
     auto &loadedTextures = ResourceManager::getInstance().getLoadedTextures(); // List of all the available textures loaded by ResourceManager
     
-    static const Texture &missingImgTex = *(ResourceManager::getInstance().GetTexture("ui_image_missing"));
-    static const Texture &missingTex = *(ResourceManager::getInstance().GetTexture("tex_missing"));
+    static const Texture &missingImgTex = *(ResourceManager::getInstance().GetTexture("res/internal/ui_image_missing.jpg"));
+    static const Texture &missingTex = *(ResourceManager::getInstance().GetTexture("res/internal/tex_missing.jpg"));
     static ImVec2 imgSize(128.0f, 128.0f); // Texture button/img preview size
 
-    // The ptr to the returned tex. This can either be nullptr or, ptr to a newly loaded texture or the missing texture
-    // depending on whether or not a texture was loaded using the appropriate load tex button
-    Texture *returnedTex = nullptr;
+    // The value is either a newly loaded texture or nullptr (no texture, drawn as the missing texture)
+    // depending on which button was pressed
+    bool changed = false;
+    Texture *const currentTex = *value;
 
     ImGui::AlignTextToFramePadding();
     ImGui::Text(label); ImGui::SameLine();
@@ -527,9 +793,9 @@ Texture* UIManager::DrawWidgetTex2D(const char* const label, Texture* const valu
     // If the texture is not empty and has a value, use that as the image preview
     // otherwise use the appropriate "texture is missing" image
     void *img = nullptr; 
-    if(value->getID() != 0 && value->getID() != missingTex.getID())
+    if(currentTex != nullptr && currentTex->getID() != 0 && currentTex->getID() != missingTex.getID())
     {
-        img = (void*)value->getID();
+        img = (void*)currentTex->getID();
     }
     else
         img = (void*)missingImgTex.getID();
@@ -567,7 +833,8 @@ Texture* UIManager::DrawWidgetTex2D(const char* const label, Texture* const valu
                     
                 }
                 
-                returnedTex = newTex;
+                *value = newTex;
+                changed = true;
             }
         }
     }
@@ -581,9 +848,9 @@ Texture* UIManager::DrawWidgetTex2D(const char* const label, Texture* const valu
     {
         // Only unload the texture if the value isn't an empty Texture or the default missing texture.
         // It wouldn't make sense to delete an empty texture or an engine default
-        if(value->getID() != 0 && value->getID() != missingImgTex.getID())
+        if(currentTex != nullptr && currentTex->getID() != 0 && currentTex->getID() != missingImgTex.getID())
         {
-            auto texIt = std::find(texturesInScene.begin(), texturesInScene.end(), value);
+            auto texIt = std::find(texturesInScene.begin(), texturesInScene.end(), currentTex);
             
             // Remove the texture from the textures in the scene
             if(texIt != texturesInScene.end())
@@ -596,7 +863,7 @@ Texture* UIManager::DrawWidgetTex2D(const char* const label, Texture* const valu
             std::string texKey;
             for(const auto &entry: loadedTextures)
             {
-                if(entry.second == value)
+                if(entry.second == currentTex)
                 {
                     texKey = entry.first;
                     break;
@@ -605,14 +872,15 @@ Texture* UIManager::DrawWidgetTex2D(const char* const label, Texture* const valu
             
             ResourceManager::getInstance().UnloadTexture(texKey);
 
-            returnedTex = const_cast<Texture*>(&missingTex);
+            *value = nullptr;
+            changed = true;
         }
     }
     ImGui::PopID();
 
     // NOTE: A combo to pick already loaded textures like it is with the shaders
 
-    return returnedTex;
+    return changed;
 }
 
 #pragma endregion
\ No newline at end of file
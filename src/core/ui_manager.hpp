@@ -16,6 +16,7 @@ class UIManager : public Singleton<UIManager>
 
     bool _showRendererProperties = false;
     bool _showShaderProperties = false;
+    bool _showGPUProfiler = false;
     #ifdef _DEBUG
     bool _showImGuiDemoWindow = false;
     #endif
@@ -34,16 +35,18 @@ class UIManager : public Singleton<UIManager>
     void DrawMainMenuBar();
     void DrawRendererPropertiesWindow();
     void DrawShaderPropertiesWindow();
+    void DrawGPUProfilerWindow();
 
-    void DrawWidgetInt(const char* const label, int* const value);
-    void DrawWidgetUnsignedInt(const char* const label, unsigned int* const value);
-    void DrawWidgetFloat(const char* const label, float* const value);
-    void DrawWidgetCheckbox(const char* const label, bool* const value);
+    // The widgets return true if the value was changed this frame
+    bool DrawWidgetInt(const char* const label, int* const value);
+    bool DrawWidgetUnsignedInt(const char* const label, unsigned int* const value);
+    bool DrawWidgetFloat(const char* const label, float* const value);
+    bool DrawWidgetCheckbox(const char* const label, bool* const value);
 
-    void DrawWidgetVec2(const char* const label, float* const value);
-    void DrawWidgetVec3(const char* const label, float* const value);
-    void DrawWidgetVec4(const char* const label, float* const value);
-    void DrawWidgetColor(const char* const label, float* const value);
+    bool DrawWidgetVec2(const char* const label, float* const value);
+    bool DrawWidgetVec3(const char* const label, float* const value);
+    bool DrawWidgetVec4(const char* const label, float* const value);
+    bool DrawWidgetColor(const char* const label, float* const value);
 
-    Texture* DrawWidgetTex2D(const char* const label, Texture* const value, unsigned int bindTarget = 0);
+    bool DrawWidgetTex2D(const char* const label, Texture** const value, unsigned int bindTarget = 0);
 };
\ No newline at end of file
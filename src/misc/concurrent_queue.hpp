@@ -0,0 +1,87 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+// A simple thread-safe FIFO queue used to hand work between threads.
+// Once closed, Pop() drains the remaining items and then returns false
+// so that the consuming threads know they can exit
+template<typename T>
+class ConcurrentQueue final
+{
+    private:
+    std::deque<T> _items;
+    mutable std::mutex _mutex;
+    std::condition_variable _itemPushed;
+    std::condition_variable _itemPopped;
+    size_t _capacity = 0;
+    bool _closed = false;
+
+    public:
+    // A capacity of 0 means the queue is unbounded, otherwise Push() blocks while the queue is full
+    ConcurrentQueue(size_t capacity = 0): _capacity(capacity) {}
+    ConcurrentQueue(const ConcurrentQueue &other) = delete;
+    ConcurrentQueue &operator=(const ConcurrentQueue &other) = delete;
+
+    public:
+    void Push(T item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _itemPopped.wait(lock, [this]() { return _closed || _capacity == 0 || _items.size() < _capacity; });
+            if(_closed)
+                return;
+            _items.push_back(std::move(item));
+        }
+        _itemPushed.notify_one();
+    }
+
+    // Blocks until an item is available or the queue gets closed
+    bool Pop(T &item)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _itemPushed.wait(lock, [this]() { return _closed || !_items.empty(); });
+            if(_items.empty())
+                return false;
+
+            item = std::move(_items.front());
+            _items.pop_front();
+        }
+        _itemPopped.notify_one();
+        return true;
+    }
+
+    // Returns right away, false if there was nothing in the queue
+    bool TryPop(T &item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if(_items.empty())
+                return false;
+
+            item = std::move(_items.front());
+            _items.pop_front();
+        }
+        _itemPopped.notify_one();
+        return true;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _itemPushed.notify_all();
+        _itemPopped.notify_all();
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _items.size();
+    }
+};
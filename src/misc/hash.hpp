@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+// 64-bit content hash based on the xxHash64 algorithm (https://github.com/Cyan4973/xxHash)
+// The main loop keeps 4 independent accumulators so the CPU can work on a whole
+// 32 byte stripe at once, which keeps hashing large files (textures, meshes) cheap.
+// NOTE: Assumes a little-endian machine, which every supported platform is
+namespace HashInternal
+{
+    static constexpr uint64_t PRIME64_1 = 11400714785074694791ULL;
+    static constexpr uint64_t PRIME64_2 = 14029467366897019727ULL;
+    static constexpr uint64_t PRIME64_3 = 1609587929392839161ULL;
+    static constexpr uint64_t PRIME64_4 = 9650029242287828579ULL;
+    static constexpr uint64_t PRIME64_5 = 2870177450012600261ULL;
+
+    inline uint64_t RotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+
+    inline uint64_t Read64(const unsigned char *ptr) { uint64_t value; memcpy(&value, ptr, sizeof(value)); return value; }
+    inline uint32_t Read32(const unsigned char *ptr) { uint32_t value; memcpy(&value, ptr, sizeof(value)); return value; }
+
+    inline uint64_t Round(uint64_t acc, uint64_t input)
+    {
+        acc += input * PRIME64_2;
+        acc = RotateLeft(acc, 31);
+        acc *= PRIME64_1;
+        return acc;
+    }
+    inline uint64_t MergeRound(uint64_t acc, uint64_t value)
+    {
+        acc ^= Round(0, value);
+        acc = acc * PRIME64_1 + PRIME64_4;
+        return acc;
+    }
+}
+
+// Hashes the given block of memory
+inline uint64_t Hash64(const void *data, size_t size, uint64_t seed = 0)
+{
+    using namespace HashInternal;
+
+    const unsigned char *ptr = (const unsigned char*)data;
+    const unsigned char *const end = ptr + size;
+    uint64_t hash;
+
+    if(size >= 32)
+    {
+        const unsigned char *const limit = end - 32;
+        uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+        uint64_t v2 = seed + PRIME64_2;
+        uint64_t v3 = seed + 0;
+        uint64_t v4 = seed - PRIME64_1;
+
+        do
+        {
+            v1 = Round(v1, Read64(ptr));      ptr += 8;
+            v2 = Round(v2, Read64(ptr));      ptr += 8;
+            v3 = Round(v3, Read64(ptr));      ptr += 8;
+            v4 = Round(v4, Read64(ptr));      ptr += 8;
+        } while(ptr <= limit);
+
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    }
+    else
+    {
+        hash = seed + PRIME64_5;
+    }
+
+    hash += (uint64_t)size;
+
+    // Consume the remaining tail of the data
+    while(ptr + 8 <= end)
+    {
+        hash ^= Round(0, Read64(ptr));
+        hash = RotateLeft(hash, 27) * PRIME64_1 + PRIME64_4;
+        ptr += 8;
+    }
+    if(ptr + 4 <= end)
+    {
+        hash ^= (uint64_t)Read32(ptr) * PRIME64_1;
+        hash = RotateLeft(hash, 23) * PRIME64_2 + PRIME64_3;
+        ptr += 4;
+    }
+    while(ptr < end)
+    {
+        hash ^= (*ptr) * PRIME64_5;
+        hash = RotateLeft(hash, 11) * PRIME64_1;
+        ptr++;
+    }
+
+    // Final avalanche so that every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+// 32-bit FNV-1a hash, used for short strings such as shader uniform names
+inline constexpr uint32_t HashName(const char *str, size_t length)
+{
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (uint32_t)(unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
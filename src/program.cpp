@@ -7,22 +7,77 @@
 #include <pfd/portable-file-dialogs.h>
 
 #include <string>
+#include <chrono>
+#include <algorithm>
 
 #include "core/log.hpp"
 #include "core/resource_manager.hpp"
 #include "core/ui_manager.hpp"
 #include "core/scene.hpp"
+#include "core/command_line.hpp"
+#include "core/frame_pacer.hpp"
+#include "core/cpu_profiler.hpp"
+#ifdef HEADLESS_AVAILABLE
+    #include "core/headless_app.hpp"
+#endif
 #include "rendering/renderer.hpp"
+#include "rendering/dynamic_resolution.hpp"
+#include "rendering/gpu_profiler.hpp"
 #include "rendering/shader.hpp"
 #include "rendering/texture.hpp"
+#include "rendering/texture_streamer.hpp"
+#include "rendering/geometry_arena.hpp"
+#include "rendering/shader_cache.hpp"
+#include "rendering/shader_compiler.hpp"
 
 static constexpr unsigned int WINDOW_WIDTH = 1270; 
 static constexpr unsigned int WINDOW_HEIGHT = 720;
 static const std::string WINDOW_TITLE = "Model Viewer";
 
-int main()
+// Kept up to date by the framebuffer size callback. On high DPI displays it differs from the window's size in screen coordinates
+static glm::uvec2 framebufferSize = glm::uvec2(WINDOW_WIDTH, WINDOW_HEIGHT);
+static void OnFramebufferResized(GLFWwindow *window, int width, int height)
+{
+    // Minimizing the window shrinks it to 0x0
+    framebufferSize = glm::uvec2((unsigned int)width, (unsigned int)height);
+}
+
+// Writes the CPU trace if one was asked for on the command line and passes the exit code through
+static int Exit(const CommandLineOptions &options, int exitCode)
+{
+    if(!options.tracePath.empty())
+        CPUProfiler::getInstance().WriteChromeTrace(options.tracePath);
+    return exitCode;
+}
+
+int main(int argc, char **argv)
 {
     Log::SetLogLevelFilter(LogLevel::Info);
+    // Also creates the profiler before any other thread could race to do so
+    CPUProfiler::getInstance().SetThreadName("Main");
+
+    CommandLineOptions options;
+    if(!CommandLine::Parse(argc, argv, options))
+    {
+        CommandLine::PrintUsage(argv[0]);
+        return -1;
+    }
+    if(options.showHelp)
+    {
+        CommandLine::PrintUsage(argv[0]);
+        return 0;
+    }
+
+    // Headless runs never create a window, so they work on machines without a display
+    if(options.headless)
+    {
+        #ifdef HEADLESS_AVAILABLE
+            return Exit(options, HeadlessApp::Run(options));
+        #else
+            Log::LogFatal("Built without EGL, headless rendering isn't available. Exiting application...");
+            return -1;
+        #endif
+    }
 
     // GLFW init
     if(!glfwInit())
@@ -34,12 +89,17 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 2);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    // TODO: Implement viewport scaling
-    glfwWindowHint(GLFW_RESIZABLE, false);
+    glfwWindowHint(GLFW_RESIZABLE, true);
 
     GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE.c_str(), NULL, NULL);
     glfwMakeContextCurrent(window);
 
+    // Before the UI and the frame pacer hook the window, they pass the event on to it
+    int initialWidth = 0, initialHeight = 0;
+    glfwGetFramebufferSize(window, &initialWidth, &initialHeight);
+    OnFramebufferResized(window, initialWidth, initialHeight);
+    glfwSetFramebufferSizeCallback(window, OnFramebufferResized);
+
     // glad init
     if(!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     {
@@ -54,70 +114,133 @@ int main()
         return -1;
     }
 
+    auto startupStart = std::chrono::steady_clock::now();
+
+    TextureStreamer::getInstance().Init();
+    ShaderCache::getInstance().Init();
+    ShaderCompiler::getInstance().Init((GLADloadproc)glfwGetProcAddress);
+    ResourceManager::getInstance().Init();
+
     // Resource loading
     Scene::getInstance().shader = ResourceManager::getInstance().LoadShaderFromFiles("res/internal/default.vs", "res/internal/default.fs");
     
-    ResourceManager::getInstance().LoadTextureFromFile("res/internal/ui_image_missing.jpg");
-    ResourceManager::getInstance().LoadTextureFromFile("res/internal/tex_missing.jpg");
+    // The internal textures are tiny and get used by the UI directly so there's no point in streaming them
+    ResourceManager::getInstance().LoadTextureFromFile("res/internal/ui_image_missing.jpg", false);
+    ResourceManager::getInstance().LoadTextureFromFile("res/internal/tex_missing.jpg", false);
     
     // Rendering init
     UIManager::getInstance().Init(window);
-    Renderer::getInstance().Init();
-
-    // MVP calculation
-    // NOTE: The projection matrix should react to the changes in resolution
-    // and change accordingly
-    glm::mat4 projMatrix = glm::perspective(45.0f, (float)WINDOW_WIDTH/(float)WINDOW_HEIGHT, 0.1f, 100.0f);
-
+    Renderer::getInstance().Init((GLADloadproc)glfwGetProcAddress);
+    DynamicResolution::getInstance().Init();
+    GPUProfiler::getInstance().Init();
+    if(options.software)
+        Renderer::getInstance().settings.backend = RenderBackend::SOFTWARE;
+    // After the UI so that the input still reaches ImGui
+    FramePacer &framePacer = FramePacer::getInstance();
+    framePacer.Init(window);
+    framePacer.settings.renderOnDemand = !options.continuous;
+    framePacer.settings.maxFPS = options.maxFPS;
+
+    float startupTimeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startupStart).count();
+    Log::LogInfo("Startup took " + std::to_string(startupTimeMs) + " ms");
+
+    // MVP calculation, the projection matrix follows the window's aspect ratio every frame
     glm::vec3 viewPos = glm::vec3(0.0f, -1.25f, -5.0f);
     glm::mat4 viewMatrix = glm::mat4(1.0f);
     viewMatrix = glm::translate(viewMatrix, viewPos);
     
     glm::mat4 modelMatrix = glm::mat4(1.0f);
 
-    glm::mat4 MVP = glm::mat4(1.0f);
-
-
     float deltaTime = 0.0f;
-    float lastTime = 0.0f;
+    float lastTime = (float)glfwGetTime();
     
-    constexpr float rotSpeed = -1.0f;
-    float rotation = 0.0f; 
+    // Degrees per second
+    constexpr float spinSpeed = -20.0f;
     
     while(!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+        // Sleeps until something needs to be redrawn or the frame rate cap allows the next frame
+        framePacer.WaitForEvents();
 
         // Delta time calculation
-        static float currentTime = glfwGetTime();
+        float currentTime = (float)glfwGetTime();
         deltaTime = currentTime - lastTime;
         lastTime = currentTime;
 
-        // Spinning of cube
-        rotation = sin(rotSpeed * currentTime);
-        modelMatrix = glm::rotate(modelMatrix, glm::radians(rotation), glm::vec3(0.0f, 1.0f, 0.0f));
+        // Reload the shaders and textures that were edited on disk, then finish/advance the shaders
+        // that are being compiled in the background. Reloaded shaders get swapped in before the frame is drawn
+        if(ResourceManager::getInstance().Update())
+            framePacer.RequestRedraw();
+        ShaderCompiler::getInstance().Update();
+
+        // Work that only moves forward while frames are drawn keeps the loop awake until it's done
+        const TextureStreamerStats &streamerStats = TextureStreamer::getInstance().getStats();
+        if(ResourceManager::getInstance().getPendingShaderCount() > 0 || ShaderCompiler::getInstance().getPendingJobCount() > 0
+            || streamerStats.pendingTextures > 0 || streamerStats.uploadedBytesLastFrame > 0)
+            framePacer.RequestRedraw();
+        if(Scene::getInstance().spinModel)
+            framePacer.RequestRedraw(1);
+
+        // Also false while the window is minimized, nothing can be seen of it
+        if(!framePacer.BeginFrame())
+            continue;
+        PROFILE_ZONE("Frame");
+
+        // Spinning of the model. The time spent asleep is left out so it doesn't jump when it starts spinning again
+        if(Scene::getInstance().spinModel)
+            modelMatrix = glm::rotate(modelMatrix, glm::radians(spinSpeed * std::min(deltaTime, 0.1f)), glm::vec3(0.0f, 1.0f, 0.0f));
         
-        // Updating the MVP uniform of the currently used shader
-        MVP = projMatrix * viewMatrix * modelMatrix;
-        if(Scene::getInstance().shader != nullptr)
+        // The camera and model matrix end up in the uniform buffers shared by all shaders,
+        // so they don't get lost when switching shaders
+        CameraData camera;
+        camera.view = viewMatrix;
+        camera.projection = glm::perspective(45.0f, (float)framebufferSize.x / (float)framebufferSize.y, 0.1f, 100.0f);
+        // The view matrix moves the world by viewPos, the camera itself sits at the opposite position
+        camera.position = glm::vec3(glm::inverse(viewMatrix)[3]);
+        Renderer::getInstance().SetTime(currentTime);
+
+        Scene::getInstance().modelMatrix = modelMatrix;
+
+        GPUProfiler::getInstance().BeginFrame();
+
+        // The scene is rendered offscreen at a resolution that keeps it within the frame time and upscaled into the window,
+        // the UI is drawn on top of it at the window's full resolution
+        camera.viewportSize = DynamicResolution::getInstance().BeginFrame(framebufferSize);
+        Renderer::getInstance().SetCamera(camera);
         {
-            Scene::getInstance().shader->SetUniform("u_ModelMatrix", (void*)&modelMatrix);
-            Scene::getInstance().shader->SetUniform("u_MVP", (void*)&MVP);  
-            Scene::getInstance().shader->SetUniform("u_ViewPos", (void*)&viewPos);
+            GPU_PROFILE_SCOPE("Scene");
+            Renderer::getInstance().DrawScene();
+        }
+        {
+            GPU_PROFILE_SCOPE("Upscale");
+            DynamicResolution::getInstance().EndFrame();
+        }
+        {
+            GPU_PROFILE_SCOPE("UI");
+            UIManager::getInstance().DrawUI();
+        }
+
+        GPUProfiler::getInstance().EndFrame();
+        {
+            PROFILE_ZONE("Swap buffers");
+            glfwSwapBuffers(window);
         }
-        
-        // Render the scene and UI
-        Renderer::getInstance().DrawScene();
-        UIManager::getInstance().DrawUI();
-        
-        glfwSwapBuffers(window);
     }
 
+    FramePacer::getInstance().DeInit();
+    ResourceManager::getInstance().LogDeduplicationReport();
+    ResourceManager::getInstance().DeInit();
+
+    GPUProfiler::getInstance().DeInit();
+    DynamicResolution::getInstance().DeInit();
     Renderer::getInstance().DeInit();
+    // After everything that could still be holding on to models
+    GeometryArena::getInstance().DeInit();
     UIManager::getInstance().DeInit();
+    TextureStreamer::getInstance().DeInit();
     
     glfwDestroyWindow(window);
     glfwTerminate();
 
-    return 0;
+    return Exit(options, 0);
 }
\ No newline at end of file
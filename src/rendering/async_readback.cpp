@@ -0,0 +1,106 @@
+#include "async_readback.hpp"
+
+#include "core/log.hpp"
+
+#include <chrono>
+#include <cstring>
+
+AsyncReadback::AsyncReadback(const glm::uvec2 &size, unsigned int slotCount)
+    : _slots(slotCount), _size(size)
+{
+    size_t frameSize = (size_t)_size.x * _size.y * 4;
+    for(Slot &slot: _slots)
+    {
+        GL_CALL(glad_glGenBuffers(1, &slot.pixelBuffer));
+        GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer));
+        GL_CALL(glad_glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ));
+    }
+    GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+AsyncReadback::~AsyncReadback()
+{
+    for(Slot &slot: _slots)
+    {
+        if(slot.fence != nullptr)
+        {
+            GL_CALL(glad_glDeleteSync(slot.fence));
+        }
+        GL_CALL(glad_glDeleteBuffers(1, &slot.pixelBuffer));
+    }
+}
+
+void AsyncReadback::Start(unsigned int framebuffer, unsigned long long tag)
+{
+    if(isFull())
+    {
+        Log::LogError("Started a readback while all of the pixel buffers were still in flight");
+        return;
+    }
+
+    Slot &slot = _slots[(_oldest + _inFlight) % _slots.size()];
+    slot.tag = tag;
+
+    // With a pixel buffer bound the pointer is an offset into it, and the call returns as soon as the copy is queued
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer));
+    GL_CALL(glad_glReadBuffer(GL_COLOR_ATTACHMENT0));
+    GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer));
+    GL_CALL(glad_glReadPixels(0, 0, _size.x, _size.y, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0));
+    GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+    GL_CALL(slot.fence = glad_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+
+    _inFlight++;
+    _stats.readbacks++;
+}
+
+bool AsyncReadback::Collect(std::vector<unsigned char> &pixels, unsigned long long &tag, bool wait)
+{
+    if(isEmpty())
+        return false;
+
+    Slot &slot = _slots[_oldest];
+
+    GLenum result;
+    GL_CALL(result = glad_glClientWaitSync(slot.fence, 0, 0));
+    if(result == GL_TIMEOUT_EXPIRED)
+    {
+        if(!wait)
+            return false;
+
+        _stats.stalls++;
+        auto stallStart = std::chrono::high_resolution_clock::now();
+        do
+        {
+            // The flush makes sure the fence itself was actually sent to the GPU
+            GL_CALL(result = glad_glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+        } while(result == GL_TIMEOUT_EXPIRED);
+        _stats.stallTimeMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - stallStart).count();
+    }
+    GL_CALL(glad_glDeleteSync(slot.fence));
+    slot.fence = nullptr;
+
+    size_t rowSize = (size_t)_size.x * 4;
+    pixels.resize(rowSize * _size.y);
+
+    GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer));
+    const unsigned char *mapped = nullptr;
+    GL_CALL(mapped = (const unsigned char*)glad_glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rowSize * _size.y, GL_MAP_READ_BIT));
+    if(mapped != nullptr)
+    {
+        // GL's first row is the bottom one, flipping while copying out saves a pass over the image
+        for(size_t y = 0; y < _size.y; y++)
+            memcpy(pixels.data() + y * rowSize, mapped + (_size.y - 1 - y) * rowSize, rowSize);
+        GL_CALL(glad_glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+    }
+    else
+    {
+        Log::LogError("Failed mapping a readback pixel buffer");
+        memset(pixels.data(), 0, pixels.size());
+    }
+    GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+
+    tag = slot.tag;
+    _oldest = (_oldest + 1) % _slots.size();
+    _inFlight--;
+    return true;
+}
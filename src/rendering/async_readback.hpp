@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+struct AsyncReadbackStats
+{
+    unsigned int readbacks = 0;
+    // Times a slot was needed before the GPU had finished copying into it
+    unsigned int stalls = 0;
+    float stallTimeMs = 0.0f;
+};
+
+// Reads the color attachment of framebuffers back through a ring of pixel buffers.
+// glReadPixels into a pixel buffer only queues the copy on the GPU, a fence placed after it tells when the copy is done
+// and the buffer can be mapped without waiting. As long as the CPU collects the frames a few behind the one it's drawing,
+// neither side ever waits for the other
+class AsyncReadback
+{
+    private:
+    struct Slot
+    {
+        unsigned int pixelBuffer = 0;
+        GLsync fence = nullptr;
+        // Whatever the caller wants to know the frame by, handed back with the pixels
+        unsigned long long tag = 0;
+    };
+    std::vector<Slot> _slots;
+    // Oldest slot that's still in flight, the readbacks finish in the order they were started
+    unsigned int _oldest = 0;
+    unsigned int _inFlight = 0;
+    glm::uvec2 _size;
+
+    AsyncReadbackStats _stats;
+
+    public:
+    AsyncReadback(const glm::uvec2 &size, unsigned int slotCount);
+    ~AsyncReadback();
+    AsyncReadback(const AsyncReadback &other) = delete;
+    AsyncReadback &operator=(const AsyncReadback &other) = delete;
+
+    public:
+    // Queues a copy of the framebuffer's first color attachment, which has to be the size the readback was created with.
+    // Must not be called while isFull()
+    void Start(unsigned int framebuffer, unsigned long long tag);
+    // Copies the oldest readback out as tightly packed RGBA8 rows, top row first. Without waiting it returns false
+    // if the GPU isn't done with it yet, with waiting it only returns false when nothing is in flight
+    bool Collect(std::vector<unsigned char> &pixels, unsigned long long &tag, bool wait);
+
+    inline bool isFull() const { return _inFlight == _slots.size(); }
+    inline bool isEmpty() const { return _inFlight == 0; }
+    inline const AsyncReadbackStats &getStats() const { return _stats; }
+};
@@ -0,0 +1,272 @@
+#include "bvh.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// SSE2 is part of every x86-64 CPU, other architectures use the scalar version of the plane tests
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define BVH_USE_SSE
+    #include <emmintrin.h>
+#endif
+
+#pragma region AABB and frustum
+AABB AABB::Transform(const glm::vec3 &min, const glm::vec3 &max, const glm::mat4 &transform)
+{
+    glm::vec3 center = (min + max) * 0.5f;
+    glm::vec3 extents = (max - min) * 0.5f;
+
+    // Every axis of the new box is as long as the box's extents projected onto it (Arvo's method)
+    glm::vec3 newCenter = glm::vec3(transform * glm::vec4(center, 1.0f));
+    glm::vec3 newExtents = glm::abs(glm::vec3(transform[0])) * extents.x
+                         + glm::abs(glm::vec3(transform[1])) * extents.y
+                         + glm::abs(glm::vec3(transform[2])) * extents.z;
+
+    AABB result;
+    result.min = newCenter - newExtents;
+    result.max = newCenter + newExtents;
+    return result;
+}
+
+Frustum Frustum::FromMatrix(const glm::mat4 &matrix)
+{
+    // Gribb-Hartmann, each plane is the sum or difference of the matrix's last row and one of the other rows.
+    // glm matrices are column major so a row is read across the columns
+    auto row = [&matrix](int i) { return glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]); };
+    glm::vec4 planes[6] =
+    {
+        row(3) + row(0), // left
+        row(3) - row(0), // right
+        row(3) + row(1), // bottom
+        row(3) - row(1), // top
+        row(3) + row(2), // near
+        row(3) - row(2)  // far
+    };
+
+    Frustum frustum;
+    for(int i = 0; i < 8; i++)
+    {
+        glm::vec4 plane = planes[std::min(i, 5)];
+        float length = glm::length(glm::vec3(plane));
+        if(length > 0.0f)
+            plane /= length;
+
+        frustum.normalX[i] = plane.x;
+        frustum.normalY[i] = plane.y;
+        frustum.normalZ[i] = plane.z;
+        frustum.distance[i] = plane.w;
+    }
+    return frustum;
+}
+#pragma endregion
+
+FrustumTestResult BVH::TestAABB(const Frustum &frustum, const AABB &box)
+{
+    // A box is outside of a plane if even its corner furthest along the plane's normal is behind it.
+    // With the box as center and extents, that corner's distance is the center's distance plus the extents projected onto the normal
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extents = (box.max - box.min) * 0.5f;
+    bool intersects = false;
+
+#ifdef BVH_USE_SSE
+    const __m128 centerX = _mm_set1_ps(center.x), centerY = _mm_set1_ps(center.y), centerZ = _mm_set1_ps(center.z);
+    const __m128 extentsX = _mm_set1_ps(extents.x), extentsY = _mm_set1_ps(extents.y), extentsZ = _mm_set1_ps(extents.z);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for(int group = 0; group < 8; group += 4)
+    {
+        __m128 normalX = _mm_load_ps(frustum.normalX + group);
+        __m128 normalY = _mm_load_ps(frustum.normalY + group);
+        __m128 normalZ = _mm_load_ps(frustum.normalZ + group);
+
+        __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX, centerX), _mm_mul_ps(normalY, centerY)),
+                                     _mm_add_ps(_mm_mul_ps(normalZ, centerZ), _mm_load_ps(frustum.distance + group)));
+        __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, normalX), extentsX), _mm_mul_ps(_mm_andnot_ps(signMask, normalY), extentsY)),
+                                   _mm_mul_ps(_mm_andnot_ps(signMask, normalZ), extentsZ));
+
+        const __m128 zero = _mm_setzero_ps();
+        if(_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(distance, radius), zero)) != 0)
+            return FrustumTestResult::OUTSIDE;
+        if(_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(distance, radius), zero)) != 0)
+            intersects = true;
+    }
+#else
+    for(int i = 0; i < 6; i++)
+    {
+        float distance = frustum.normalX[i] * center.x + frustum.normalY[i] * center.y + frustum.normalZ[i] * center.z + frustum.distance[i];
+        float radius = std::abs(frustum.normalX[i]) * extents.x + std::abs(frustum.normalY[i]) * extents.y + std::abs(frustum.normalZ[i]) * extents.z;
+
+        if(distance + radius < 0.0f)
+            return FrustumTestResult::OUTSIDE;
+        if(distance - radius < 0.0f)
+            intersects = true;
+    }
+#endif
+
+    return intersects ? FrustumTestResult::INTERSECTING : FrustumTestResult::INSIDE;
+}
+
+#pragma region Building
+void BVH::Build(const std::vector<AABB> &objectBounds)
+{
+    _objectBounds = objectBounds;
+    _objectLeaves.assign(_objectBounds.size(), -1);
+    _objectIndices.resize(_objectBounds.size());
+    for(unsigned int i = 0; i < _objectIndices.size(); i++)
+        _objectIndices[i] = i;
+
+    _nodes.clear();
+    _dirtyNodes.clear();
+    if(!_objectBounds.empty())
+    {
+        // A binary tree with at least 1 object per leaf never has more than 2n - 1 nodes
+        _nodes.reserve(2 * _objectBounds.size());
+        BuildNode(0, (unsigned int)_objectIndices.size(), -1);
+    }
+    _isNodeDirty.assign(_nodes.size(), false);
+}
+unsigned int BVH::BuildNode(unsigned int start, unsigned int end, int parent)
+{
+    unsigned int nodeIndex = (unsigned int)_nodes.size();
+    _nodes.emplace_back();
+    _nodes[nodeIndex].parent = parent;
+    _nodes[nodeIndex].firstObject = start;
+    _nodes[nodeIndex].objectCount = end - start;
+
+    if(end - start <= MAX_LEAF_OBJECTS)
+    {
+        for(unsigned int i = start; i < end; i++)
+            _objectLeaves[_objectIndices[i]] = (int)nodeIndex;
+        RecalculateNodeBounds(_nodes[nodeIndex]);
+        return nodeIndex;
+    }
+
+    // Split along the axis the centers of the objects are spread out the most on
+    glm::vec3 centersMin = glm::vec3(INFINITY), centersMax = glm::vec3(-INFINITY);
+    for(unsigned int i = start; i < end; i++)
+    {
+        const AABB &bounds = _objectBounds[_objectIndices[i]];
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        centersMin = glm::min(centersMin, center);
+        centersMax = glm::max(centersMax, center);
+    }
+    glm::vec3 spread = centersMax - centersMin;
+    int axis = (spread.x >= spread.y && spread.x >= spread.z) ? 0 : (spread.y >= spread.z ? 1 : 2);
+
+    // Splitting at the median keeps the tree balanced even when lots of objects sit at the same spot
+    unsigned int middle = start + (end - start) / 2;
+    std::nth_element(_objectIndices.begin() + start, _objectIndices.begin() + middle, _objectIndices.begin() + end,
+        [this, axis](unsigned int a, unsigned int b)
+        {
+            return (_objectBounds[a].min[axis] + _objectBounds[a].max[axis]) < (_objectBounds[b].min[axis] + _objectBounds[b].max[axis]);
+        });
+
+    BuildNode(start, middle, (int)nodeIndex);
+    unsigned int rightChild = BuildNode(middle, end, (int)nodeIndex);
+    // The vector may have grown while building the children, so the node is looked up again
+    _nodes[nodeIndex].rightChild = rightChild;
+    RecalculateNodeBounds(_nodes[nodeIndex]);
+    return nodeIndex;
+}
+void BVH::RecalculateNodeBounds(Node &node)
+{
+    if(node.isLeaf())
+    {
+        node.bounds = _objectBounds[_objectIndices[node.firstObject]];
+        for(unsigned int i = node.firstObject + 1; i < node.firstObject + node.objectCount; i++)
+        {
+            const AABB &bounds = _objectBounds[_objectIndices[i]];
+            node.bounds.min = glm::min(node.bounds.min, bounds.min);
+            node.bounds.max = glm::max(node.bounds.max, bounds.max);
+        }
+    }
+    else
+    {
+        unsigned int nodeIndex = (unsigned int)(&node - _nodes.data());
+        const AABB &left = _nodes[nodeIndex + 1].bounds, &right = _nodes[node.rightChild].bounds;
+        node.bounds.min = glm::min(left.min, right.min);
+        node.bounds.max = glm::max(left.max, right.max);
+    }
+}
+#pragma endregion
+
+#pragma region Refitting
+void BVH::UpdateObject(unsigned int object, const AABB &bounds)
+{
+    if(object >= _objectBounds.size())
+        return;
+
+    _objectBounds[object] = bounds;
+
+    // Mark the path up to the root, stopping at the first node that's already marked since everything above it is too
+    for(int node = _objectLeaves[object]; node != -1 && !_isNodeDirty[node]; node = _nodes[node].parent)
+    {
+        _isNodeDirty[node] = true;
+        _dirtyNodes.push_back((unsigned int)node);
+    }
+}
+void BVH::Refit()
+{
+    if(_dirtyNodes.empty())
+        return;
+
+    // Children always come after their parents, so going through the nodes from the back
+    // recomputes every child before its parent
+    std::sort(_dirtyNodes.begin(), _dirtyNodes.end(), std::greater<unsigned int>());
+    for(unsigned int node: _dirtyNodes)
+    {
+        RecalculateNodeBounds(_nodes[node]);
+        _isNodeDirty[node] = false;
+    }
+    _dirtyNodes.clear();
+}
+#pragma endregion
+
+void BVH::Cull(const Frustum &frustum, std::vector<unsigned int> &visibleObjects, CullStats &stats) const
+{
+    stats = CullStats();
+    if(_nodes.empty())
+        return;
+
+    size_t visibleBefore = visibleObjects.size();
+    // The depth of a median split tree is about log2 of the amount of objects, 64 is plenty
+    unsigned int stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while(stackSize > 0)
+    {
+        const Node &node = _nodes[stack[--stackSize]];
+        stats.testedNodes++;
+
+        FrustumTestResult result = TestAABB(frustum, node.bounds);
+        if(result == FrustumTestResult::OUTSIDE)
+            continue;
+
+        // Everything below a node that's fully inside is visible, no need to test any further
+        if(result == FrustumTestResult::INSIDE)
+        {
+            visibleObjects.insert(visibleObjects.end(), _objectIndices.begin() + node.firstObject, _objectIndices.begin() + node.firstObject + node.objectCount);
+            continue;
+        }
+
+        if(node.isLeaf())
+        {
+            for(unsigned int i = node.firstObject; i < node.firstObject + node.objectCount; i++)
+            {
+                if(TestAABB(frustum, _objectBounds[_objectIndices[i]]) != FrustumTestResult::OUTSIDE)
+                    visibleObjects.push_back(_objectIndices[i]);
+            }
+        }
+        else
+        {
+            unsigned int nodeIndex = (unsigned int)(&node - _nodes.data());
+            stack[stackSize++] = node.rightChild;
+            stack[stackSize++] = nodeIndex + 1;
+        }
+    }
+
+    stats.visibleObjects = (unsigned int)(visibleObjects.size() - visibleBefore);
+    stats.culledObjects = (unsigned int)_objectBounds.size() - stats.visibleObjects;
+}
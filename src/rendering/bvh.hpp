@@ -0,0 +1,103 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <vector>
+#include <cstdint>
+
+struct AABB
+{
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    // Bounds of the box after transforming it, computed from the center and extents
+    // rather than by transforming all 8 corners
+    static AABB Transform(const glm::vec3 &min, const glm::vec3 &max, const glm::mat4 &transform);
+};
+
+// The 6 planes of a view frustum, laid out so that 4 planes can be tested against a box at once
+struct Frustum
+{
+    // Structure of arrays, planes 0-3 in the first lane group and 4-5 in the second.
+    // The 2 leftover lanes repeat the last plane so they never reject anything on their own
+    alignas(16) float normalX[8];
+    alignas(16) float normalY[8];
+    alignas(16) float normalZ[8];
+    alignas(16) float distance[8];
+
+    // Extracts the planes from a (model) view projection matrix, the planes end up in the space the matrix transforms from
+    static Frustum FromMatrix(const glm::mat4 &matrix);
+};
+
+enum class FrustumTestResult
+{
+    OUTSIDE,
+    INTERSECTING,
+    INSIDE
+};
+
+// Counters of the last BVH::Cull() call
+struct CullStats
+{
+    unsigned int visibleObjects = 0;
+    unsigned int culledObjects = 0;
+    unsigned int testedNodes = 0;
+};
+
+// Bounding volume hierarchy over a list of object bounds, used to find the objects inside of a view frustum
+// without testing every single one of them
+class BVH
+{
+    public:
+    // Leaves hold up to this many objects
+    static constexpr unsigned int MAX_LEAF_OBJECTS = 4;
+
+    private:
+    struct Node
+    {
+        AABB bounds;
+        int parent = -1;
+        // The left child always directly follows its parent, internal nodes only store the right one.
+        // 0 for leaves, the root is the only node at index 0
+        unsigned int rightChild = 0;
+        // Range of _objectIndices the whole subtree holds
+        unsigned int firstObject = 0;
+        unsigned int objectCount = 0;
+
+        inline bool isLeaf() const { return rightChild == 0; }
+    };
+    std::vector<Node> _nodes;
+    // Indices of the objects, ordered so that every leaf holds a contiguous range
+    std::vector<unsigned int> _objectIndices;
+    // Bounds of every object and the leaf it sits in
+    std::vector<AABB> _objectBounds;
+    std::vector<int> _objectLeaves;
+
+    // Nodes whose bounds must be recomputed by the next Refit()
+    std::vector<unsigned int> _dirtyNodes;
+    std::vector<bool> _isNodeDirty;
+
+    public:
+    // Builds the whole tree from scratch, splitting the objects at the median of the longest axis
+    void Build(const std::vector<AABB> &objectBounds);
+    // Changes the bounds of a single object, the tree only picks them up after Refit()
+    void UpdateObject(unsigned int object, const AABB &bounds);
+    // Recomputes the bounds of the nodes above the objects updated since the last refit. The tree's structure stays
+    // the same, so it slowly gets worse when objects move far from where they were when it was built
+    void Refit();
+
+    // Appends the indices of the objects which are at least partially inside of the frustum
+    void Cull(const Frustum &frustum, std::vector<unsigned int> &visibleObjects, CullStats &stats) const;
+
+    inline unsigned int getObjectCount() const { return (unsigned int)_objectBounds.size(); }
+    inline unsigned int getNodeCount() const { return (unsigned int)_nodes.size(); }
+    inline const AABB &getObjectBounds(unsigned int object) const { return _objectBounds[object]; }
+
+    static FrustumTestResult TestAABB(const Frustum &frustum, const AABB &box);
+
+    private:
+    unsigned int BuildNode(unsigned int start, unsigned int end, int parent);
+    void RecalculateNodeBounds(Node &node);
+};
@@ -0,0 +1,136 @@
+#include "dynamic_resolution.hpp"
+
+#include "core/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// How much of every new measurement goes into the smoothed GPU time
+static constexpr float SMOOTHING = 0.25f;
+// The scale only goes up once the frame fits into this fraction of the target, so it doesn't bounce around the target
+static constexpr float RAISE_THRESHOLD = 0.8f;
+// Steps the scale may move per measurement. It drops fast to get out of a slow frame quickly and climbs back carefully
+static constexpr float MAX_DROP_STEPS = 4.0f;
+static constexpr float MAX_RAISE_STEPS = 1.0f;
+
+void DynamicResolution::Init()
+{
+    GL_CALL(glad_glGenQueries(QUERY_COUNT, _queries));
+    _scale = settings.maxScale;
+}
+void DynamicResolution::DeInit()
+{
+    GL_CALL(glad_glDeleteQueries(QUERY_COUNT, _queries));
+    _pendingQueries = 0;
+
+    delete _target;
+    _target = nullptr;
+}
+
+glm::uvec2 DynamicResolution::BeginFrame(const glm::uvec2 &outputSize)
+{
+    CollectQueries();
+
+    // The settings could have been changed since the last frame
+    if(!settings.enabled)
+        _scale = settings.maxScale;
+    _scale = std::clamp(_scale, std::min(settings.minScale, settings.maxScale), settings.maxScale);
+
+    // Only a resized window reallocates the target
+    if(_target == nullptr)
+        _target = new RenderTarget(outputSize);
+    else
+        _target->Resize(outputSize);
+
+    glm::uvec2 renderSize;
+    renderSize.x = std::clamp((unsigned int)std::lround(outputSize.x * _scale), 1u, std::max(outputSize.x, 1u));
+    renderSize.y = std::clamp((unsigned int)std::lround(outputSize.y * _scale), 1u, std::max(outputSize.y, 1u));
+
+    _target->Bind();
+    GL_CALL(glad_glViewport(0, 0, renderSize.x, renderSize.y));
+
+    _timingFrame = _pendingQueries < QUERY_COUNT;
+    if(_timingFrame)
+    {
+        _queryScales[_nextQuery] = _scale;
+        GL_CALL(glad_glBeginQuery(GL_TIME_ELAPSED, _queries[_nextQuery]));
+    }
+
+    _stats.scale = _scale;
+    _stats.renderSize = renderSize;
+    _stats.outputSize = outputSize;
+    return renderSize;
+}
+void DynamicResolution::EndFrame()
+{
+    if(_timingFrame)
+    {
+        GL_CALL(glad_glEndQuery(GL_TIME_ELAPSED));
+        _nextQuery = (_nextQuery + 1) % QUERY_COUNT;
+        _pendingQueries++;
+    }
+
+    const glm::uvec2 &renderSize = _stats.renderSize;
+    const glm::uvec2 &outputSize = _stats.outputSize;
+
+    // Filtering only helps when the image actually gets stretched
+    GLenum filter = renderSize == outputSize ? GL_NEAREST : GL_LINEAR;
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, _target->getFramebuffer()));
+    GL_CALL(glad_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0));
+    GL_CALL(glad_glBlitFramebuffer(0, 0, renderSize.x, renderSize.y, 0, 0, outputSize.x, outputSize.y, GL_COLOR_BUFFER_BIT, filter));
+
+    // The UI gets drawn straight into the window at its full resolution
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, 0));
+    GL_CALL(glad_glViewport(0, 0, outputSize.x, outputSize.y));
+}
+
+void DynamicResolution::CollectQueries()
+{
+    while(_pendingQueries > 0)
+    {
+        unsigned int oldest = (_nextQuery + QUERY_COUNT - _pendingQueries) % QUERY_COUNT;
+
+        int available = 0;
+        GL_CALL(glad_glGetQueryObjectiv(_queries[oldest], GL_QUERY_RESULT_AVAILABLE, &available));
+        if(!available)
+            break;
+
+        GLuint64 elapsedNs = 0;
+        GL_CALL(glad_glGetQueryObjectui64v(_queries[oldest], GL_QUERY_RESULT, &elapsedNs));
+        _pendingQueries--;
+
+        AdjustScale((float)(elapsedNs / 1e6), _queryScales[oldest]);
+    }
+}
+
+void DynamicResolution::AdjustScale(float gpuTimeMs, float renderedScale)
+{
+    _stats.gpuTimeMs = gpuTimeMs;
+
+    // The GPU time grows with the pixel count, so the square of the scale. The results arrive a few frames late,
+    // predicting what the measured frame would have taken at the current scale keeps the scale from overshooting
+    float predictedTimeMs = gpuTimeMs * (_scale * _scale) / std::max(renderedScale * renderedScale, 1e-6f);
+    if(_stats.smoothedGpuTimeMs == 0.0f)
+        _stats.smoothedGpuTimeMs = predictedTimeMs;
+    else
+        _stats.smoothedGpuTimeMs += (predictedTimeMs - _stats.smoothedGpuTimeMs) * SMOOTHING;
+
+    if(!settings.enabled || _stats.smoothedGpuTimeMs <= 0.0f)
+        return;
+
+    float ratio = settings.targetFrameTimeMs / _stats.smoothedGpuTimeMs;
+    if(ratio >= 1.0f && ratio * RAISE_THRESHOLD < 1.0f)
+        return;
+
+    // Rounding down when over budget makes sure even a frame only slightly too slow gets a smaller scale
+    float desiredScale = _scale * std::sqrt(ratio) / SCALE_STEP;
+    desiredScale = (ratio < 1.0f ? std::floor(desiredScale) : std::round(desiredScale)) * SCALE_STEP;
+    desiredScale = std::clamp(desiredScale, _scale - MAX_DROP_STEPS * SCALE_STEP, _scale + MAX_RAISE_STEPS * SCALE_STEP);
+    desiredScale = std::clamp(desiredScale, std::min(settings.minScale, settings.maxScale), settings.maxScale);
+    if(desiredScale == _scale)
+        return;
+
+    // The smoothed time is kept in terms of the current scale
+    _stats.smoothedGpuTimeMs *= (desiredScale * desiredScale) / (_scale * _scale);
+    _scale = desiredScale;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+#include "misc/singleton.hpp"
+#include "render_target.hpp"
+
+#include <vector>
+
+struct DynamicResolutionSettings
+{
+    // Off renders at the maximum scale
+    bool enabled = true;
+    // GPU time the scene may take per frame, the UI isn't counted
+    float targetFrameTimeMs = 1000.0f / 60.0f;
+    // Fraction of the window's resolution on both axes
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+};
+
+struct DynamicResolutionStats
+{
+    float scale = 1.0f;
+    glm::uvec2 renderSize = glm::uvec2(0);
+    glm::uvec2 outputSize = glm::uvec2(0);
+    // Of the latest frame the GPU finished and averaged over the last few
+    float gpuTimeMs = 0.0f;
+    float smoothedGpuTimeMs = 0.0f;
+};
+
+// Renders the 3D viewport into an offscreen target at a fraction of the window's resolution and blits it up to the window.
+// The scene's GPU time is measured with timer queries, and the fraction is lowered when it goes over the target frame time
+// and raised again once there's room, so heavy models stay interactive on high resolution displays.
+// The target is always allocated at the window's full size and the scene is drawn into its lower left corner,
+// so changing the scale never reallocates anything, only resizing the window does
+class DynamicResolution final : public Singleton<DynamicResolution>
+{
+    friend class Singleton<DynamicResolution>;
+
+    public:
+    // Timer queries in flight, reading a result back only once it's available keeps the CPU from waiting on the GPU
+    static constexpr unsigned int QUERY_COUNT = 4;
+    // Scale changes are rounded to steps of this size, so the resolution doesn't change a tiny bit every frame
+    static constexpr float SCALE_STEP = 1.0f / 32.0f;
+
+    DynamicResolutionSettings settings;
+
+    private:
+    RenderTarget *_target = nullptr;
+
+    unsigned int _queries[QUERY_COUNT] = {};
+    // The scale each query's frame was rendered at
+    float _queryScales[QUERY_COUNT] = {};
+    // Queries are started in order and always collected oldest first
+    unsigned int _nextQuery = 0;
+    unsigned int _pendingQueries = 0;
+    // Whether the current frame is being timed, it isn't while all of the queries are still in flight
+    bool _timingFrame = false;
+
+    float _scale = 1.0f;
+    DynamicResolutionStats _stats;
+
+    private:
+    DynamicResolution() = default;
+    ~DynamicResolution() = default;
+
+    public:
+    void Init();
+    void DeInit();
+
+    // Binds the offscreen target with the viewport covering the part the scene gets drawn into, and starts timing the frame.
+    // Returns the size the scene is rendered at, which is what the camera's viewport size should be set to
+    glm::uvec2 BeginFrame(const glm::uvec2 &outputSize);
+    // Stops timing and upscales the frame into the window's framebuffer, which is left bound for the UI
+    void EndFrame();
+
+    inline const DynamicResolutionStats &getStats() const { return _stats; }
+
+    private:
+    // Reads back the timer queries the GPU finished and adapts the scale to the latest result
+    void CollectQueries();
+    void AdjustScale(float gpuTimeMs, float renderedScale);
+};
@@ -0,0 +1,334 @@
+#include "geometry_arena.hpp"
+
+#include "core/log.hpp"
+#include "gl_state_cache.hpp"
+#include "model.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#pragma region Range allocator
+RangeAllocator::RangeAllocator(size_t capacity)
+    : _capacity(capacity)
+{
+    if(capacity > 0)
+        _freeRanges.push_back({ 0, capacity });
+}
+
+size_t RangeAllocator::Allocate(size_t size)
+{
+    if(size == 0)
+        return INVALID_OFFSET;
+
+    for(auto it = _freeRanges.begin(); it != _freeRanges.end(); it++)
+    {
+        if(it->size < size)
+            continue;
+
+        // Take the front of the range so the rest of it stays where it is in the sorted list
+        size_t offset = it->offset;
+        it->offset += size;
+        it->size -= size;
+        if(it->size == 0)
+            _freeRanges.erase(it);
+        return offset;
+    }
+    return INVALID_OFFSET;
+}
+void RangeAllocator::Free(size_t offset, size_t size)
+{
+    if(size == 0)
+        return;
+
+    auto next = std::lower_bound(_freeRanges.begin(), _freeRanges.end(), offset,
+        [](const FreeRange &range, size_t offset) { return range.offset < offset; });
+
+    // Merge with the free ranges right before and after it, so the pool doesn't end up split into lots of tiny ranges
+    bool mergesWithPrevious = next != _freeRanges.begin() && (next - 1)->offset + (next - 1)->size == offset;
+    bool mergesWithNext = next != _freeRanges.end() && offset + size == next->offset;
+
+    if(mergesWithPrevious && mergesWithNext)
+    {
+        (next - 1)->size += size + next->size;
+        _freeRanges.erase(next);
+    }
+    else if(mergesWithPrevious)
+    {
+        (next - 1)->size += size;
+    }
+    else if(mergesWithNext)
+    {
+        next->offset = offset;
+        next->size += size;
+    }
+    else
+    {
+        _freeRanges.insert(next, { offset, size });
+    }
+}
+
+void RangeAllocator::Grow(size_t capacity)
+{
+    if(capacity <= _capacity)
+        return;
+
+    size_t oldCapacity = _capacity;
+    _capacity = capacity;
+    // Merges with a free range at the end of the old capacity
+    Free(oldCapacity, capacity - oldCapacity);
+}
+
+size_t RangeAllocator::getFreeSize() const
+{
+    size_t freeSize = 0;
+    for(const FreeRange &range: _freeRanges)
+        freeSize += range.size;
+    return freeSize;
+}
+size_t RangeAllocator::getLargestFreeSize() const
+{
+    size_t largestSize = 0;
+    for(const FreeRange &range: _freeRanges)
+        largestSize = std::max(largestSize, range.size);
+    return largestSize;
+}
+#pragma endregion
+
+// The capacity a pool's vertices or indices have to grow to for the given amount to fit, doubled up to the maximum capacity.
+// Returns the current capacity if they fit already or it can't grow far enough
+static size_t GetGrownCapacity(const RangeAllocator &allocator, size_t count, size_t maxCapacity)
+{
+    size_t capacity = allocator.getCapacity();
+    if(allocator.getLargestFreeSize() >= count)
+        return capacity;
+
+    // Large enough to fit the whole amount behind everything that's in the pool already, even if the free ranges are scattered
+    size_t grownCapacity = capacity;
+    while(grownCapacity < capacity + count && grownCapacity < maxCapacity)
+        grownCapacity *= 2;
+    grownCapacity = std::min(grownCapacity, std::max(maxCapacity, capacity));
+    return grownCapacity >= capacity + count ? grownCapacity : capacity;
+}
+
+void GeometryArena::DeInit()
+{
+    GLStateCache::getInstance().BindVertexArray(0);
+
+    for(Pool &pool: _pools)
+    {
+        GL_CALL(glad_glDeleteBuffers(1, &pool.EBO));
+        GL_CALL(glad_glDeleteBuffers(1, &pool.VBO));
+        GLStateCache::getInstance().ForgetVertexArray(pool.VAO);
+        GL_CALL(glad_glDeleteVertexArrays(1, &pool.VAO));
+    }
+    _pools.clear();
+}
+
+GeometryAllocation GeometryArena::Allocate(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+{
+    GeometryAllocation allocation;
+    if(vertices.empty() || indices.empty())
+        return allocation;
+
+    // The vertices and indices must both come from the same pool, so a pool only counts if both of them fit
+    auto tryAllocate = [&](Pool &pool, size_t &baseVertex, size_t &firstIndex)
+    {
+        baseVertex = pool.vertices.Allocate(vertices.size());
+        if(baseVertex == RangeAllocator::INVALID_OFFSET)
+            return false;
+
+        firstIndex = pool.indices.Allocate(indices.size());
+        if(firstIndex == RangeAllocator::INVALID_OFFSET)
+        {
+            pool.vertices.Free(baseVertex, vertices.size());
+            return false;
+        }
+        return true;
+    };
+
+    int poolIndex = -1;
+    size_t baseVertex = RangeAllocator::INVALID_OFFSET, firstIndex = RangeAllocator::INVALID_OFFSET;
+    for(int i = 0; i < (int)_pools.size() && poolIndex == -1; i++)
+    {
+        if(tryAllocate(_pools[i], baseVertex, firstIndex))
+            poolIndex = i;
+    }
+    // Growing a pool keeps the models in it sharing one VAO, a new pool is only started once they're all at their maximum capacity
+    for(int i = 0; i < (int)_pools.size() && poolIndex == -1; i++)
+    {
+        if(GrowPool(_pools[i], vertices.size(), indices.size()) && tryAllocate(_pools[i], baseVertex, firstIndex))
+            poolIndex = i;
+    }
+
+    if(poolIndex == -1)
+    {
+        poolIndex = CreatePool(std::max(vertices.size(), MIN_POOL_VERTEX_CAPACITY), std::max(indices.size(), MIN_POOL_INDEX_CAPACITY));
+        baseVertex = _pools[poolIndex].vertices.Allocate(vertices.size());
+        firstIndex = _pools[poolIndex].indices.Allocate(indices.size());
+    }
+
+    allocation.pool = poolIndex;
+    allocation.baseVertex = baseVertex;
+    allocation.firstIndex = firstIndex;
+    allocation.vertexCount = vertices.size();
+    allocation.indexCount = indices.size();
+
+    // Uploaded through the copy target so that the element buffer binding of whatever VAO is bound stays untouched
+    const Pool &pool = _pools[poolIndex];
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, pool.VBO));
+    GL_CALL(glad_glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(Vertex) * baseVertex, sizeof(Vertex) * vertices.size(), (void*)vertices.data()));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, pool.EBO));
+    GL_CALL(glad_glBufferSubData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * firstIndex, sizeof(unsigned int) * indices.size(), (void*)indices.data()));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    return allocation;
+}
+void GeometryArena::Free(const GeometryAllocation &allocation)
+{
+    if(!allocation.isValid() || allocation.pool >= (int)_pools.size())
+        return;
+
+    // The data is left in the buffers, the ranges just get handed out again
+    _pools[allocation.pool].vertices.Free(allocation.baseVertex, allocation.vertexCount);
+    _pools[allocation.pool].indices.Free(allocation.firstIndex, allocation.indexCount);
+}
+
+void GeometryArena::AttachInstanceBuffer(int pool, unsigned int buffer)
+{
+    if(_pools[pool].instanceBuffer == buffer)
+        return;
+    _pools[pool].instanceBuffer = buffer;
+
+    GLStateCache::getInstance().BindVertexArray(_pools[pool].VAO);
+    GL_CALL(glad_glBindBuffer(GL_ARRAY_BUFFER, buffer));
+
+    // A mat4 attribute takes up 4 consecutive locations, one per column.
+    // The divisor makes every column advance once per instance instead of once per vertex
+    for(unsigned int column = 0; column < 4; column++)
+    {
+        unsigned int location = 3 + column;
+        GL_CALL(glad_glVertexAttribPointer(location, 4, GL_FLOAT, false, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * column)));
+        GL_CALL(glad_glEnableVertexAttribArray(location));
+        GL_CALL(glad_glVertexAttribDivisor(location, 1));
+    }
+
+    GLStateCache::getInstance().BindVertexArray(0);
+    GL_CALL(glad_glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void GeometryArena::ForgetInstanceBuffer(unsigned int buffer)
+{
+    for(Pool &pool: _pools)
+    {
+        if(pool.instanceBuffer == buffer)
+            pool.instanceBuffer = 0;
+    }
+}
+
+GeometryArenaStats GeometryArena::getStats() const
+{
+    GeometryArenaStats stats;
+    stats.pools = (unsigned int)_pools.size();
+    for(const Pool &pool: _pools)
+    {
+        stats.allocatedBytes += sizeof(Vertex) * pool.vertices.getCapacity() + sizeof(unsigned int) * pool.indices.getCapacity();
+        stats.usedBytes += sizeof(Vertex) * (pool.vertices.getCapacity() - pool.vertices.getFreeSize())
+                         + sizeof(unsigned int) * (pool.indices.getCapacity() - pool.indices.getFreeSize());
+    }
+    return stats;
+}
+
+int GeometryArena::CreatePool(size_t vertexCapacity, size_t indexCapacity)
+{
+    Pool pool;
+    pool.vertices = RangeAllocator(vertexCapacity);
+    pool.indices = RangeAllocator(indexCapacity);
+
+    GL_CALL(glad_glGenVertexArrays(1, &pool.VAO));
+    GL_CALL(glad_glGenBuffers(1, &pool.VBO));
+    GL_CALL(glad_glGenBuffers(1, &pool.EBO));
+
+    // Allocated through the copy target so that the element buffer binding of whatever VAO is bound stays untouched
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, pool.VBO));
+    GL_CALL(glad_glBufferData(GL_COPY_WRITE_BUFFER, sizeof(Vertex) * vertexCapacity, nullptr, GL_STATIC_DRAW));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, pool.EBO));
+    GL_CALL(glad_glBufferData(GL_COPY_WRITE_BUFFER, sizeof(unsigned int) * indexCapacity, nullptr, GL_STATIC_DRAW));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+
+    SetupVertexFormat(pool);
+
+    Log::LogInfo("Created geometry pool " + std::to_string(_pools.size()) + " (" + std::to_string(vertexCapacity) + " vertices, " + std::to_string(indexCapacity) + " indices)");
+
+    _pools.push_back(std::move(pool));
+    return (int)_pools.size() - 1;
+}
+
+bool GeometryArena::GrowPool(Pool &pool, size_t vertexCount, size_t indexCount)
+{
+    size_t oldVertexCapacity = pool.vertices.getCapacity(), oldIndexCapacity = pool.indices.getCapacity();
+    size_t vertexCapacity = GetGrownCapacity(pool.vertices, vertexCount, POOL_VERTEX_CAPACITY);
+    size_t indexCapacity = GetGrownCapacity(pool.indices, indexCount, POOL_INDEX_CAPACITY);
+    // Nothing to do if either of them can't grow far enough. Pools of models larger than the maximum capacity never grow
+    bool verticesFit = vertexCapacity != oldVertexCapacity || pool.vertices.getLargestFreeSize() >= vertexCount;
+    bool indicesFit = indexCapacity != oldIndexCapacity || pool.indices.getLargestFreeSize() >= indexCount;
+    if(!verticesFit || !indicesFit || (vertexCapacity == oldVertexCapacity && indexCapacity == oldIndexCapacity))
+        return false;
+
+    if(vertexCapacity != oldVertexCapacity)
+    {
+        pool.VBO = ReallocateBuffer(pool.VBO, sizeof(Vertex) * oldVertexCapacity, sizeof(Vertex) * vertexCapacity);
+        pool.vertices.Grow(vertexCapacity);
+    }
+    if(indexCapacity != oldIndexCapacity)
+    {
+        pool.EBO = ReallocateBuffer(pool.EBO, sizeof(unsigned int) * oldIndexCapacity, sizeof(unsigned int) * indexCapacity);
+        pool.indices.Grow(indexCapacity);
+    }
+    SetupVertexFormat(pool);
+
+    Log::LogInfo("Grew geometry pool " + std::to_string(&pool - _pools.data()) + " to " + std::to_string(vertexCapacity) + " vertices and " + std::to_string(indexCapacity) + " indices");
+    return true;
+}
+
+unsigned int GeometryArena::ReallocateBuffer(unsigned int buffer, size_t oldSize, size_t newSize)
+{
+    unsigned int newBuffer = 0;
+    GL_CALL(glad_glGenBuffers(1, &newBuffer));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer));
+    GL_CALL(glad_glBufferData(GL_COPY_WRITE_BUFFER, newSize, nullptr, GL_STATIC_DRAW));
+    GL_CALL(glad_glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+    GL_CALL(glad_glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize));
+    GL_CALL(glad_glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    GL_CALL(glad_glDeleteBuffers(1, &buffer));
+    return newBuffer;
+}
+
+void GeometryArena::SetupVertexFormat(const Pool &pool)
+{
+    GLStateCache::getInstance().BindVertexArray(pool.VAO);
+
+    GL_CALL(glad_glBindBuffer(GL_ARRAY_BUFFER, pool.VBO));
+    // The element buffer binding is part of the VAO's state, so it must stay bound until the VAO is unbound
+    GL_CALL(glad_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.EBO));
+
+    /*
+                        Vertex format:
+            Position     Tex coords       Normal
+        vx   vy   vz   \   u   v   \   nx   ny   nz
+    */
+    // Vertex position
+    GL_CALL(glad_glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), (void*)0));
+    GL_CALL(glad_glEnableVertexAttribArray(0));
+    // UV coords
+    GL_CALL(glad_glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(Vertex), (void*)(sizeof(glm::vec3))));
+    GL_CALL(glad_glEnableVertexAttribArray(1));
+    // Normals
+    GL_CALL(glad_glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(Vertex), (void*)(sizeof(glm::vec3) + sizeof(glm::vec2))));
+    GL_CALL(glad_glEnableVertexAttribArray(2));
+
+    GLStateCache::getInstance().BindVertexArray(0);
+    GL_CALL(glad_glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL_CALL(glad_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "misc/singleton.hpp"
+
+#include <vector>
+#include <cstddef>
+
+struct Vertex;
+
+// First fit allocator over a range of elements, freed neighbouring ranges get merged back together
+class RangeAllocator
+{
+    public:
+    static constexpr size_t INVALID_OFFSET = (size_t)-1;
+
+    private:
+    struct FreeRange
+    {
+        size_t offset;
+        size_t size;
+    };
+    // Sorted by offset
+    std::vector<FreeRange> _freeRanges;
+    size_t _capacity = 0;
+
+    public:
+    RangeAllocator() = default;
+    explicit RangeAllocator(size_t capacity);
+
+    // Returns INVALID_OFFSET if there isn't a free range large enough
+    size_t Allocate(size_t size);
+    void Free(size_t offset, size_t size);
+    // Adds the range between the old and the new capacity to the free ranges, the allocated ranges stay where they are
+    void Grow(size_t capacity);
+
+    inline size_t getCapacity() const { return _capacity; }
+    size_t getFreeSize() const;
+    size_t getLargestFreeSize() const;
+};
+
+// Where a model's vertices and indices ended up inside of the arena
+struct GeometryAllocation
+{
+    int pool = -1;
+    // Added to every index by the draw call, so the indices stay relative to the model's own vertices
+    size_t baseVertex = 0;
+    size_t firstIndex = 0;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+
+    inline bool isValid() const { return pool != -1; }
+};
+
+struct GeometryArenaStats
+{
+    unsigned int pools = 0;
+    size_t allocatedBytes = 0;
+    size_t usedBytes = 0;
+};
+
+// Large shared vertex and index buffers the models get suballocated from.
+// Every pool has a single VAO, so all of the models in a pool can be drawn without switching VAOs
+// and with a single multi-draw call. A pool starts out as large as its first model needs and doubles
+// whenever a model doesn't fit anymore, so a single small model doesn't reserve the full capacity up front
+class GeometryArena : public Singleton<GeometryArena>
+{
+    public:
+    // Capacities a pool grows up to (32 MB of vertices and 16 MB of indices), models that don't fit start a new pool.
+    // A model larger than these gets a pool of its own size
+    static constexpr size_t POOL_VERTEX_CAPACITY = 1024 * 1024;
+    static constexpr size_t POOL_INDEX_CAPACITY = 4 * 1024 * 1024;
+    // Capacities a new pool gets at least, so that loading a few small models doesn't reallocate on every one
+    static constexpr size_t MIN_POOL_VERTEX_CAPACITY = 16 * 1024;
+    static constexpr size_t MIN_POOL_INDEX_CAPACITY = 64 * 1024;
+
+    private:
+    struct Pool
+    {
+        unsigned int VAO = 0, VBO = 0, EBO = 0;
+        RangeAllocator vertices;
+        RangeAllocator indices;
+        // Per-instance transforms the VAO currently reads from
+        unsigned int instanceBuffer = 0;
+    };
+    std::vector<Pool> _pools;
+
+    public:
+    void DeInit();
+
+    // Uploads the geometry into the first pool with enough space, creating a new pool if none has any
+    GeometryAllocation Allocate(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices);
+    void Free(const GeometryAllocation &allocation);
+
+    inline unsigned int getVAO(int pool) const { return _pools[pool].VAO; }
+    inline unsigned int getVBO(int pool) const { return _pools[pool].VBO; }
+    inline unsigned int getEBO(int pool) const { return _pools[pool].EBO; }
+    // Points the per-instance model matrix attribute (locations 3 to 6) of the pool's VAO at the given buffer.
+    // The buffer holds one tightly packed mat4 per instance
+    void AttachInstanceBuffer(int pool, unsigned int buffer);
+    // Must be called when an attached buffer gets deleted, so a new buffer reusing its name still gets attached
+    void ForgetInstanceBuffer(unsigned int buffer);
+
+    GeometryArenaStats getStats() const;
+
+    private:
+    int CreatePool(size_t vertexCapacity, size_t indexCapacity);
+    // Returns false if the pool is at its maximum capacity already or wouldn't fit the geometry even at it
+    bool GrowPool(Pool &pool, size_t vertexCount, size_t indexCount);
+    // Points the VAO's vertex attributes and element buffer at the pool's current buffers
+    static void SetupVertexFormat(const Pool &pool);
+    // Copies the contents of the buffer into a new one of the given size and deletes the old one
+    static unsigned int ReallocateBuffer(unsigned int buffer, size_t oldSize, size_t newSize);
+};
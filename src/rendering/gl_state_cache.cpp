@@ -0,0 +1,165 @@
+#include "gl_state_cache.hpp"
+
+#include "core/log.hpp"
+
+void GLStateCache::Invalidate()
+{
+    _program = UNKNOWN;
+    _vertexArray = UNKNOWN;
+    _activeTextureUnit = UNKNOWN;
+    _textures.fill(TextureBinding());
+    _uniformBuffers.fill(BufferRangeBinding());
+    _capabilities.clear();
+    _polygonMode = UNKNOWN;
+    _isClearColorKnown = false;
+}
+
+#pragma region Fixed function state
+void GLStateCache::SetCapability(unsigned int capability, bool enabled)
+{
+    auto it = _capabilities.find(capability);
+    if(!ShouldChange(it == _capabilities.end() || it->second != enabled))
+        return;
+
+    _capabilities[capability] = enabled;
+    if(enabled)
+    {
+        GL_CALL(glad_glEnable(capability));
+    }
+    else
+    {
+        GL_CALL(glad_glDisable(capability));
+    }
+}
+void GLStateCache::SetPolygonMode(unsigned int mode)
+{
+    if(!ShouldChange(_polygonMode != mode))
+        return;
+
+    _polygonMode = mode;
+    GL_CALL(glad_glPolygonMode(GL_FRONT_AND_BACK, mode));
+}
+void GLStateCache::SetClearColor(const glm::vec4 &color)
+{
+    if(!ShouldChange(!_isClearColorKnown || _clearColor != color))
+        return;
+
+    _clearColor = color;
+    _isClearColorKnown = true;
+    GL_CALL(glad_glClearColor(color.x, color.y, color.z, color.w));
+}
+#pragma endregion
+
+#pragma region Bindings
+void GLStateCache::UseProgram(unsigned int program)
+{
+    if(!ShouldChange(_program != program))
+        return;
+
+    _program = program;
+    GL_CALL(glad_glUseProgram(program));
+}
+void GLStateCache::BindVertexArray(unsigned int vertexArray)
+{
+    if(!ShouldChange(_vertexArray != vertexArray))
+        return;
+
+    _vertexArray = vertexArray;
+    GL_CALL(glad_glBindVertexArray(vertexArray));
+}
+void GLStateCache::BindTexture(unsigned int target, unsigned int texture)
+{
+    // Without knowing the active unit there's nowhere to remember the binding, so it has to go to the driver
+    if(_activeTextureUnit >= MAX_TEXTURE_UNITS)
+    {
+        _stats.stateChanges++;
+        GL_CALL(glad_glBindTexture(target, texture));
+        return;
+    }
+
+    TextureBinding &binding = _textures[_activeTextureUnit];
+    if(!ShouldChange(binding.target != target || binding.texture != texture))
+        return;
+
+    binding.target = target;
+    binding.texture = texture;
+    GL_CALL(glad_glBindTexture(target, texture));
+}
+void GLStateCache::BindTextureToUnit(unsigned int unit, unsigned int target, unsigned int texture)
+{
+    if(unit >= MAX_TEXTURE_UNITS)
+    {
+        Log::LogError("Texture unit " + std::to_string(unit) + " is out of the cached range");
+        return;
+    }
+
+    TextureBinding &binding = _textures[unit];
+    if(!ShouldChange(binding.target != target || binding.texture != texture))
+        return;
+
+    SetActiveTextureUnit(unit);
+    binding.target = target;
+    binding.texture = texture;
+    GL_CALL(glad_glBindTexture(target, texture));
+}
+void GLStateCache::SetActiveTextureUnit(unsigned int unit)
+{
+    if(!ShouldChange(_activeTextureUnit != unit))
+        return;
+
+    _activeTextureUnit = unit;
+    GL_CALL(glad_glActiveTexture(GL_TEXTURE0 + unit));
+}
+void GLStateCache::BindUniformBufferBase(unsigned int binding, unsigned int buffer)
+{
+    BindUniformBufferRange(binding, buffer, 0, 0);
+}
+void GLStateCache::BindUniformBufferRange(unsigned int binding, unsigned int buffer, ptrdiff_t offset, ptrdiff_t size)
+{
+    if(binding >= MAX_UNIFORM_BUFFER_BINDINGS)
+    {
+        Log::LogError("Uniform buffer binding " + std::to_string(binding) + " is out of the cached range");
+        return;
+    }
+
+    BufferRangeBinding &cached = _uniformBuffers[binding];
+    if(!ShouldChange(cached.buffer != buffer || cached.offset != offset || cached.size != size))
+        return;
+
+    cached.buffer = buffer;
+    cached.offset = offset;
+    cached.size = size;
+    // A size of 0 marks the whole buffer
+    if(size == 0)
+    {
+        GL_CALL(glad_glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer));
+    }
+    else
+    {
+        GL_CALL(glad_glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size));
+    }
+}
+#pragma endregion
+
+#pragma region Deleted objects
+void GLStateCache::ForgetProgram(unsigned int program)
+{
+    if(_program == program)
+        _program = UNKNOWN;
+}
+void GLStateCache::ForgetVertexArray(unsigned int vertexArray)
+{
+    // Deleting the bound VAO makes the driver fall back to 0
+    if(_vertexArray == vertexArray)
+        _vertexArray = 0;
+}
+void GLStateCache::ForgetTexture(unsigned int texture)
+{
+    // Deleting a texture unbinds it from every unit it's bound to
+    for(TextureBinding &binding: _textures)
+    {
+        if(binding.texture == texture)
+            binding.texture = 0;
+    }
+}
+#pragma endregion
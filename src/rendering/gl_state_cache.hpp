@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec4.hpp>
+
+#include "misc/singleton.hpp"
+
+#include <array>
+#include <unordered_map>
+#include <cstddef>
+
+// Counters gathered since the last ResetStats()
+struct GLStateCacheStats
+{
+    // Calls that reached the driver
+    unsigned int stateChanges = 0;
+    // Calls that were dropped because the state already had the requested value
+    unsigned int stateChangesAvoided = 0;
+};
+
+// Mirrors the parts of the GL state the renderer changes all the time, so that setting a value
+// which is already current never reaches the driver.
+// Only works as long as these states are changed through the cache. Code that changes them
+// directly (eg. the ImGui backend) must be followed by Invalidate()
+class GLStateCache : public Singleton<GLStateCache>
+{
+    public:
+    static constexpr unsigned int MAX_TEXTURE_UNITS = 32;
+    static constexpr unsigned int MAX_UNIFORM_BUFFER_BINDINGS = 16;
+
+    private:
+    // Value of a state that isn't known, the next call that sets it always goes to the driver
+    static constexpr unsigned int UNKNOWN = 0xFFFFFFFF;
+
+    struct TextureBinding
+    {
+        unsigned int target = UNKNOWN;
+        unsigned int texture = UNKNOWN;
+    };
+    struct BufferRangeBinding
+    {
+        unsigned int buffer = UNKNOWN;
+        // Both are 0 for buffers bound as a whole
+        ptrdiff_t offset = 0;
+        ptrdiff_t size = 0;
+    };
+
+    unsigned int _program = UNKNOWN;
+    unsigned int _vertexArray = UNKNOWN;
+    unsigned int _activeTextureUnit = UNKNOWN;
+    std::array<TextureBinding, MAX_TEXTURE_UNITS> _textures;
+    std::array<BufferRangeBinding, MAX_UNIFORM_BUFFER_BINDINGS> _uniformBuffers;
+    // glEnable/glDisable capabilities, missing ones are unknown
+    std::unordered_map<unsigned int, bool> _capabilities;
+    unsigned int _polygonMode = UNKNOWN;
+    glm::vec4 _clearColor = glm::vec4(0.0f);
+    bool _isClearColorKnown = false;
+
+    GLStateCacheStats _stats;
+
+    public:
+    // Forgets all of the cached values
+    void Invalidate();
+
+    void SetCapability(unsigned int capability, bool enabled);
+    void SetPolygonMode(unsigned int mode);
+    void SetClearColor(const glm::vec4 &color);
+
+    void UseProgram(unsigned int program);
+    void BindVertexArray(unsigned int vertexArray);
+    // Binds the texture to the active texture unit
+    void BindTexture(unsigned int target, unsigned int texture);
+    // Only switches the active texture unit if the binding of the unit actually changes
+    void BindTextureToUnit(unsigned int unit, unsigned int target, unsigned int texture);
+    void SetActiveTextureUnit(unsigned int unit);
+    void BindUniformBufferBase(unsigned int binding, unsigned int buffer);
+    void BindUniformBufferRange(unsigned int binding, unsigned int buffer, ptrdiff_t offset, ptrdiff_t size);
+
+    // Must be called when the objects get deleted, because the driver can hand out the same name to a new object
+    // while the cache would still consider it bound
+    void ForgetProgram(unsigned int program);
+    void ForgetVertexArray(unsigned int vertexArray);
+    void ForgetTexture(unsigned int texture);
+
+    inline const GLStateCacheStats &getStats() const { return _stats; }
+    inline void ResetStats() { _stats = GLStateCacheStats(); }
+
+    private:
+    // Counts the call and returns whether it has to reach the driver
+    inline bool ShouldChange(bool isDifferent)
+    {
+        if(isDifferent)
+            _stats.stateChanges++;
+        else
+            _stats.stateChangesAvoided++;
+        return isDifferent;
+    }
+};
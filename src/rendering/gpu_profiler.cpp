@@ -0,0 +1,222 @@
+#include "gpu_profiler.hpp"
+
+#include "core/log.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+void GPUProfiler::Init()
+{
+    // Implementations are allowed to report 0 bits, which means there are no timestamps to be had
+    int timestampBits = 0;
+    GL_CALL(glad_glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits));
+    _supported = timestampBits > 0;
+    if(!_supported)
+        Log::LogWarning("The GL implementation has no timestamp queries, GPU profiling disabled");
+}
+void GPUProfiler::DeInit()
+{
+    for(FrameQueries &frame: _frames)
+    {
+        if(!frame.queries.empty())
+        {
+            GL_CALL(glad_glDeleteQueries((int)frame.queries.size(), frame.queries.data()));
+        }
+        frame = FrameQueries();
+    }
+    _currentFrame = nullptr;
+}
+
+void GPUProfiler::BeginFrame()
+{
+    _currentFrame = nullptr;
+    _openScopes.clear();
+    if(!_supported)
+        return;
+
+    // Oldest first, a frame's results only count once all of the earlier ones are in
+    FrameQueries *pendingFrames[FRAME_LATENCY];
+    unsigned int pendingCount = 0;
+    for(FrameQueries &frame: _frames)
+    {
+        if(frame.pending)
+            pendingFrames[pendingCount++] = &frame;
+    }
+    std::sort(pendingFrames, pendingFrames + pendingCount, [](const FrameQueries *a, const FrameQueries *b) { return a->frame < b->frame; });
+    for(unsigned int i = 0; i < pendingCount && CollectFrame(*pendingFrames[i]); i++);
+
+    unsigned long long frameNumber = _frame++;
+    if(!settings.enabled)
+        return;
+
+    FrameQueries &frame = _frames[frameNumber % FRAME_LATENCY];
+    if(frame.pending)
+    {
+        // Waiting for the GPU to catch up would be exactly the stall the pools are there to avoid
+        _stats.droppedFrames++;
+        return;
+    }
+
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+    frame.frame = frameNumber;
+    _currentFrame = &frame;
+    BeginScope(FRAME_SCOPE);
+}
+void GPUProfiler::EndFrame()
+{
+    if(_currentFrame == nullptr)
+        return;
+
+    // Closes the frame scope along with anything left open
+    while(!_openScopes.empty())
+        EndScope();
+
+    _currentFrame->pending = true;
+    _currentFrame = nullptr;
+}
+
+void GPUProfiler::BeginScope(const char *name)
+{
+    if(_currentFrame == nullptr)
+        return;
+
+    ScopeRecord scope;
+    scope.name = name;
+    scope.depth = (unsigned int)_openScopes.size();
+    scope.beginQuery = WriteTimestamp();
+    _openScopes.push_back((unsigned int)_currentFrame->scopes.size());
+    _currentFrame->scopes.push_back(scope);
+}
+void GPUProfiler::EndScope()
+{
+    if(_currentFrame == nullptr || _openScopes.empty())
+        return;
+
+    _currentFrame->scopes[_openScopes.back()].endQuery = WriteTimestamp();
+    _openScopes.pop_back();
+}
+
+bool GPUProfiler::ExportCSV(const std::string &path) const
+{
+    std::ofstream file(path);
+    if(!file)
+    {
+        Log::LogError("Couldn't open '" + path + "' for the GPU profile");
+        return false;
+    }
+
+    file << "frame,scope,depth,start_ms,duration_ms\n";
+    for(const CollectedFrame &frame: _collectedFrames)
+    {
+        for(const CollectedScope &scope: frame.scopes)
+        {
+            const GPUScopeStats &stats = _scopeStats[scope.scope];
+            file << frame.frame << ',' << stats.name << ',' << stats.depth << ',' << scope.startMs << ',' << scope.durationMs << '\n';
+        }
+    }
+
+    if(!file)
+    {
+        Log::LogError("Failed writing the GPU profile to '" + path + "'");
+        return false;
+    }
+    Log::LogInfo("Wrote " + std::to_string(_collectedFrames.size()) + " frames of GPU timings to '" + path + "'");
+    return true;
+}
+
+unsigned int GPUProfiler::WriteTimestamp()
+{
+    FrameQueries &frame = *_currentFrame;
+    if(frame.usedQueries == frame.queries.size())
+    {
+        unsigned int query = 0;
+        GL_CALL(glad_glGenQueries(1, &query));
+        frame.queries.push_back(query);
+    }
+
+    GL_CALL(glad_glQueryCounter(frame.queries[frame.usedQueries], GL_TIMESTAMP));
+    return frame.usedQueries++;
+}
+
+bool GPUProfiler::CollectFrame(FrameQueries &frame)
+{
+    // The timestamps get written in order, once the last one is there all of them are
+    int available = 0;
+    GL_CALL(glad_glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available));
+    if(!available)
+        return false;
+
+    std::vector<GLuint64> timestamps(frame.usedQueries);
+    for(unsigned int i = 0; i < frame.usedQueries; i++)
+    {
+        GL_CALL(glad_glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &timestamps[i]));
+    }
+    frame.pending = false;
+
+    CollectedFrame collected;
+    collected.frame = frame.frame;
+    collected.scopes.reserve(frame.scopes.size());
+    GLuint64 frameStart = timestamps[frame.scopes[0].beginQuery];
+
+    // A scope that's opened several times in a frame (e.g. in a loop) adds up to one sample
+    std::vector<float> frameTotals(_scopeStats.size(), -1.0f);
+    for(const ScopeRecord &record: frame.scopes)
+    {
+        auto it = _scopeIndices.find(record.name);
+        if(it == _scopeIndices.end())
+        {
+            GPUScopeStats stats;
+            stats.name = record.name;
+            stats.depth = record.depth;
+            stats.history.reserve(HISTORY_SIZE);
+            it = _scopeIndices.emplace(stats.name, (unsigned int)_scopeStats.size()).first;
+            _scopeStats.push_back(std::move(stats));
+            frameTotals.push_back(-1.0f);
+        }
+
+        // The clock may wrap around or a driver may report garbage, neither is worth a negative duration
+        GLuint64 begin = timestamps[record.beginQuery], end = timestamps[record.endQuery];
+        float durationMs = end > begin ? (float)((end - begin) / 1e6) : 0.0f;
+        float startMs = begin > frameStart ? (float)((begin - frameStart) / 1e6) : 0.0f;
+
+        frameTotals[it->second] = std::max(frameTotals[it->second], 0.0f) + durationMs;
+        collected.scopes.push_back({ it->second, startMs, durationMs });
+    }
+    for(unsigned int i = 0; i < frameTotals.size(); i++)
+    {
+        if(frameTotals[i] >= 0.0f)
+        {
+            AddSample(_scopeStats[i], frameTotals[i]);
+            _scopeStats[i].lastSeenFrame = frame.frame;
+        }
+    }
+
+    _collectedFrames.push_back(std::move(collected));
+    if(_collectedFrames.size() > HISTORY_SIZE)
+        _collectedFrames.pop_front();
+
+    _stats.profiledFrames++;
+    _stats.latencyFrames = (unsigned int)(_frame - frame.frame);
+    return true;
+}
+
+void GPUProfiler::AddSample(GPUScopeStats &scope, float durationMs)
+{
+    if(scope.history.size() < HISTORY_SIZE)
+        scope.history.push_back(durationMs);
+    else
+        scope.history[scope.historyNext] = durationMs;
+    scope.historyNext = (scope.historyNext + 1) % HISTORY_SIZE;
+
+    scope.lastMs = durationMs;
+    float sum = 0.0f;
+    scope.minMs = scope.maxMs = durationMs;
+    for(float sample: scope.history)
+    {
+        sum += sample;
+        scope.minMs = std::min(scope.minMs, sample);
+        scope.maxMs = std::max(scope.maxMs, sample);
+    }
+    scope.averageMs = sum / (float)scope.history.size();
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "misc/singleton.hpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+// Times the GPU work in between the construction and destruction of the scope, see GPUProfiler.
+// The name has to be a string literal, only the pointer gets stored
+#define GPU_PROFILE_SCOPE(name) GPUProfileScope GPU_PROFILE_CONCAT(_gpuProfileScope, __LINE__)(name)
+#define GPU_PROFILE_CONCAT(a, b) GPU_PROFILE_CONCAT_INNER(a, b)
+#define GPU_PROFILE_CONCAT_INNER(a, b) a##b
+
+struct GPUProfilerSettings
+{
+    bool enabled = true;
+};
+
+// Timings of a single named scope over the last frames
+struct GPUScopeStats
+{
+    std::string name;
+    // Nesting level, the frame itself is at 0
+    unsigned int depth = 0;
+    float lastMs = 0.0f;
+    float averageMs = 0.0f;
+    float minMs = 0.0f;
+    float maxMs = 0.0f;
+    // Ring of the last HISTORY_SIZE durations, historyNext is where the next one goes
+    std::vector<float> history;
+    size_t historyNext = 0;
+    unsigned long long lastSeenFrame = 0;
+};
+
+struct GPUProfilerStats
+{
+    unsigned long long profiledFrames = 0;
+    // Frames that weren't timed because the GPU was so far behind that all of the query pools were still in flight
+    unsigned long long droppedFrames = 0;
+    // How many frames ago the latest results were recorded
+    unsigned int latencyFrames = 0;
+};
+
+// Measures where the GPU time of a frame goes. Every scope writes a GL_TIMESTAMP when it starts and ends, timestamps
+// (unlike GL_TIME_ELAPSED queries) can be nested and don't get in the way of the dynamic resolution's timer.
+// Each of the last FRAME_LATENCY frames has its own pool of queries, which only gets read back once the GPU is done
+// with all of them, so profiling never makes the CPU wait. Scopes outside of BeginFrame()/EndFrame() are ignored,
+// which keeps the headless paths sharing the renderer's code unaffected
+class GPUProfiler final : public Singleton<GPUProfiler>
+{
+    friend class Singleton<GPUProfiler>;
+
+    public:
+    static constexpr unsigned int FRAME_LATENCY = 4;
+    static constexpr unsigned int HISTORY_SIZE = 240;
+    // The bottom scope covering the whole frame
+    static constexpr const char *FRAME_SCOPE = "Frame";
+
+    GPUProfilerSettings settings;
+
+    private:
+    struct ScopeRecord
+    {
+        const char *name = nullptr;
+        unsigned int depth = 0;
+        // Indices into the frame's queries
+        unsigned int beginQuery = 0;
+        unsigned int endQuery = 0;
+    };
+    struct FrameQueries
+    {
+        // Grows to the most queries a frame ever needed and is reused after that
+        std::vector<unsigned int> queries;
+        unsigned int usedQueries = 0;
+        std::vector<ScopeRecord> scopes;
+        unsigned long long frame = 0;
+        bool pending = false;
+    };
+    // A finished frame as it's kept around for the CSV export
+    struct CollectedScope
+    {
+        unsigned int scope = 0;
+        float startMs = 0.0f;
+        float durationMs = 0.0f;
+    };
+    struct CollectedFrame
+    {
+        unsigned long long frame = 0;
+        std::vector<CollectedScope> scopes;
+    };
+
+    bool _supported = false;
+    FrameQueries _frames[FRAME_LATENCY];
+    FrameQueries *_currentFrame = nullptr;
+    // Scopes opened and not closed yet in the current frame
+    std::vector<unsigned int> _openScopes;
+    unsigned long long _frame = 0;
+
+    std::vector<GPUScopeStats> _scopeStats;
+    std::unordered_map<std::string, unsigned int> _scopeIndices;
+    std::deque<CollectedFrame> _collectedFrames;
+    GPUProfilerStats _stats;
+
+    private:
+    GPUProfiler() = default;
+    ~GPUProfiler() = default;
+
+    public:
+    void Init();
+    void DeInit();
+
+    // Reads back the frames the GPU finished and opens the frame scope. Call at the very start of the frame
+    void BeginFrame();
+    void EndFrame();
+
+    void BeginScope(const char *name);
+    void EndScope();
+
+    // Writes every frame still in the history as one row per scope. Returns false if the file couldn't be written
+    bool ExportCSV(const std::string &path) const;
+
+    inline bool isSupported() const { return _supported; }
+    // In the order the scopes were first seen, which for nested scopes is the order they're opened in
+    inline const std::vector<GPUScopeStats> &getScopeStats() const { return _scopeStats; }
+    inline const GPUProfilerStats &getStats() const { return _stats; }
+
+    private:
+    unsigned int WriteTimestamp();
+    // Returns false if the GPU isn't done with the frame's queries yet
+    bool CollectFrame(FrameQueries &frame);
+    void AddSample(GPUScopeStats &scope, float durationMs);
+};
+
+// Opens a GPU profiler scope for its lifetime, use GPU_PROFILE_SCOPE
+class GPUProfileScope
+{
+    public:
+    explicit GPUProfileScope(const char *name) { GPUProfiler::getInstance().BeginScope(name); }
+    ~GPUProfileScope() { GPUProfiler::getInstance().EndScope(); }
+    GPUProfileScope(const GPUProfileScope &other) = delete;
+    GPUProfileScope &operator=(const GPUProfileScope &other) = delete;
+};
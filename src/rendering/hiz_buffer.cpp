@@ -0,0 +1,250 @@
+#include "hiz_buffer.hpp"
+
+#include "core/log.hpp"
+#include "gl_state_cache.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+HiZBuffer::HiZBuffer()
+{
+    _levelCount = (unsigned int)std::log2((float)std::max(BASE_WIDTH, BASE_HEIGHT)) + 1;
+
+    // Immutable storage for the whole pyramid. Texel fetches ignore filtering, but the texture must be complete,
+    // which with nearest filtering only requires the base level
+    GL_CALL(glad_glGenTextures(1, &_depthTexture));
+    GLStateCache::getInstance().BindTextureToUnit(0, GL_TEXTURE_2D, _depthTexture);
+    GL_CALL(glad_glTexStorage2D(GL_TEXTURE_2D, _levelCount, GL_DEPTH_COMPONENT32F, BASE_WIDTH, BASE_HEIGHT));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    GLStateCache::getInstance().BindTextureToUnit(0, GL_TEXTURE_2D, 0);
+
+    // Depth only, nothing gets written to any color buffer
+    GL_CALL(glad_glGenFramebuffers(1, &_framebuffer));
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer));
+    GL_CALL(glad_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depthTexture, 0));
+    GL_CALL(glad_glDrawBuffer(GL_NONE));
+    GL_CALL(glad_glReadBuffer(GL_NONE));
+    unsigned int status = 0;
+    GL_CALL(status = glad_glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+        Log::LogError("Hi-Z framebuffer is incomplete, status: " + std::to_string(status));
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, 0));
+
+    GL_CALL(glad_glGenVertexArrays(1, &_emptyVAO));
+
+    size_t readbackSize = sizeof(float) * (BASE_WIDTH >> READBACK_LEVEL) * (BASE_HEIGHT >> READBACK_LEVEL);
+    for(Readback &readback: _readbacks)
+    {
+        GL_CALL(glad_glGenBuffers(1, &readback.pixelBuffer));
+        GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer));
+        GL_CALL(glad_glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize, nullptr, GL_STREAM_READ));
+    }
+    GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+}
+HiZBuffer::~HiZBuffer()
+{
+    for(Readback &readback: _readbacks)
+    {
+        if(readback.fence != nullptr)
+        {
+            GL_CALL(glad_glDeleteSync(readback.fence));
+        }
+        GL_CALL(glad_glDeleteBuffers(1, &readback.pixelBuffer));
+    }
+
+    GLStateCache::getInstance().ForgetVertexArray(_emptyVAO);
+    GL_CALL(glad_glDeleteVertexArrays(1, &_emptyVAO));
+    GL_CALL(glad_glDeleteFramebuffers(1, &_framebuffer));
+    GLStateCache::getInstance().ForgetTexture(_depthTexture);
+    GL_CALL(glad_glDeleteTextures(1, &_depthTexture));
+}
+
+void HiZBuffer::Update()
+{
+    _frame++;
+    _stats.skippedReadbacks = 0;
+
+    // Pick up every readback the GPU has finished without waiting on any of them, only the newest one is kept
+    const size_t readbackSize = sizeof(float) * (BASE_WIDTH >> READBACK_LEVEL) * (BASE_HEIGHT >> READBACK_LEVEL);
+    for(Readback &readback: _readbacks)
+    {
+        if(readback.fence == nullptr)
+            continue;
+
+        GLenum result = 0;
+        GL_CALL(result = glad_glClientWaitSync(readback.fence, 0, 0));
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            continue;
+
+        GL_CALL(glad_glDeleteSync(readback.fence));
+        readback.fence = nullptr;
+        if(_hasCPUData && readback.frame <= _cpuFrame)
+            continue;
+
+        GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer));
+        const void *depth = nullptr;
+        GL_CALL(depth = glad_glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readbackSize, GL_MAP_READ_BIT));
+        if(depth != nullptr)
+        {
+            if(_cpuLevels.empty())
+                _cpuLevels.emplace_back();
+            _cpuLevels[0].resize(readbackSize / sizeof(float));
+            memcpy(_cpuLevels[0].data(), depth, readbackSize);
+
+            _cpuViewProjection = readback.viewProjection;
+            _cpuFrame = readback.frame;
+            _hasCPUData = true;
+            BuildCPULevels();
+        }
+        GL_CALL(glad_glUnmapBuffer(GL_PIXEL_PACK_BUFFER));
+        GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+    }
+
+    _stats.latencyFrames = _hasCPUData ? (unsigned int)(_frame - _cpuFrame) : 0;
+}
+
+#pragma region Building the pyramid
+void HiZBuffer::BeginOccluderPass(const glm::mat4 &viewProjection)
+{
+    _occluderViewProjection = viewProjection;
+
+    // The frame may be drawn into an offscreen framebuffer rather than the window's
+    GL_CALL(glad_glGetIntegerv(GL_FRAMEBUFFER_BINDING, &_previousFramebuffer));
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer));
+    GL_CALL(glad_glViewport(0, 0, BASE_WIDTH, BASE_HEIGHT));
+    GL_CALL(glad_glClear(GL_DEPTH_BUFFER_BIT));
+
+    // Wireframe occluders would let everything behind them through
+    GLStateCache::getInstance().SetCapability(GL_DEPTH_TEST, true);
+    GLStateCache::getInstance().SetPolygonMode(GL_FILL);
+}
+void HiZBuffer::EndOccluderPass(const Shader &downsampleShader, const glm::uvec2 &viewportSize)
+{
+    GLStateCache &stateCache = GLStateCache::getInstance();
+
+    // Every level is drawn as a fullscreen triangle which writes the furthest depth of the 4 texels above it.
+    // The depth test must pass for every fragment, otherwise the closer depth that's already there would stay
+    downsampleShader.Bind();
+    stateCache.BindVertexArray(_emptyVAO);
+    stateCache.BindTextureToUnit(0, GL_TEXTURE_2D, _depthTexture);
+    GL_CALL(glad_glDepthFunc(GL_ALWAYS));
+    for(unsigned int level = 1; level < _levelCount; level++)
+    {
+        // Limiting the texture to the level above keeps it from being read and written at the same time
+        GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1));
+        GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1));
+        GL_CALL(glad_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depthTexture, level));
+
+        GL_CALL(glad_glViewport(0, 0, std::max(1u, BASE_WIDTH >> level), std::max(1u, BASE_HEIGHT >> level)));
+        GL_CALL(glad_glDrawArrays(GL_TRIANGLES, 0, 3));
+    }
+    GL_CALL(glad_glDepthFunc(GL_LESS));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, _levelCount - 1));
+    GL_CALL(glad_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, _depthTexture, 0));
+
+    // Copy the small level into a pixel buffer, the copy happens on the GPU's timeline and the fence tells when it's done.
+    // If all of the slots are still in flight the GPU is far behind and this frame's pyramid isn't read back at all
+    Readback &readback = _readbacks[_nextReadback];
+    if(readback.fence == nullptr)
+    {
+        GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pixelBuffer));
+        GL_CALL(glad_glGetTexImage(GL_TEXTURE_2D, READBACK_LEVEL, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)0));
+        GL_CALL(glad_glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+        GL_CALL(readback.fence = glad_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        readback.viewProjection = _occluderViewProjection;
+        readback.frame = _frame;
+        _nextReadback = (_nextReadback + 1) % READBACK_SLOTS;
+    }
+    else
+    {
+        _stats.skippedReadbacks++;
+    }
+
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, (unsigned int)_previousFramebuffer));
+    GL_CALL(glad_glViewport(0, 0, viewportSize.x, viewportSize.y));
+}
+void HiZBuffer::BuildCPULevels()
+{
+    _cpuLevels.resize(1);
+    _cpuLevelSizes.clear();
+    _cpuLevelSizes.push_back(glm::uvec2(BASE_WIDTH >> READBACK_LEVEL, BASE_HEIGHT >> READBACK_LEVEL));
+
+    while(_cpuLevelSizes.back().x > 1 || _cpuLevelSizes.back().y > 1)
+    {
+        const glm::uvec2 sourceSize = _cpuLevelSizes.back();
+        const glm::uvec2 size = glm::uvec2(std::max(1u, sourceSize.x / 2), std::max(1u, sourceSize.y / 2));
+        const std::vector<float> &source = _cpuLevels.back();
+        std::vector<float> level(size.x * size.y);
+
+        for(unsigned int y = 0; y < size.y; y++)
+        {
+            for(unsigned int x = 0; x < size.x; x++)
+            {
+                // Once one of the sides is down to a single texel it stops halving
+                unsigned int x0 = std::min(x * 2, sourceSize.x - 1), x1 = std::min(x * 2 + 1, sourceSize.x - 1);
+                unsigned int y0 = std::min(y * 2, sourceSize.y - 1), y1 = std::min(y * 2 + 1, sourceSize.y - 1);
+                level[y * size.x + x] = std::max(std::max(source[y0 * sourceSize.x + x0], source[y0 * sourceSize.x + x1]),
+                                                 std::max(source[y1 * sourceSize.x + x0], source[y1 * sourceSize.x + x1]));
+            }
+        }
+
+        _cpuLevels.push_back(std::move(level));
+        _cpuLevelSizes.push_back(size);
+    }
+}
+#pragma endregion
+
+bool HiZBuffer::IsOccluded(const AABB &box) const
+{
+    if(!_hasCPUData)
+        return false;
+
+    // Screen space rectangle and closest depth of the box
+    glm::vec2 ndcMin = glm::vec2(INFINITY), ndcMax = glm::vec2(-INFINITY);
+    float closestDepth = INFINITY;
+    for(int corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 position = glm::vec4((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z, 1.0f);
+        glm::vec4 clip = _cpuViewProjection * position;
+        // Boxes reaching behind the camera can't be projected, they're treated as visible
+        if(clip.w <= 0.0f)
+            return false;
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, glm::vec2(ndc.x, ndc.y));
+        ndcMax = glm::max(ndcMax, glm::vec2(ndc.x, ndc.y));
+        closestDepth = std::min(closestDepth, ndc.z * 0.5f + 0.5f);
+    }
+    if(ndcMax.x < -1.0f || ndcMax.y < -1.0f || ndcMin.x > 1.0f || ndcMin.y > 1.0f)
+        return false;
+
+    // Texels covered by the rectangle on the read back level
+    const glm::uvec2 &baseSize = _cpuLevelSizes[0];
+    auto toTexel = [](float ndc, unsigned int size) { return (unsigned int)std::clamp((ndc * 0.5f + 0.5f) * (float)size, 0.0f, (float)size - 1.0f); };
+    unsigned int minX = toTexel(ndcMin.x, baseSize.x), maxX = toTexel(ndcMax.x, baseSize.x);
+    unsigned int minY = toTexel(ndcMin.y, baseSize.y), maxY = toTexel(ndcMax.y, baseSize.y);
+
+    // Go down the pyramid until the rectangle covers at most 2x2 texels, so every test reads 4 values at most
+    unsigned int level = 0;
+    while(level + 1 < _cpuLevels.size() && ((maxX >> level) - (minX >> level) > 1 || (maxY >> level) - (minY >> level) > 1))
+        level++;
+
+    const glm::uvec2 &size = _cpuLevelSizes[level];
+    const std::vector<float> &depth = _cpuLevels[level];
+    float furthestDepth = 0.0f;
+    for(unsigned int y = std::min(minY >> level, size.y - 1); y <= std::min(maxY >> level, size.y - 1); y++)
+    {
+        for(unsigned int x = std::min(minX >> level, size.x - 1); x <= std::min(maxX >> level, size.x - 1); x++)
+            furthestDepth = std::max(furthestDepth, depth[y * size.x + x]);
+    }
+
+    // Hidden if the closest point of the box is behind everything that was drawn over its rectangle
+    return closestDepth > furthestDepth;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "shader.hpp"
+#include "bvh.hpp"
+
+#include <array>
+#include <vector>
+
+// Counters of the last frame
+struct HiZStats
+{
+    // Readbacks that were skipped because the GPU was still busy with all of the earlier ones
+    unsigned int skippedReadbacks = 0;
+    // How many frames old the depth the occlusion tests run against is
+    unsigned int latencyFrames = 0;
+};
+
+// Hierarchical depth buffer used for occlusion culling.
+// The objects drawn during a frame get rendered into a small depth buffer, which is then reduced into a mip pyramid
+// where every texel holds the furthest depth of the 4 texels below it. One of the small levels is read back
+// asynchronously and the following frames test the bounds of the objects against it on the CPU.
+// Because of that the results lag a few frames behind, objects that come out from behind others can show up a couple of frames late
+class HiZBuffer
+{
+    public:
+    // Power of two so that every level is exactly half of the one above it
+    static constexpr unsigned int BASE_WIDTH = 512;
+    static constexpr unsigned int BASE_HEIGHT = 256;
+    // Level read back to the CPU (64x32), the CPU builds the levels below it
+    static constexpr unsigned int READBACK_LEVEL = 3;
+    // Amount of readbacks that can be in flight at once
+    static constexpr unsigned int READBACK_SLOTS = 3;
+
+    private:
+    unsigned int _framebuffer = 0;
+    unsigned int _depthTexture = 0;
+    unsigned int _levelCount = 0;
+    // Core profile can't draw without a VAO, even when the vertex shader doesn't read any attributes
+    unsigned int _emptyVAO = 0;
+    // Framebuffer that was bound before the occluder pass, rebound at its end
+    int _previousFramebuffer = 0;
+
+    struct Readback
+    {
+        unsigned int pixelBuffer = 0;
+        GLsync fence = nullptr;
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        unsigned long long frame = 0;
+    };
+    std::array<Readback, READBACK_SLOTS> _readbacks;
+    unsigned int _nextReadback = 0;
+    unsigned long long _frame = 0;
+    glm::mat4 _occluderViewProjection = glm::mat4(1.0f);
+
+    // CPU copy of the read back level followed by the levels reduced from it, down to 1x1
+    std::vector<std::vector<float>> _cpuLevels;
+    std::vector<glm::uvec2> _cpuLevelSizes;
+    glm::mat4 _cpuViewProjection = glm::mat4(1.0f);
+    unsigned long long _cpuFrame = 0;
+    bool _hasCPUData = false;
+
+    HiZStats _stats;
+
+    public:
+    HiZBuffer();
+    ~HiZBuffer();
+    HiZBuffer(const HiZBuffer &other) = delete;
+    HiZBuffer &operator=(const HiZBuffer &other) = delete;
+
+    public:
+    // Copies the newest finished readback into the CPU pyramid, call once at the start of every frame
+    void Update();
+
+    // Binds and clears the depth buffer, the occluders are drawn in between Begin and End.
+    // The view projection is the matrix the occluders are drawn with
+    void BeginOccluderPass(const glm::mat4 &viewProjection);
+    // Builds the pyramid with the downsample shader, starts reading it back and rebinds the framebuffer that was bound before
+    void EndOccluderPass(const Shader &downsampleShader, const glm::uvec2 &viewportSize);
+
+    // Whether the box (in the space the view projection of the read back depth transforms from) is hidden behind the depth.
+    // Always false until the first readback finishes
+    bool IsOccluded(const AABB &box) const;
+
+    inline bool hasData() const { return _hasCPUData; }
+    inline const HiZStats &getStats() const { return _stats; }
+
+    private:
+    void BuildCPULevels();
+};
@@ -1,73 +1,58 @@
 #include "model.hpp"
 
-#include <glad/glad.h>
-
 #include "core/log.hpp"
+#include "gl_state_cache.hpp"
 
-Model::Model()
-    : _VAO(0), _VBO(0), _EBO(0){}
-Model::Model(const std::vector<Vertex> &vertices)
-    : _vertices(vertices)
-{
-    GL_CALL(glad_glGenVertexArrays(1, &_VAO));
-    GL_CALL(glad_glGenBuffers(1, &_VBO));
-    GL_CALL(glad_glGenBuffers(1, &_EBO));
-
-    GL_CALL(glad_glBindVertexArray(_VAO));
-
-    GL_CALL(glad_glBindBuffer(GL_ARRAY_BUFFER, _VBO));
-    // The size of the data must be written out like this because just doing _vertices.size()
-    // returns the amount of elements rather than the size of the data itself 
-    GL_CALL(glad_glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * _vertices.size(), (void*)_vertices.data(), GL_STATIC_DRAW));
+#include <glm/glm.hpp>
 
-    // GL_CALL(glad_glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO));
-    // GL_CALL(glad_glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW));
+#include <cmath>
 
-    /*
-                        Vertex format:
-            Position     Tex coords       Normal
-        vx   vy   vz   \   u   v   \   nx   ny   nz
-    */
-    // Vertex position
-    GL_CALL(glad_glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(glm::vec3), (void*)0));
-    GL_CALL(glad_glEnableVertexAttribArray(0));
-    // UV coords
-    GL_CALL(glad_glVertexAttribPointer(1, 2, GL_FLOAT, false, sizeof(glm::vec2) + sizeof(glm::vec3) + sizeof(glm::vec3), (void*)(sizeof(glm::vec3))));
-    GL_CALL(glad_glEnableVertexAttribArray(1));
-    // Normals
-    GL_CALL(glad_glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2), (void*)(sizeof(glm::vec3) + sizeof(glm::vec2))));
-    GL_CALL(glad_glEnableVertexAttribArray(2));
+Model::Model()
+    : _boundsMin(0.0f), _boundsMax(0.0f), _uvDensity(0.0f){}
+Model::Model(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices)
+    : _vertices(vertices), _indices(indices)
+{
+    // Without indices every 3 vertices make up a triangle, index them in order
+    if(_indices.empty())
+    {
+        _indices.resize(_vertices.size());
+        for(size_t i = 0; i < _indices.size(); i++)
+            _indices[i] = (unsigned int)i;
+    }
 
+    CalculateBoundsAndUVDensity();
 
-    GL_CALL(glad_glBindVertexArray(0));
-    GL_CALL(glad_glBindBuffer(GL_ARRAY_BUFFER, 0));
+    // The indices stay relative to the model's own vertices, the draw calls offset them by the allocation's base vertex
+    _geometry = GeometryArena::getInstance().Allocate(_vertices, _indices);
 }
 Model::~Model()
 {
-    GL_CALL(glad_glBindVertexArray(0));
-
-    GL_CALL(glad_glDeleteBuffers(1, &_EBO));
-    GL_CALL(glad_glDeleteBuffers(1, &_VBO));
-    GL_CALL(glad_glDeleteVertexArrays(1, &_VAO));
+    GeometryArena::getInstance().Free(_geometry);
 }
 Model::Model(const Model &other)
 {
     if(&other != this)
     {
-        this->_VAO = other._VAO;
-        this->_VBO = other._VBO;
-        this->_EBO = other._EBO;
+        // Copies get their own range of the arena, so that freeing one of them doesn't pull the geometry out from under the other
         this->_vertices = other._vertices;
+        this->_indices = other._indices;
+        this->_geometry = GeometryArena::getInstance().Allocate(_vertices, _indices);
+        this->_boundsMin = other._boundsMin;
+        this->_boundsMax = other._boundsMax;
+        this->_uvDensity = other._uvDensity;
     }
 }
 Model &Model::operator=(const Model &other)
 {
     if(&other != this)
     {
-        this->_VAO = other._VAO;
-        this->_VBO = other._VBO;
-        this->_EBO = other._EBO;
+        GeometryArena::getInstance().Free(_geometry);
         this->_vertices = other._vertices;
+        this->_indices = other._indices;
+        this->_geometry = GeometryArena::getInstance().Allocate(_vertices, _indices);
+        this->_boundsMin = other._boundsMin;
+        this->_boundsMax = other._boundsMax;
+        this->_uvDensity = other._uvDensity;
     }
     return *this;
 }
@@ -75,30 +60,74 @@ Model::Model(Model &&other)
 {
     if(&other != this)
     {
-        this->_VAO = std::move(other._VAO);
-        this->_VBO = std::move(other._VBO);
-        this->_EBO = std::move(other._EBO);
+        this->_geometry = other._geometry;
+        other._geometry = GeometryAllocation();
         this->_vertices = std::move(other._vertices);
+        this->_indices = std::move(other._indices);
+        this->_boundsMin = other._boundsMin;
+        this->_boundsMax = other._boundsMax;
+        this->_uvDensity = other._uvDensity;
     }
 }
 Model &Model::operator=(Model &&other)
 {
     if(&other != this)
     {
-        this->_VAO = std::move(other._VAO);
-        this->_VBO = std::move(other._VBO);
-        this->_EBO = std::move(other._EBO);
+        GeometryArena::getInstance().Free(_geometry);
+        this->_geometry = other._geometry;
+        other._geometry = GeometryAllocation();
         this->_vertices = std::move(other._vertices);
+        this->_indices = std::move(other._indices);
+        this->_boundsMin = other._boundsMin;
+        this->_boundsMax = other._boundsMax;
+        this->_uvDensity = other._uvDensity;
     }
     return *this;
 }
 
 
+void Model::CalculateBoundsAndUVDensity()
+{
+    _boundsMin = glm::vec3(0.0f);
+    _boundsMax = glm::vec3(0.0f);
+    _uvDensity = 0.0f;
+    if(_vertices.empty())
+        return;
+
+    _boundsMin = _vertices[0].position;
+    _boundsMax = _vertices[0].position;
+    for(const Vertex &vertex: _vertices)
+    {
+        _boundsMin = glm::min(_boundsMin, vertex.position);
+        _boundsMax = glm::max(_boundsMax, vertex.position);
+    }
+
+    // Compare the area the triangles cover in UV space to the area they cover in model space.
+    // Every 3 indices make up a triangle
+    float uvArea = 0.0f, surfaceArea = 0.0f;
+    for(size_t i = 0; i + 2 < _indices.size(); i += 3)
+    {
+        const Vertex &a = _vertices[_indices[i]], &b = _vertices[_indices[i + 1]], &c = _vertices[_indices[i + 2]];
+        surfaceArea += 0.5f * glm::length(glm::cross(b.position - a.position, c.position - a.position));
+
+        glm::vec2 uvEdge1 = b.uv - a.uv, uvEdge2 = c.uv - a.uv;
+        uvArea += 0.5f * std::abs(uvEdge1.x * uvEdge2.y - uvEdge1.y * uvEdge2.x);
+    }
+    if(surfaceArea > 0.0f)
+        _uvDensity = std::sqrt(uvArea / surfaceArea);
+}
+
 void Model::Bind() const
 {
-    GL_CALL(glad_glBindVertexArray(_VAO));
+    GLStateCache::getInstance().BindVertexArray(getVAO());
 }
 void Model::Unbind() const
 {
-    GL_CALL(glad_glBindVertexArray(0));
+    GLStateCache::getInstance().BindVertexArray(0);
+}
+
+void Model::AttachInstanceBuffer(unsigned int buffer) const
+{
+    if(_geometry.isValid())
+        GeometryArena::getInstance().AttachInstanceBuffer(_geometry.pool, buffer);
 }
\ No newline at end of file
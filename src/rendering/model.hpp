@@ -3,6 +3,8 @@
 #include <glm/vec2.hpp> 
 #include <glm/vec3.hpp> 
 
+#include "geometry_arena.hpp"
+
 #include <vector>
 #include <array>
 
@@ -71,12 +73,21 @@ struct Vertex final
 class Model
 {
    protected:
-   unsigned int _VAO, _VBO, _EBO;
+   // The vertices and indices live in one of the GeometryArena's pools, which every model in it shares the VAO of
+   GeometryAllocation _geometry;
    std::vector<Vertex> _vertices;
+   std::vector<unsigned int> _indices;
+
+   // Axis aligned bounding box in model space
+   glm::vec3 _boundsMin, _boundsMax;
+   // How many UV units a single model space unit covers on average,
+   // used to estimate how detailed the textures on the model need to be
+   float _uvDensity;
 
    public:
    Model();
-   Model(const std::vector<Vertex> &vertices);
+   // Leaving out the indices draws the vertices as a plain triangle list
+   Model(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices = {});
    ~Model();
    Model(const Model &other);
    Model &operator=(const Model &other);
@@ -84,11 +95,25 @@ class Model
    Model &operator=(Model &&other);
 
    public:
-   inline const unsigned int &getVAO() const { return _VAO; }
-   inline const unsigned int &getVBO() const { return _VBO; }
-   inline const unsigned int &getEBO() const { return _EBO; }
+   inline unsigned int getVAO() const { return _geometry.isValid() ? GeometryArena::getInstance().getVAO(_geometry.pool) : 0; }
+   inline unsigned int getVBO() const { return _geometry.isValid() ? GeometryArena::getInstance().getVBO(_geometry.pool) : 0; }
+   inline unsigned int getEBO() const { return _geometry.isValid() ? GeometryArena::getInstance().getEBO(_geometry.pool) : 0; }
+   inline const GeometryAllocation &getGeometry() const { return _geometry; }
    inline const std::vector<Vertex> &getVertices() const { return _vertices; }
+   inline const std::vector<unsigned int> &getIndices() const { return _indices; }
+   inline unsigned int getIndexCount() const { return (unsigned int)_indices.size(); }
+   inline const glm::vec3 &getBoundsMin() const { return _boundsMin; }
+   inline const glm::vec3 &getBoundsMax() const { return _boundsMax; }
+   inline glm::vec3 getBoundsCenter() const { return (_boundsMin + _boundsMax) * 0.5f; }
+   inline float getUVDensity() const { return _uvDensity; }
 
    void Bind() const;
    void Unbind() const;
+
+   // Points the per-instance model matrix attribute (locations 3 to 6) of the VAO at the given buffer.
+   // The buffer holds one tightly packed mat4 per instance. Affects every model sharing the VAO
+   void AttachInstanceBuffer(unsigned int buffer) const;
+
+   private:
+   void CalculateBoundsAndUVDensity();
 };
\ No newline at end of file
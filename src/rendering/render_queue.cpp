@@ -0,0 +1,60 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <array>
+
+uint64_t RenderQueue::MakeSortKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t vertexArray, float depth)
+{
+    // Depth is expected in the [0, 1] range, closer packets sort first so that solid geometry is drawn front to back
+    uint64_t quantizedDepth = (uint64_t)(std::clamp(depth, 0.0f, 1.0f) * 0xFFFF);
+
+    return ((uint64_t)pass & 0xF) << 60
+         | ((uint64_t)shader & 0xFFFF) << 44
+         | ((uint64_t)material & 0xFFFF) << 28
+         | ((uint64_t)vertexArray & 0xFFF) << 16
+         | quantizedDepth;
+}
+
+void RenderQueue::Sort()
+{
+    // Small queues are quicker to sort in place than to run 8 counting passes over
+    if(_packets.size() < 64)
+    {
+        std::stable_sort(_packets.begin(), _packets.end(), [](const DrawPacket &a, const DrawPacket &b) { return a.sortKey < b.sortKey; });
+        return;
+    }
+
+    _sortScratch.resize(_packets.size());
+    std::vector<DrawPacket> *source = &_packets, *destination = &_sortScratch;
+
+    for(int byte = 0; byte < 8; byte++)
+    {
+        const int shift = byte * 8;
+
+        std::array<size_t, 256> counts = {};
+        for(const DrawPacket &packet: *source)
+            counts[(packet.sortKey >> shift) & 0xFF]++;
+
+        // Every key has the same value in this byte, so the pass wouldn't move anything
+        if(counts[((*source)[0].sortKey >> shift) & 0xFF] == source->size())
+            continue;
+
+        // Turn the counts into the index each bucket starts at
+        size_t offset = 0;
+        for(size_t &count: counts)
+        {
+            size_t bucketSize = count;
+            count = offset;
+            offset += bucketSize;
+        }
+
+        for(const DrawPacket &packet: *source)
+            (*destination)[counts[(packet.sortKey >> shift) & 0xFF]++] = packet;
+
+        std::swap(source, destination);
+    }
+
+    // An odd amount of passes leaves the sorted packets in the scratch buffer
+    if(source != &_packets)
+        _packets.swap(_sortScratch);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "shader.hpp"
+#include "model.hpp"
+
+#include <vector>
+#include <cstdint>
+
+// Passes are drawn in the order of their values
+enum class RenderPass : uint8_t
+{
+    SOLID = 0
+};
+
+// Everything needed to issue a single (instanced) draw call
+struct DrawPacket
+{
+    uint64_t sortKey = 0;
+    Model *model = nullptr;
+    Shader *shader = nullptr;
+    // Full material ID, the sort key only holds the lower bits of it
+    uint32_t material = 0;
+    unsigned int firstInstance = 0;
+    unsigned int instanceCount = 0;
+    // View space distance of the nearest instance's center, the streamed textures are sharp enough for it
+    float nearestDistance = 0.0f;
+};
+
+// Collects the draw packets of a frame and orders them by their sort keys, so that packets sharing
+// a shader, material and VAO end up next to each other and the state in between them doesn't need to change.
+//
+//                                  Sort key layout:
+//  63    60 59                44 43               28 27           16 15              0
+//  | pass  |      shader       |     material      |      VAO      |      depth      |
+//
+// Every field is truncated to its amount of bits, which only costs a few extra state changes if two IDs collide
+class RenderQueue
+{
+    private:
+    std::vector<DrawPacket> _packets;
+    // Reused between frames so that sorting doesn't allocate
+    std::vector<DrawPacket> _sortScratch;
+
+    public:
+    static uint64_t MakeSortKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t vertexArray, float depth);
+
+    inline void Clear() { _packets.clear(); }
+    inline void Submit(const DrawPacket &packet) { _packets.push_back(packet); }
+    // LSD radix sort over the bytes of the sort keys, bytes which are the same in every key are skipped
+    void Sort();
+
+    inline const std::vector<DrawPacket> &getPackets() const { return _packets; }
+};
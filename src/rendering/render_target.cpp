@@ -0,0 +1,102 @@
+#include "render_target.hpp"
+
+#include "core/log.hpp"
+#include "gl_state_cache.hpp"
+
+#include <cstring>
+
+RenderTarget::RenderTarget(const glm::uvec2 &size)
+    : _size(size)
+{
+    Create();
+}
+RenderTarget::~RenderTarget()
+{
+    Destroy();
+}
+
+void RenderTarget::Resize(const glm::uvec2 &size)
+{
+    if(size == _size)
+        return;
+
+    _size = size;
+    Destroy();
+    Create();
+}
+
+void RenderTarget::Bind() const
+{
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer));
+    GL_CALL(glad_glViewport(0, 0, _size.x, _size.y));
+}
+void RenderTarget::Unbind() const
+{
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+
+std::vector<unsigned char> RenderTarget::ReadPixels() const
+{
+    std::vector<unsigned char> pixels((size_t)_size.x * _size.y * 4);
+    size_t rowSize = (size_t)_size.x * 4;
+
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, _framebuffer));
+    GL_CALL(glad_glReadBuffer(GL_COLOR_ATTACHMENT0));
+    GL_CALL(glad_glPixelStorei(GL_PACK_ALIGNMENT, 1));
+    GL_CALL(glad_glReadPixels(0, 0, _size.x, _size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+
+    // GL's first row is the bottom one
+    std::vector<unsigned char> row(rowSize);
+    for(size_t y = 0; y < _size.y / 2; y++)
+    {
+        unsigned char *top = pixels.data() + y * rowSize;
+        unsigned char *bottom = pixels.data() + (_size.y - 1 - y) * rowSize;
+        memcpy(row.data(), top, rowSize);
+        memcpy(top, bottom, rowSize);
+        memcpy(bottom, row.data(), rowSize);
+    }
+    return pixels;
+}
+
+void RenderTarget::Create()
+{
+    GLStateCache &stateCache = GLStateCache::getInstance();
+
+    GL_CALL(glad_glGenTextures(1, &_colorTexture));
+    stateCache.BindTextureToUnit(0, GL_TEXTURE_2D, _colorTexture);
+    GL_CALL(glad_glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, _size.x, _size.y));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+
+    // The depth is never sampled, so a renderbuffer is enough
+    GL_CALL(glad_glGenRenderbuffers(1, &_depthBuffer));
+    GL_CALL(glad_glBindRenderbuffer(GL_RENDERBUFFER, _depthBuffer));
+    GL_CALL(glad_glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, _size.x, _size.y));
+    GL_CALL(glad_glBindRenderbuffer(GL_RENDERBUFFER, 0));
+
+    GL_CALL(glad_glGenFramebuffers(1, &_framebuffer));
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer));
+    GL_CALL(glad_glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _colorTexture, 0));
+    GL_CALL(glad_glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depthBuffer));
+
+    GLenum status;
+    GL_CALL(status = glad_glCheckFramebufferStatus(GL_FRAMEBUFFER));
+    if(status != GL_FRAMEBUFFER_COMPLETE)
+        Log::LogError("Render target framebuffer is incomplete (status " + std::to_string(status) + ")");
+
+    GL_CALL(glad_glBindFramebuffer(GL_FRAMEBUFFER, 0));
+}
+void RenderTarget::Destroy()
+{
+    GL_CALL(glad_glDeleteFramebuffers(1, &_framebuffer));
+    GL_CALL(glad_glDeleteRenderbuffers(1, &_depthBuffer));
+    GLStateCache::getInstance().ForgetTexture(_colorTexture);
+    GL_CALL(glad_glDeleteTextures(1, &_colorTexture));
+
+    _framebuffer = 0;
+    _depthBuffer = 0;
+    _colorTexture = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/vec2.hpp>
+
+#include <vector>
+
+// Offscreen framebuffer with an RGBA8 color texture and a depth buffer
+class RenderTarget
+{
+    private:
+    unsigned int _framebuffer = 0;
+    unsigned int _colorTexture = 0;
+    unsigned int _depthBuffer = 0;
+    glm::uvec2 _size = glm::uvec2(0);
+
+    public:
+    explicit RenderTarget(const glm::uvec2 &size);
+    ~RenderTarget();
+    RenderTarget(const RenderTarget &other) = delete;
+    RenderTarget &operator=(const RenderTarget &other) = delete;
+
+    public:
+    // Recreates the attachments, their contents are lost
+    void Resize(const glm::uvec2 &size);
+    // Binds the framebuffer and sets the viewport to cover all of it
+    void Bind() const;
+    void Unbind() const;
+
+    // Reads the color attachment back as tightly packed RGBA8 rows, top row first like image files expect.
+    // Blocks until the GPU has finished drawing into it
+    std::vector<unsigned char> ReadPixels() const;
+
+    inline unsigned int getFramebuffer() const { return _framebuffer; }
+    inline unsigned int getColorTexture() const { return _colorTexture; }
+    inline const glm::uvec2 &getSize() const { return _size; }
+
+    private:
+    void Create();
+    void Destroy();
+};
@@ -1,56 +1,62 @@
 #include "renderer.hpp"
 
 #include "core/log.hpp"
+#include "core/cpu_profiler.hpp"
 #include "core/resource_manager.hpp"
+#include "texture_streamer.hpp"
+#include "gl_state_cache.hpp"
+#include "geometry_arena.hpp"
+#include "gpu_profiler.hpp"
+#include "misc/hash.hpp"
 
-void Renderer::Init()
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+void Renderer::Init(GLADloadproc loader)
 {
-    // Init cube model
+    // Init cube model, every face has its own 4 vertices so that the normals and UVs don't get shared between faces
     std::vector<Vertex> cubeVertices;
     cubeVertices.insert(cubeVertices.end(), 
     {
         Vertex(glm::vec3(-0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
         Vertex(glm::vec3( 0.5f, -0.5f, -0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
         Vertex(glm::vec3( 0.5f,  0.5f, -0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
-        Vertex(glm::vec3( 0.5f,  0.5f, -0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
         Vertex(glm::vec3(-0.5f,  0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
-        Vertex(glm::vec3(-0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)),
 
         Vertex(glm::vec3(-0.5f, -0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
         Vertex(glm::vec3( 0.5f, -0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
         Vertex(glm::vec3( 0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
-        Vertex(glm::vec3( 0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
         Vertex(glm::vec3(-0.5f,  0.5f,  0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
-        Vertex(glm::vec3(-0.5f, -0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
 
         Vertex(glm::vec3(-0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f)),
         Vertex(glm::vec3(-0.5f,  0.5f, -0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(-1.0f, 0.0f, 0.0f)),
         Vertex(glm::vec3(-0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(-1.0f, 0.0f, 0.0f)),
-        Vertex(glm::vec3(-0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(-1.0f, 0.0f, 0.0f)),
         Vertex(glm::vec3(-0.5f, -0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f)),
-        Vertex(glm::vec3(-0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f)),
 
         Vertex(glm::vec3( 0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f,  0.5f, -0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
-        Vertex(glm::vec3( 0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f, -0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
-        Vertex(glm::vec3( 0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f)),
 
         Vertex(glm::vec3(-0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f, -0.5f, -0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f, -0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
-        Vertex(glm::vec3( 0.5f, -0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
         Vertex(glm::vec3(-0.5f, -0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
-        Vertex(glm::vec3(-0.5f, -0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)),
 
         Vertex(glm::vec3(-0.5f,  0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f,  0.5f, -0.5f),  glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
         Vertex(glm::vec3( 0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
-        Vertex(glm::vec3( 0.5f,  0.5f,  0.5f),  glm::vec2(1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
-        Vertex(glm::vec3(-0.5f,  0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
-        Vertex(glm::vec3(-0.5f,  0.5f, -0.5f),  glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f))
+        Vertex(glm::vec3(-0.5f,  0.5f,  0.5f),  glm::vec2(0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f))
     });
+    std::vector<unsigned int> cubeIndices;
+    for(unsigned int face = 0; face < 6; face++)
+    {
+        unsigned int first = face * 4;
+        cubeIndices.insert(cubeIndices.end(), { first, first + 1, first + 2, first + 2, first + 3, first });
+    }
 
     // Init quad model
     std::vector<Vertex> quadVertices;
@@ -62,8 +68,24 @@ void Renderer::Init()
         Vertex(glm::vec3(0.5f, 0.5f, 0.0f), glm::vec2(1.0f, 1.0f)), // top right
     });
 
-    _cube = new Model(std::move(cubeVertices));
-    _quad = new Model(std::move(quadVertices));
+    std::vector<unsigned int> quadIndices = { 0, 1, 2, 2, 3, 0 };
+
+    _cube = new Model(std::move(cubeVertices), std::move(cubeIndices));
+    _quad = new Model(std::move(quadVertices), std::move(quadIndices));
+
+    // Holds the uniform blocks, instance transforms and draw commands of every frame, grown to fit the scene when needed
+    _streamBuffer = new StreamBuffer(STREAM_BUFFER_FRAME_SIZE, loader);
+    GL_CALL(glad_glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &_uniformBufferAlignment));
+
+    // The context is only requested as 4.2, but drivers usually hand out the newest version they support
+    _multiDrawIndirectSupported = GLAD_GL_VERSION_4_3 && glad_glMultiDrawElementsIndirect != nullptr;
+    if(_multiDrawIndirectSupported)
+        Log::LogInfo("Multi-draw indirect available");
+    else
+        Log::LogInfo("Multi-draw indirect not available, falling back to a draw call per packet");
+
+    _hiZBuffer = new HiZBuffer();
+    _hiZDownsampleShader = ResourceManager::getInstance().LoadShaderFromFiles("res/internal/hiz_downsample.vs", "res/internal/hiz_downsample.fs");
 
     // Scene::getInstance().model = _cube;
 }
@@ -71,82 +93,540 @@ void Renderer::DeInit()
 {
     delete _cube;
     delete _quad;
+
+    delete _streamBuffer;
+    _streamBuffer = nullptr;
+
+    delete _hiZBuffer;
+    _hiZBuffer = nullptr;
+
+    delete _softwareRasterizer;
+    _softwareRasterizer = nullptr;
+    if(_softwareTexture != 0)
+    {
+        GLStateCache::getInstance().ForgetTexture(_softwareTexture);
+        GL_CALL(glad_glDeleteTextures(1, &_softwareTexture));
+        GL_CALL(glad_glDeleteFramebuffers(1, &_softwareFramebuffer));
+        _softwareTexture = _softwareFramebuffer = 0;
+    }
 }
 
 void Renderer::DrawScene()
 {
+    PROFILE_ZONE("Renderer::DrawScene");
     static const Shader &defaultShader = *(ResourceManager::getInstance().GetShader("default"));
-    static const Texture &missingTex = *(ResourceManager::getInstance().GetTexture("tex_missing"));
     
     static Scene &scene = Scene::getInstance();
+    static TextureStreamer &textureStreamer = TextureStreamer::getInstance();
+    static GLStateCache &stateCache = GLStateCache::getInstance();
+
+    // The UI draws in between frames and changes the state behind the cache's back
+    stateCache.Invalidate();
+    stateCache.ResetStats();
+
+    // Upload/free the mip levels requested during the last frame before anything gets bound
+    {
+        GPU_PROFILE_SCOPE("Texture streaming");
+        textureStreamer.Update();
+    }
+    // Pick up the occlusion data of an earlier frame if the GPU is done with it
+    _hiZBuffer->Update();
 
     // FIXME: Throws error 1282 after just unloading a texture
-    GL_CALL(glad_glEnable(GL_DEPTH_TEST));
+    stateCache.SetCapability(GL_DEPTH_TEST, true);
     
-    GL_CALL(glad_glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
-    GL_CALL(glad_glClearColor(settings.bgColor.x, settings.bgColor.y, settings.bgColor.z, 1.0f));
+    stateCache.SetClearColor(glm::vec4(settings.bgColor.x, settings.bgColor.y, settings.bgColor.z, 1.0f));
+    {
+        GPU_PROFILE_SCOPE("Clear");
+        GL_CALL(glad_glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
+    }
 
-    GL_CALL(glad_glPolygonMode(GL_FRONT_AND_BACK, (GLenum)settings.renderMode));
+    stateCache.SetPolygonMode((GLenum)settings.renderMode);
 
     if(scene.model == nullptr)
         scene.model = _cube;
-    scene.model->Bind();
-
     if(scene.shader == nullptr)
         scene.shader = const_cast<Shader*>(&defaultShader);
-    scene.shader->Bind();
 
-    auto &textureUniforms = scene.shader->getUniformsOfType(ShaderUniformType::TEX2D);
-    // If there are textures present in the scene, go through them and bind the appropriate texture to the appropriate bind target
-    // Else just bind the missing texture
-    if(!scene.textures.empty())
+    if(settings.backend == RenderBackend::SOFTWARE)
+    {
+        DrawSceneSoftware();
+        return;
+    }
+
+    // Worst case of what this frame streams: both uniform blocks, plus a transform and a draw command per object
+    size_t streamSize = sizeof(FrameUniformData) + sizeof(ObjectUniformData) + 2 * (size_t)_uniformBufferAlignment
+                      + (sizeof(glm::mat4) + sizeof(DrawElementsIndirectCommand)) * scene.objects.size() + sizeof(glm::mat4) + sizeof(DrawElementsIndirectCommand);
+    unsigned int oldStreamBuffer = _streamBuffer->getID();
+    _streamBuffer->BeginFrame(streamSize);
+    if(_streamBuffer->getID() != oldStreamBuffer)
+        GeometryArena::getInstance().ForgetInstanceBuffer(oldStreamBuffer);
+
+    // Per-frame data, written once and shared by every shader
+    FrameUniformData frameData;
+    frameData.view = _camera.view;
+    frameData.projection = _camera.projection;
+    frameData.viewProjection = _camera.projection * _camera.view;
+    frameData.viewPos = _camera.position;
+    frameData.time = _time;
+    StreamUniformBlock(UniformBufferBinding::FRAME_DATA, &frameData, sizeof(frameData));
+
+    // The scene's model matrix is shared by all of the instances, each of them applies its own transform on top in the vertex shader
+    ObjectUniformData objectData;
+    objectData.modelMatrix = scene.modelMatrix;
+    objectData.MVP = frameData.viewProjection * scene.modelMatrix;
+    StreamUniformBlock(UniformBufferBinding::OBJECT_DATA, &objectData, sizeof(objectData));
+
+    // Only the objects inside of the view frustum get drawn. The BVH is built from the object transforms alone,
+    // so the frustum is brought into that space with the scene's model matrix instead of refitting the whole tree whenever it changes
+    _visibleObjects.clear();
+    auto cullStart = std::chrono::high_resolution_clock::now();
+    if(settings.frustumCulling || settings.occlusionCulling)
+        UpdateSceneBVH(scene.model);
+
+    if(settings.frustumCulling)
+    {
+        _sceneBVH.Cull(Frustum::FromMatrix(objectData.MVP), _visibleObjects, _cullStats);
+    }
+    else
+    {
+        _visibleObjects.resize(scene.objects.size());
+        for(unsigned int i = 0; i < _visibleObjects.size(); i++)
+            _visibleObjects[i] = i;
+        _cullStats = CullStats();
+        _cullStats.visibleObjects = (unsigned int)_visibleObjects.size();
+    }
+
+    // Then drop the ones hidden behind what was drawn a few frames ago
+    _stats.occludedObjects = 0;
+    if(settings.occlusionCulling && _hiZBuffer->hasData())
     {
-        for (int i = 0; i < scene.textures.size() && i < textureUniforms.size() && i < 32; i++)
+        auto visibleEnd = std::remove_if(_visibleObjects.begin(), _visibleObjects.end(), [this](unsigned int object)
         {
-            GL_CALL(glad_glActiveTexture(GL_TEXTURE0 + i));
-            
-            const Texture* const tex = (Texture*)(textureUniforms[i])->value;
-            if(tex != nullptr && tex->getID() != 0)
-                tex->Bind();
-            else
-                missingTex.Bind();
-            // NOTE: As it stands right now, the missing texture's image unit index doesn't change from 0
-            // That's bad for shaders with multiple textures because only GL_TEXTURE0 shows up as missing texture
-            // (eg. the inside or outside of the mask should be missing tex if not specified)
-            // The missing tex must probably be set to empty uniform and have its image unit changed per shader per uniform
-            // so that it gets updated properly or something. Maybe shared_ptr the texture itself?
+            return _hiZBuffer->IsOccluded(_sceneBVH.getObjectBounds(object));
+        });
+        _stats.occludedObjects = (unsigned int)(_visibleObjects.end() - visibleEnd);
+        _visibleObjects.erase(visibleEnd, _visibleObjects.end());
+    }
+    _stats.cullTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+    _stats.visibleObjects = (unsigned int)_visibleObjects.size();
+    _stats.culledObjects = _cullStats.culledObjects;
+
+    PrepareDrawGroups(scene.model, scene.shader, _visibleObjects);
+
+    // Every draw group becomes a packet, sorted so that the state changes as little as possible from one packet to the next
+    _renderQueue.Clear();
+    for(const DrawGroup &group: _drawGroups)
+    {
+        // NDC depth of the model's center, the scene's model matrix is shared by all of the instances
+        glm::vec4 clipSpaceCenter = frameData.viewProjection * scene.modelMatrix * glm::vec4(group.model->getBoundsCenter(), 1.0f);
+        float depth = clipSpaceCenter.w > 0.0f ? (clipSpaceCenter.z / clipSpaceCenter.w) * 0.5f + 0.5f : 0.0f;
+
+        DrawPacket packet;
+        packet.model = group.model;
+        packet.shader = group.shader;
+        packet.material = GetMaterialID(*group.shader);
+        packet.sortKey = RenderQueue::MakeSortKey(RenderPass::SOLID, group.shader->getID(), packet.material, group.model->getVAO(), depth);
+        packet.firstInstance = group.firstInstance;
+        packet.instanceCount = group.instanceCount;
+        packet.nearestDistance = group.nearestDistance;
+        _renderQueue.Submit(packet);
+    }
+    _renderQueue.Sort();
+
+    _stats.drawCalls = 0;
+    _stats.instances = 0;
+    _stats.usedMultiDrawIndirect = settings.multiDrawIndirect && _multiDrawIndirectSupported;
+    PrepareIndirectCommands();
+    // Everything the draws read has been streamed by now
+    _streamBuffer->Commit();
+
+    // Packets sharing a shader, material and VAO sit next to each other after sorting and go out as a single run.
+    // Nothing gets unbound in between or after the runs, the state cache skips whatever the next run shares with the previous one
+    const std::vector<DrawPacket> &packets = _renderQueue.getPackets();
+    {
+        GPU_PROFILE_SCOPE("Opaque");
+        for(size_t first = 0; first < packets.size();)
+        {
+            size_t end = first + 1;
+            while(end < packets.size() && packets[end].shader == packets[first].shader && packets[end].material == packets[first].material
+                && packets[end].model->getVAO() == packets[first].model->getVAO())
+                end++;
+
+            packets[first].model->AttachInstanceBuffer(_streamBuffer->getID());
+            packets[first].model->Bind();
+            packets[first].shader->Bind();
+            // The textures are the same for the whole run, but every model requests the mip levels it needs on its own
+            for(size_t i = first; i < end; i++)
+            {
+                BindShaderTextures(*packets[i].shader, *packets[i].model, packets[i].nearestDistance);
+                _stats.instances += packets[i].instanceCount;
+            }
+
+            DrawPacketRun(first, end - first);
+            first = end;
         }
     }
+
+    // The objects drawn this frame are the occluders the next frames get tested against.
+    // Only their depth matters, so they all go through the default shader and the runs only split where the VAO changes
+    if(settings.occlusionCulling)
+    {
+        GPU_PROFILE_SCOPE("Occluders");
+        _hiZBuffer->BeginOccluderPass(objectData.MVP);
+        defaultShader.Bind();
+        for(size_t first = 0; first < packets.size();)
+        {
+            size_t end = first + 1;
+            while(end < packets.size() && packets[end].model->getVAO() == packets[first].model->getVAO())
+                end++;
+
+            packets[first].model->Bind();
+            DrawPacketRun(first, end - first);
+            first = end;
+        }
+        _hiZBuffer->EndOccluderPass(*_hiZDownsampleShader, _camera.viewportSize);
+    }
+
+    if(_stats.usedMultiDrawIndirect)
+    {
+        GL_CALL(glad_glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0));
+    }
+
+    _streamBuffer->EndFrame();
+
+    _stats.uniformUploads = Shader::getUniformUploadCount();
+    Shader::ResetUniformUploadCount();
+    _stats.stateChanges = stateCache.getStats().stateChanges;
+    _stats.stateChangesAvoided = stateCache.getStats().stateChangesAvoided;
+}
+
+#pragma region Software backend
+void Renderer::DrawSceneSoftware()
+{
+    PROFILE_ZONE("Renderer::DrawSceneSoftware");
+    static Scene &scene = Scene::getInstance();
+
+    if(_softwareRasterizer == nullptr)
+    {
+        _softwareRasterizer = new SoftwareRasterizer();
+        Log::LogInfo("Software rasterizer running on " + std::to_string(_softwareRasterizer->getThreadCount()) + " threads");
+    }
+    _softwareRasterizer->Resize(_camera.viewportSize);
+    _softwareRasterizer->Clear(glm::vec4(settings.bgColor.x, settings.bgColor.y, settings.bgColor.z, 1.0f));
+    _softwareRasterizer->SetCamera(_camera.view, _camera.projection, _camera.position);
+
+    // Same frustum culling as the GL path, occlusion culling needs the GPU's depth so it's skipped
+    _visibleObjects.clear();
+    auto cullStart = std::chrono::high_resolution_clock::now();
+    if(settings.frustumCulling)
+    {
+        UpdateSceneBVH(scene.model);
+        _sceneBVH.Cull(Frustum::FromMatrix(_camera.projection * _camera.view * scene.modelMatrix), _visibleObjects, _cullStats);
+    }
     else
     {
-        GL_CALL(glad_glActiveTexture(GL_TEXTURE0));
-        missingTex.Bind();
+        _visibleObjects.resize(scene.objects.size());
+        for(unsigned int i = 0; i < _visibleObjects.size(); i++)
+            _visibleObjects[i] = i;
+        _cullStats = CullStats();
     }
-    
-    int numOfVerts = scene.model->getVertices().size();
-    GL_CALL(glad_glDrawArrays(GL_TRIANGLES, 0, numOfVerts));
-    // GL_CALL(glad_glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0));
-    
-    // Unbind the textures in order if present, else just unbind the missing tex
-    if(!scene.textures.empty())
-    {    
-        for (int i = 0; i < scene.textures.size() && i < textureUniforms.size() && i < 32; i++)
+    _stats = RendererStats();
+    _stats.cullTimeMs = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - cullStart).count();
+    _stats.visibleObjects = (unsigned int)_visibleObjects.size();
+    _stats.culledObjects = _cullStats.culledObjects;
+
+    for(unsigned int objectIndex: _visibleObjects)
+    {
+        const SceneObject &object = scene.objects[objectIndex];
+        const Model &model = object.model != nullptr ? *object.model : *scene.model;
+        const Shader &shader = object.shader != nullptr ? *object.shader : *scene.shader;
+
+        // Picks up the values phong.fs would read, shaders without them are lit with the defaults of lighting.glsl
+        SoftwareMaterial material;
+        if(const ShaderUniform *color = shader.FindUniform(UNIFORM_ID("u_Color")))
+            material.color = color->getValue<glm::vec4>();
+        if(const ShaderUniform *lightPos = shader.FindUniform(UNIFORM_ID("u_LightPos")))
+            material.lightPos = lightPos->getValue<glm::vec3>();
+        if(const ShaderUniform *lightColor = shader.FindUniform(UNIFORM_ID("u_LightColor")))
+            material.lightColor = lightColor->getValue<glm::vec4>();
+
+        _softwareRasterizer->DrawMesh(model.getVertices(), model.getIndices(), scene.modelMatrix * object.transform, material);
+        _stats.instances++;
+    }
+
+    GPU_PROFILE_SCOPE("Software upload");
+    PresentSoftwareFrame();
+}
+void Renderer::PresentSoftwareFrame()
+{
+    GLStateCache &stateCache = GLStateCache::getInstance();
+    const glm::uvec2 &size = _softwareRasterizer->getSize();
+
+    if(_softwareTexture == 0 || _softwareTextureSize != size)
+    {
+        if(_softwareTexture != 0)
+        {
+            stateCache.ForgetTexture(_softwareTexture);
+            GL_CALL(glad_glDeleteTextures(1, &_softwareTexture));
+            GL_CALL(glad_glDeleteFramebuffers(1, &_softwareFramebuffer));
+        }
+
+        GL_CALL(glad_glGenTextures(1, &_softwareTexture));
+        stateCache.BindTextureToUnit(0, GL_TEXTURE_2D, _softwareTexture);
+        GL_CALL(glad_glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, size.x, size.y));
+
+        GL_CALL(glad_glGenFramebuffers(1, &_softwareFramebuffer));
+        GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, _softwareFramebuffer));
+        GL_CALL(glad_glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, _softwareTexture, 0));
+        _softwareTextureSize = size;
+    }
+
+    // The rasterizer keeps its rows bottom first, the same way GL does
+    stateCache.BindTextureToUnit(0, GL_TEXTURE_2D, _softwareTexture);
+    GL_CALL(glad_glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, _softwareRasterizer->getPixels().data()));
+
+    // Whatever the GL path would have drawn into stays bound as the draw framebuffer, be it the window or a render target
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, _softwareFramebuffer));
+    GL_CALL(glad_glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, size.x, size.y, GL_COLOR_BUFFER_BIT, GL_NEAREST));
+    GL_CALL(glad_glBindFramebuffer(GL_READ_FRAMEBUFFER, 0));
+}
+#pragma endregion
+
+void Renderer::PrepareDrawGroups(Model *defaultModel, Shader *defaultShader, const std::vector<unsigned int> &objects)
+{
+    static Scene &scene = Scene::getInstance();
+
+    _drawGroups.clear();
+    _objectGroups.resize(objects.size());
+
+    // Find the group of every object. Scenes usually only have a handful of different model/shader combinations
+    // and neighbouring objects tend to share theirs, so checking the last group before searching through all of them
+    // keeps this cheap even with 100k objects
+    unsigned int lastGroup = 0;
+    for(size_t i = 0; i < objects.size(); i++)
+    {
+        const SceneObject &object = scene.objects[objects[i]];
+        Model *model = object.model != nullptr ? object.model : defaultModel;
+        Shader *shader = object.shader != nullptr ? object.shader : defaultShader;
+
+        if(_drawGroups.empty() || _drawGroups[lastGroup].model != model || _drawGroups[lastGroup].shader != shader)
         {
-            GL_CALL(glad_glActiveTexture(GL_TEXTURE0 + i));
+            lastGroup = 0;
+            while(lastGroup < _drawGroups.size() && (_drawGroups[lastGroup].model != model || _drawGroups[lastGroup].shader != shader))
+                lastGroup++;
             
-            const Texture* const tex = (Texture*)(textureUniforms[i])->value;
-            if(tex != nullptr && tex->getID() != 0)
-                tex->Unbind();
+            if(lastGroup == _drawGroups.size())
+            {
+                DrawGroup newGroup;
+                newGroup.model = model;
+                newGroup.shader = shader;
+                newGroup.nearestDistance = std::numeric_limits<float>::max();
+                _drawGroups.push_back(newGroup);
+            }
+        }
+
+        _drawGroups[lastGroup].instanceCount++;
+        _objectGroups[i] = lastGroup;
+    }
+
+    // Every group gets a contiguous range of the instance buffer
+    unsigned int instanceCount = 0;
+    for(DrawGroup &group: _drawGroups)
+    {
+        group.firstInstance = instanceCount;
+        instanceCount += group.instanceCount;
+    }
+    if(instanceCount == 0)
+        return;
+
+    // The transforms are scattered straight into the stream buffer, in the order of their groups.
+    // Aligning to a whole mat4 turns the offset into an amount of instances, which the base instance of every draw skips over
+    StreamAllocation allocation = _streamBuffer->Allocate(sizeof(glm::mat4) * instanceCount, sizeof(glm::mat4));
+    if(allocation.data == nullptr)
+    {
+        _drawGroups.clear();
+        return;
+    }
+
+    glm::mat4 *instances = (glm::mat4*)allocation.data;
+    std::vector<unsigned int> groupCursors(_drawGroups.size());
+    for(size_t i = 0; i < _drawGroups.size(); i++)
+        groupCursors[i] = _drawGroups[i].firstInstance;
+
+    // Every instance gets placed by its own transform on top of the scene's model matrix,
+    // the textures of a group have to be sharp enough for the instance closest to the camera
+    const glm::mat4 modelView = _camera.view * scene.modelMatrix;
+    for(size_t i = 0; i < objects.size(); i++)
+    {
+        DrawGroup &group = _drawGroups[_objectGroups[i]];
+        const glm::mat4 &transform = scene.objects[objects[i]].transform;
+        instances[groupCursors[_objectGroups[i]]++] = transform;
+
+        // The camera looks down -Z in view space
+        glm::vec4 viewSpaceCenter = modelView * (transform * glm::vec4(group.model->getBoundsCenter(), 1.0f));
+        group.nearestDistance = std::min(group.nearestDistance, -viewSpaceCenter.z);
+    }
+
+    unsigned int firstStreamInstance = (unsigned int)(allocation.offset / sizeof(glm::mat4));
+    for(DrawGroup &group: _drawGroups)
+        group.firstInstance += firstStreamInstance;
+}
+
+void Renderer::PrepareIndirectCommands()
+{
+    const std::vector<DrawPacket> &packets = _renderQueue.getPackets();
+    _indirectCommands.resize(packets.size());
+    for(size_t i = 0; i < packets.size(); i++)
+    {
+        // The arena offsets are in elements, not bytes. The base vertex gets added to every index,
+        // so the indices of a model stay relative to its own first vertex inside of the shared buffer
+        const GeometryAllocation &geometry = packets[i].model->getGeometry();
+        DrawElementsIndirectCommand &command = _indirectCommands[i];
+        command.count = (unsigned int)geometry.indexCount;
+        command.instanceCount = packets[i].instanceCount;
+        command.firstIndex = (unsigned int)geometry.firstIndex;
+        command.baseVertex = (int)geometry.baseVertex;
+        command.baseInstance = packets[i].firstInstance;
+    }
+    _stats.indirectCommands = (unsigned int)_indirectCommands.size();
+
+    if(!_stats.usedMultiDrawIndirect || _indirectCommands.empty())
+        return;
+
+    StreamAllocation allocation = _streamBuffer->Allocate(sizeof(DrawElementsIndirectCommand) * _indirectCommands.size(), sizeof(unsigned int));
+    if(allocation.data == nullptr)
+    {
+        _stats.usedMultiDrawIndirect = false;
+        return;
+    }
+    memcpy(allocation.data, _indirectCommands.data(), sizeof(DrawElementsIndirectCommand) * _indirectCommands.size());
+    _indirectCommandsOffset = allocation.offset;
+
+    // Stays bound until the end of the frame, glMultiDrawElementsIndirect reads the commands from whatever is bound here
+    GL_CALL(glad_glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _streamBuffer->getID()));
+}
+void Renderer::DrawPacketRun(size_t first, size_t count)
+{
+    if(_stats.usedMultiDrawIndirect)
+    {
+        // The offset into the bound indirect buffer is passed in place of a pointer
+        GL_CALL(glad_glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(_indirectCommandsOffset + sizeof(DrawElementsIndirectCommand) * first), (GLsizei)count, 0));
+        _stats.drawCalls++;
+        return;
+    }
+
+    // The base instance offsets the per-instance attributes, so every packet reads its own range of the instance buffer
+    for(size_t i = first; i < first + count; i++)
+    {
+        const DrawElementsIndirectCommand &command = _indirectCommands[i];
+        GL_CALL(glad_glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * command.firstIndex),
+            command.instanceCount, command.baseVertex, command.baseInstance));
+        _stats.drawCalls++;
+    }
+}
+
+void Renderer::StreamUniformBlock(unsigned int binding, const void* const data, size_t size)
+{
+    StreamAllocation allocation = _streamBuffer->Allocate(size, (size_t)_uniformBufferAlignment);
+    if(allocation.data == nullptr)
+        return;
+
+    memcpy(allocation.data, data, size);
+    GLStateCache::getInstance().BindUniformBufferRange(binding, _streamBuffer->getID(), allocation.offset, size);
+}
+
+void Renderer::UpdateSceneBVH(Model *defaultModel)
+{
+    static Scene &scene = Scene::getInstance();
+
+    // Objects being added or removed changes the indices of the objects, so the tree is built again
+    if(scene.objects.size() != _bvhTransforms.size())
+    {
+        _bvhTransforms.resize(scene.objects.size());
+        _bvhModels.resize(scene.objects.size());
+
+        std::vector<AABB> objectBounds(scene.objects.size());
+        for(size_t i = 0; i < scene.objects.size(); i++)
+        {
+            const SceneObject &object = scene.objects[i];
+            const Model *model = object.model != nullptr ? object.model : defaultModel;
+            objectBounds[i] = AABB::Transform(model->getBoundsMin(), model->getBoundsMax(), object.transform);
+            _bvhTransforms[i] = object.transform;
+            _bvhModels[i] = model;
+        }
+        _sceneBVH.Build(objectBounds);
+        return;
+    }
+
+    // Otherwise only the objects that moved or got a different model since the last frame are updated
+    for(size_t i = 0; i < scene.objects.size(); i++)
+    {
+        const SceneObject &object = scene.objects[i];
+        const Model *model = object.model != nullptr ? object.model : defaultModel;
+        if(model == _bvhModels[i] && object.transform == _bvhTransforms[i])
+            continue;
+
+        _sceneBVH.UpdateObject((unsigned int)i, AABB::Transform(model->getBoundsMin(), model->getBoundsMax(), object.transform));
+        _bvhTransforms[i] = object.transform;
+        _bvhModels[i] = model;
+    }
+    _sceneBVH.Refit();
+}
+
+void Renderer::BindShaderTextures(Shader &shader, const Model &model, float distance)
+{
+    static const Texture &missingTex = *(ResourceManager::getInstance().GetTexture("res/internal/tex_missing.jpg"));
+    static TextureStreamer &textureStreamer = TextureStreamer::getInstance();
+
+    std::vector<ShaderUniform*> textureUniforms = shader.getUniformsOfType(ShaderUniformType::TEX2D);
+    // Go through the texture uniforms of the shader and bind the appropriate texture to the appropriate bind target.
+    // If the shader doesn't sample any textures just bind the missing texture
+    if(!textureUniforms.empty())
+    {
+        for (int i = 0; i < textureUniforms.size() && i < 32; i++)
+        {
+            const Texture* const tex = textureUniforms[i]->getValue<Texture*>();
+            if(tex != nullptr && tex->isStreamed())
+                textureStreamer.RequestMipLevel(tex, EstimateRequiredMipLevel(*tex, model, distance));
+
+            // Streamed textures which don't have any levels uploaded yet can't be sampled
+            if(tex != nullptr && tex->getID() != 0 && tex->isResident())
+                tex->BindToUnit(i);
             else
-                missingTex.Unbind();
+                missingTex.BindToUnit(i);
         }
     }
     else
     {
-        GL_CALL(glad_glActiveTexture(GL_TEXTURE0));
-        missingTex.Unbind();
+        missingTex.BindToUnit(0);
+    }
+}
+uint32_t Renderer::GetMaterialID(Shader &shader)
+{
+    uint64_t hash = 0;
+    for(const ShaderUniform* const uniform: shader.getUniformsOfType(ShaderUniformType::TEX2D))
+    {
+        const Texture* const tex = uniform->getValue<Texture*>();
+        unsigned int textureID = tex != nullptr ? tex->getID() : 0;
+        hash = Hash64(&textureID, sizeof(textureID), hash);
     }
+    return (uint32_t)hash;
+}
+
+int Renderer::EstimateRequiredMipLevel(const Texture &texture, const Model &model, float distance) const
+{
+    // Instances behind the camera or around its position get the full resolution
+    distance = std::max(distance, 0.01f);
+
+    // How many pixels a single world unit covers at that distance
+    // and how many texels of the texture get stretched over that same world unit
+    float pixelsPerUnit = _camera.projection[1][1] * 0.5f * (float)_camera.viewportSize.y / distance;
+    float texelsPerUnit = model.getUVDensity() * std::sqrt((float)texture.getSize().x * (float)texture.getSize().y);
+    if(pixelsPerUnit <= 0.0f || texelsPerUnit <= 0.0f)
+        return 0;
 
-    scene.shader->Unbind();
-    scene.model->Unbind();
-};
\ No newline at end of file
+    // Every mip level halves the texel density so the needed level is the log2 of the texel to pixel ratio
+    int level = (int)std::floor(std::log2(texelsPerUnit / pixelsPerUnit));
+    return std::clamp(level, 0, texture.getMipCount() - 1);
+}
\ No newline at end of file
@@ -2,12 +2,18 @@
 
 #include <glad/glad.h>
 #include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
 
 #include "misc/singleton.hpp"
 #include "core/scene.hpp"
 #include "shader.hpp"
 #include "texture.hpp"
 #include "model.hpp"
+#include "stream_buffer.hpp"
+#include "render_queue.hpp"
+#include "bvh.hpp"
+#include "hiz_buffer.hpp"
+#include "software_rasterizer.hpp"
 
 enum class RenderMode
 {
@@ -15,10 +21,85 @@ enum class RenderMode
     WIREFRAME = GL_LINE
 };
 
+enum class RenderBackend
+{
+    OPENGL = 0,
+    // Rasterizes the scene on the CPU and only uses GL to show the result, for machines whose GPU can't be relied on
+    SOFTWARE
+};
+
 struct RendererSettings
 {
     RenderMode renderMode = RenderMode::TRIANGLES;
     glm::vec4 bgColor = glm::vec4(23.0f/255.0f, 22.0f/255.0f, 26.0f/255.0f, 1.0f);
+    bool frustumCulling = true;
+    // Skips the objects hidden behind the ones drawn during the last few frames
+    bool occlusionCulling = false;
+    // Draws every run of packets sharing a shader, material and VAO with a single glMultiDrawElementsIndirect, when the context supports it
+    bool multiDrawIndirect = true;
+    // The software backend always draws filled triangles with the lighting of the Phong shader, whichever shader is picked
+    RenderBackend backend = RenderBackend::OPENGL;
+};
+
+// Counters gathered while drawing the last frame
+struct RendererStats
+{
+    unsigned int uniformUploads = 0;
+    unsigned int drawCalls = 0;
+    unsigned int instances = 0;
+    // Draws written into the indirect command buffer and whether they were actually submitted through it
+    unsigned int indirectCommands = 0;
+    bool usedMultiDrawIndirect = false;
+    // GL state changes that reached the driver and the ones the state cache dropped as redundant
+    unsigned int stateChanges = 0;
+    unsigned int stateChangesAvoided = 0;
+    unsigned int visibleObjects = 0;
+    unsigned int culledObjects = 0;
+    unsigned int occludedObjects = 0;
+    // Time spent updating the BVH and testing it against the frustum
+    float cullTimeMs = 0.0f;
+};
+
+struct CameraData
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::uvec2 viewportSize = glm::uvec2(1, 1);
+};
+
+// Binding points shared by every shader, the uniform blocks in the shaders
+// must declare the same binding with layout(std140, binding = X)
+enum UniformBufferBinding
+{
+    FRAME_DATA = 0,
+    OBJECT_DATA = 1
+};
+
+// Per-frame values shared by every shader through the FrameData uniform block (std140 layout)
+struct FrameUniformData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 viewProjection;
+    glm::vec3 viewPos;
+    float time;
+};
+// Per-object values shared by every shader through the ObjectData uniform block (std140 layout)
+struct ObjectUniformData
+{
+    glm::mat4 modelMatrix;
+    glm::mat4 MVP;
+};
+
+// Layout glMultiDrawElementsIndirect reads every draw from
+struct DrawElementsIndirectCommand
+{
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
 };
 
 class Renderer : public Singleton<Renderer>
@@ -29,9 +110,96 @@ class Renderer : public Singleton<Renderer>
     private:
     Model *_cube;
     Model *_quad;
+    CameraData _camera;
+    float _time = 0.0f;
+    RendererStats _stats;
+
+    // Starting size of a single frame's part of the stream buffer
+    static constexpr size_t STREAM_BUFFER_FRAME_SIZE = 1024 * 1024;
+    // Every piece of data that only lives for a single frame gets written into it
+    StreamBuffer *_streamBuffer = nullptr;
+    int _uniformBufferAlignment = 256;
+
+    // Scene objects sharing a model and shader, drawn with a single instanced draw call.
+    // Their transforms sit next to each other in the instance buffer starting at firstInstance
+    struct DrawGroup
+    {
+        Model *model = nullptr;
+        Shader *shader = nullptr;
+        unsigned int firstInstance = 0;
+        unsigned int instanceCount = 0;
+        // View space distance of the instance closest to the camera, used to pick the mip levels of the group's textures
+        float nearestDistance = 0.0f;
+    };
+    // Rebuilt every frame, kept around so that the memory gets reused
+    std::vector<DrawGroup> _drawGroups;
+    // Index of the draw group of every scene object
+    std::vector<unsigned int> _objectGroups;
+
+    RenderQueue _renderQueue;
+
+    // One command per packet in the order of the sorted queue, so a run of packets is a contiguous range of the buffer
+    std::vector<DrawElementsIndirectCommand> _indirectCommands;
+    // Where this frame's commands start inside of the stream buffer
+    size_t _indirectCommandsOffset = 0;
+    // glMultiDrawElementsIndirect is core since 4.3, older contexts loop over the commands instead
+    bool _multiDrawIndirectSupported = false;
+
+    // Hierarchy over the bounds of the scene objects (without the scene's model matrix) used for frustum culling
+    BVH _sceneBVH;
+    // The transforms and models the BVH was last updated with, used to find the objects that moved
+    std::vector<glm::mat4> _bvhTransforms;
+    std::vector<const Model*> _bvhModels;
+    std::vector<unsigned int> _visibleObjects;
+    CullStats _cullStats;
+
+    HiZBuffer *_hiZBuffer = nullptr;
+    Shader *_hiZDownsampleShader = nullptr;
+
+    // Created the first time the software backend is used, so its threads only exist when they're needed
+    SoftwareRasterizer *_softwareRasterizer = nullptr;
+    // The software frame is uploaded into the texture and blitted from its framebuffer into whatever is being drawn to
+    unsigned int _softwareTexture = 0;
+    unsigned int _softwareFramebuffer = 0;
+    glm::uvec2 _softwareTextureSize = glm::uvec2(0);
 
     public:
-    void Init();
+    // The loader is used to get the functions glad doesn't load
+    void Init(GLADloadproc loader);
     void DeInit();
     void DrawScene();
+
+    inline void SetCamera(const CameraData &camera) { _camera = camera; }
+    inline void SetTime(float time) { _time = time; }
+    inline const CameraData &getCamera() const { return _camera; }
+    inline const RendererStats &getStats() const { return _stats; }
+    inline const HiZBuffer &getHiZBuffer() const { return *_hiZBuffer; }
+    inline const StreamBuffer &getStreamBuffer() const { return *_streamBuffer; }
+    // nullptr until the software backend draws its first frame
+    inline const SoftwareRasterizer *getSoftwareRasterizer() const { return _softwareRasterizer; }
+
+    private:
+    // DrawScene() of the software backend, culls the scene objects the same way and rasterizes them on the CPU
+    void DrawSceneSoftware();
+    // Copies the software frame into the bound draw framebuffer
+    void PresentSoftwareFrame();
+    // Builds the BVH when objects were added or removed, otherwise refits it around the objects that moved
+    void UpdateSceneBVH(Model *defaultModel);
+    // Sorts the given scene objects into draw groups and streams their transforms
+    void PrepareDrawGroups(Model *defaultModel, Shader *defaultShader, const std::vector<unsigned int> &objects);
+    // Fills the indirect commands from the sorted packets and uploads them if they're going to be drawn indirectly
+    void PrepareIndirectCommands();
+    // Draws a range of the sorted packets which all share the bound VAO and shader
+    void DrawPacketRun(size_t first, size_t count);
+    // Streams the values of a std140 uniform block and binds them to the binding point
+    void StreamUniformBlock(unsigned int binding, const void* const data, size_t size);
+    // Binds every texture of the shader to the texture unit its uniform samples from.
+    // The distance is the one of the closest instance drawn with them, see EstimateRequiredMipLevel()
+    void BindShaderTextures(Shader &shader, const Model &model, float distance);
+    // Identifies the set of textures the shader samples, so that packets using the same textures get sorted next to each other
+    static uint32_t GetMaterialID(Shader &shader);
+
+    // Estimates which mip level of the texture is needed for the model to look sharp on screen
+    // at the given distance from the camera along the view direction
+    int EstimateRequiredMipLevel(const Texture &texture, const Model &model, float distance) const;
 };
\ No newline at end of file
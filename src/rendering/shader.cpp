@@ -1,13 +1,20 @@
 #include "shader.hpp"
 
 #include "core/log.hpp"
-#include "misc/utils.hpp"
+#include "core/cpu_profiler.hpp"
+#include "misc/hash.hpp"
 #include "texture.hpp"
+#include "gl_state_cache.hpp"
 
-#include <sstream>
+#include <utility>
+
+// Every uniform value in the arena starts on a 16 byte boundary, which keeps a vec4 or a matrix column
+// from straddling two cache lines
+static constexpr size_t UNIFORM_VALUE_ALIGNMENT = 16;
 
 Shader::Shader(const char *vertSource, const char *fragSource): _id(0)
 {
+    PROFILE_ZONE("Shader::Shader (compile)");
     unsigned int vertShader, fragShader;
     
     // Create and compile VERTEX shader
@@ -26,39 +33,40 @@ Shader::Shader(const char *vertSource, const char *fragSource): _id(0)
     _id = GL_CALL(glad_glCreateProgram());
     GL_CALL(glad_glAttachShader(_id, vertShader));
     GL_CALL(glad_glAttachShader(_id, fragShader));
+    // Lets the driver know that the binary will be retrieved for the program binary cache
+    GL_CALL(glad_glProgramParameteri(_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
     GL_CALL(glad_glLinkProgram(_id));
 
     GL_CALL(glad_glDeleteShader(vertShader));
     GL_CALL(glad_glDeleteShader(fragShader));
+    _isLinked = CheckProgramForErrors(_id);
 
-    // Uniform parsing
-    std::stringstream vertStream(vertSource), fragStream(fragSource);
-    std::string line;
-    // Go through every line of the VERTEX shader
-    // and save the shader uniform if one was declared on the given line
-    while(vertStream.good())
-    {
-        std::getline(vertStream, line, '\n');
-        
-        auto uniform = ParseShaderUniformLine(line);
-        if(uniform != nullptr)
-            _uniforms.push_back(std::move(uniform));    
-    }
-    line.clear();
+    // Ask the linked program for its uniforms rather than parsing the source code
+    ReflectProgram();
+}
+Shader::Shader(unsigned int binaryFormat, const void* const binary, int length): _id(0)
+{
+    PROFILE_ZONE("Shader::Shader (binary)");
+    _id = GL_CALL(glad_glCreateProgram());
+    GL_CALL(glad_glProgramBinary(_id, binaryFormat, binary, length));
 
-    // Go through every line of the FRAGMENT shader
-    // and save the shader uniform if one was declared on the given line
-    while(fragStream.good())
-    {
-        std::getline(fragStream, line, '\n');
-        
-        auto uniform = ParseShaderUniformLine(line);
-        if(uniform != nullptr)
-            _uniforms.push_back(std::move(uniform));    
-    }
+    // A rejected binary isn't an error worth reporting, the caller just falls back to compiling from source
+    int success = 0;
+    GL_CALL(glad_glGetProgramiv(_id, GL_LINK_STATUS, &success));
+    _isLinked = success != 0;
+
+    if(_isLinked)
+        ReflectProgram();
+}
+Shader::Shader(unsigned int linkedProgram): _id(linkedProgram)
+{
+    _isLinked = CheckProgramForErrors(_id);
+    if(_isLinked)
+        ReflectProgram();
 }
 Shader::~Shader()
 {
+    GLStateCache::getInstance().ForgetProgram(_id);
     GL_CALL(glad_glDeleteProgram(_id));
 }
 // Copy
@@ -67,7 +75,15 @@ Shader::Shader(const Shader& other)
     if(&other != this)
     {
         this->_id = other._id;
+        this->_isLinked = other._isLinked;
         this->_uniforms = other._uniforms;
+        this->_uniformValues = other._uniformValues;
+        this->_uniformTable = other._uniformTable;
+        // The copied uniforms still point into the other shader's values
+        for(ShaderUniform &uniform: this->_uniforms)
+            uniform.RebaseValue(other._uniformValues.data(), this->_uniformValues.data());
+        this->_reflection = other._reflection;
+        this->_uniformBlocks = other._uniformBlocks;
     }
 }
 Shader& Shader::operator=(Shader other)
@@ -75,7 +91,15 @@ Shader& Shader::operator=(Shader other)
     if(&other != this)
     {
         this->_id = other._id;
+        this->_isLinked = other._isLinked;
         this->_uniforms = other._uniforms;
+        this->_uniformValues = other._uniformValues;
+        this->_uniformTable = other._uniformTable;
+        // The copied uniforms still point into the other shader's values
+        for(ShaderUniform &uniform: this->_uniforms)
+            uniform.RebaseValue(other._uniformValues.data(), this->_uniformValues.data());
+        this->_reflection = other._reflection;
+        this->_uniformBlocks = other._uniformBlocks;
     }
     return *this;
 }
@@ -85,7 +109,12 @@ Shader::Shader(Shader&& other)
     if(&other != this)
     {
         this->_id = std::move(other._id);
+        this->_isLinked = other._isLinked;
         this->_uniforms = std::move(other._uniforms);
+        this->_uniformValues = std::move(other._uniformValues);
+        this->_uniformTable = std::move(other._uniformTable);
+        this->_reflection = std::move(other._reflection);
+        this->_uniformBlocks = std::move(other._uniformBlocks);
     }
 }
 Shader& Shader::operator=(Shader&& other)
@@ -93,76 +122,99 @@ Shader& Shader::operator=(Shader&& other)
     if(&other != this)
     {
         this->_id = std::move(other._id);
+        this->_isLinked = other._isLinked;
         this->_uniforms = std::move(other._uniforms);
+        this->_uniformValues = std::move(other._uniformValues);
+        this->_uniformTable = std::move(other._uniformTable);
+        this->_reflection = std::move(other._reflection);
+        this->_uniformBlocks = std::move(other._uniformBlocks);
     }
     return *this;
 }
 
 void Shader::Bind() const
 {
-    GL_CALL(glad_glUseProgram(_id));
+    GLStateCache::getInstance().UseProgram(_id);
     UpdateUniforms();
 }
 void Shader::Unbind() const
 {
-    GL_CALL(glad_glUseProgram(0));
+    GLStateCache::getInstance().UseProgram(0);
 }
 
-void Shader::SetUniform(const std::string &name, const void* value)
+void Shader::SwapProgram(Shader &other)
 {
-    for(auto uniform: _uniforms)
-    {
-        if(uniform->getName() == name)
-        {
-            uniform->value = const_cast<void*>(value);
-        }
-    }
+    std::swap(_id, other._id);
+    std::swap(_isLinked, other._isLinked);
+    std::swap(_uniforms, other._uniforms);
+    std::swap(_uniformValues, other._uniformValues);
+    std::swap(_uniformTable, other._uniformTable);
+    std::swap(_reflection, other._reflection);
+    std::swap(_uniformBlocks, other._uniformBlocks);
 }
 void Shader::UpdateUniforms() const
 {
-    // Go through each uniform and update its value
+    // Go through each uniform and update its value if it changed since the last upload
     // The appropriate function must be used for the appropriate type 
-    for(auto &uniform: _uniforms)
+    int textureUnit = 0;
+    for(const ShaderUniform &uniform: _uniforms)
     {
-        unsigned int uniformLocation = GL_CALL(glad_glGetUniformLocation(_id, uniform->getName().c_str()));
-        switch(uniform->getType())
+        // Texture uniforms get the image unit of their place among the texture uniforms unless the texture says otherwise,
+        // which is also where the Renderer binds the missing texture to
+        const int uniformTextureUnit = uniform.getType() == ShaderUniformType::TEX2D ? textureUnit++ : 0;
+
+        if(!uniform.isDirty())
+            continue;
+        uniform.ClearDirty();
+
+        // Uniforms that got optimized out by the compiler don't have a location, there's nothing to upload
+        const int uniformLocation = uniform.getLocation();
+        if(uniformLocation == -1)
+            continue;
+        
+        const unsigned char *value = uniform.getValueData();
+        _uniformUploadCount++;
+        switch(uniform.getType())
         {
             case ShaderUniformType::INT:
             case ShaderUniformType::BOOL:
-                GL_CALL(glad_glUniform1i(uniformLocation, *((int*)(uniform->value))));
+                GL_CALL(glad_glUniform1iv(uniformLocation, 1, (const int*)value));
             break;
             case ShaderUniformType::UINT:
-                GL_CALL(glad_glUniform1ui(uniformLocation, *((unsigned int*)(uniform->value))));
+                GL_CALL(glad_glUniform1uiv(uniformLocation, 1, (const unsigned int*)value));
             break;
             case ShaderUniformType::FLOAT:
-                GL_CALL(glad_glUniform1f(uniformLocation, *((float*)(uniform->value))));
+                GL_CALL(glad_glUniform1fv(uniformLocation, 1, (const float*)value));
             break;
 
 
             case ShaderUniformType::VEC2:
-                GL_CALL(glad_glUniform2fv(uniformLocation, 1, (float*)(uniform->value)));
+                GL_CALL(glad_glUniform2fv(uniformLocation, 1, (const float*)value));
             break;
             case ShaderUniformType::VEC3:
-                GL_CALL(glad_glUniform3fv(uniformLocation, 1, (float*)(uniform->value)));
+                GL_CALL(glad_glUniform3fv(uniformLocation, 1, (const float*)value));
             break;
             case ShaderUniformType::VEC4:
-                GL_CALL(glad_glUniform4fv(uniformLocation, 1, (float*)(uniform->value)));
+                GL_CALL(glad_glUniform4fv(uniformLocation, 1, (const float*)value));
             break;
 
 
             case ShaderUniformType::MAT2:
-                GL_CALL(glad_glUniformMatrix2fv(uniformLocation, 1, false, (float*)(uniform->value)));
+                GL_CALL(glad_glUniformMatrix2fv(uniformLocation, 1, false, (const float*)value));
             break;
             case ShaderUniformType::MAT3:
-                GL_CALL(glad_glUniformMatrix3fv(uniformLocation, 1, false, (float*)(uniform->value)));
+                GL_CALL(glad_glUniformMatrix3fv(uniformLocation, 1, false, (const float*)value));
             break;
             case ShaderUniformType::MAT4:
-                GL_CALL(glad_glUniformMatrix4fv(uniformLocation, 1, false, (float*)(uniform->value)));
+                GL_CALL(glad_glUniformMatrix4fv(uniformLocation, 1, false, (const float*)value));
             break;
 
 
             case ShaderUniformType::TEX2D:
-                GL_CALL(glad_glUniform1i(uniformLocation, ((Texture*)(uniform->value))->getTextureImageUnit()));
+            {
+                const Texture *texture = uniform.getValue<Texture*>();
+                GL_CALL(glad_glUniform1i(uniformLocation, texture != nullptr ? texture->getTextureImageUnit() : uniformTextureUnit));
+            }
             break;
         }
     }
@@ -170,7 +222,7 @@ void Shader::UpdateUniforms() const
 
 // Reports on the potential shader compile errors
 // so that they are known and can be fixed
-void Shader::CheckShaderForErrors(unsigned int shader)
+bool Shader::CheckShaderForErrors(unsigned int shader)
 {
     int success;
     char infoLog[512];
@@ -182,126 +234,205 @@ void Shader::CheckShaderForErrors(unsigned int shader)
         glGetShaderInfoLog(shader, 512, NULL, infoLog);
         Log::LogError("Shader error: " + std::string(infoLog));
     }
+    return success != 0;
+}
+
+// Reports on the potential program link errors, returns whether the program linked successfully
+bool Shader::CheckProgramForErrors(unsigned int program)
+{
+    int success;
+    char infoLog[512];
+
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    if(!success)
+    {
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
+        Log::LogError("Shader program link error: " + std::string(infoLog));
+    }
+    return success != 0;
 }
 
-// Parses the specified line of shader code and checks if a uniform is declared on it
-ShaderUniform* const Shader::ParseShaderUniformLine(const std::string &line)
+std::vector<unsigned char> Shader::getProgramBinary(unsigned int &binaryFormat) const
 {
-    if(line.empty() || line[0] == '#')
-        return nullptr;
+    int length = 0;
+    GL_CALL(glad_glGetProgramiv(_id, GL_PROGRAM_BINARY_LENGTH, &length));
+    if(!_isLinked || length <= 0)
+        return {};
+
+    std::vector<unsigned char> binary(length);
+    GL_CALL(glad_glGetProgramBinary(_id, length, nullptr, &binaryFormat, binary.data()));
+    return binary;
+}
 
-    /* 
-    Separate the line into tokens
-    Format: (layout) uniform type name = default_value
-    
-    NOTE: It'd be a good idea to add support for layout so that
-    texture binding points can be specified in the shader
-    and so that the uniform doesn't get ignored because the first token
-    on the line is something other than "uniform"
-    */
-    auto splitLine = SplitString(line, ' ');
-
-    if(splitLine[0].compare("uniform") == 0)
+// Asks the linked program which uniforms and uniform blocks are active and fills out the reflection tables.
+// Uniforms of the default block with a supported type also get a ShaderUniform so that they can be edited
+void Shader::ReflectProgram()
+{
+    int uniformCount = 0, maxNameLength = 0;
+    GL_CALL(glad_glGetProgramiv(_id, GL_ACTIVE_UNIFORMS, &uniformCount));
+    GL_CALL(glad_glGetProgramiv(_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength));
+
+    if(uniformCount > 0)
     {
-        std::string name;
-        ShaderUniformType type;
-        void *value = nullptr;
-        ShaderUniform* uniform;
-
-        name = splitLine[2];
-        // It's important to delete the ; because otherwise,
-        // glUniformLocation would return the wrong value.
-        // OpenGL doesn't store the uniform names with a ; internally
-        if(name.at(name.size() - 1) == ';')
-            name.erase(name.end() - 1);
-
-        // Set the uniform type appropriately
-        // Sadly, C++ switch statements don't support strings so if-elseif chain it is
-        if(splitLine[1].compare("int") == 0)
-            type = ShaderUniformType::INT;
-        else if(splitLine[1].compare("uint") == 0)
-            type = ShaderUniformType::UINT;
-        else if(splitLine[1].compare("float") == 0)
-            type = ShaderUniformType::FLOAT;
-        else if(splitLine[1].compare("bool") == 0)
-            type = ShaderUniformType::BOOL;
-        else if(splitLine[1].compare("vec2") == 0)
-            type = ShaderUniformType::VEC2;
-        else if(splitLine[1].compare("vec3") == 0)
-            type = ShaderUniformType::VEC3;
-        else if(splitLine[1].compare("vec4") == 0)
-            type = ShaderUniformType::VEC4;
-        else if(splitLine[1].compare("mat2") == 0)
-            type = ShaderUniformType::MAT2;
-        else if(splitLine[1].compare("mat3") == 0)
-            type = ShaderUniformType::MAT3;
-        else if(splitLine[1].compare("mat4") == 0)
-            type = ShaderUniformType::MAT4;
-        else if(splitLine[1].compare("sampler2D") == 0)
-            type = ShaderUniformType::TEX2D;
-
-
-        unsigned int uniformIndex = 0;
-        // The C-string version of the name must be saved
-        // in a variable before using it because of some C++ shenanigans
-        // (otherwise the name doesn't get passed along at all or is messed up)
-        const char* nameCStr = name.c_str();
-        GL_CALL(glad_glGetUniformIndices(_id, 1, &nameCStr, &uniformIndex));
-
-        // Create the value ptr and set it to a value of the appropriate type
-        switch((ShaderUniformType)type)
+        // Query the block index and block offset of every uniform in one go
+        std::vector<unsigned int> uniformIndices(uniformCount);
+        for(int i = 0; i < uniformCount; i++)
+            uniformIndices[i] = i;
+        std::vector<int> blockIndices(uniformCount), offsets(uniformCount);
+        GL_CALL(glad_glGetActiveUniformsiv(_id, uniformCount, uniformIndices.data(), GL_UNIFORM_BLOCK_INDEX, blockIndices.data()));
+        GL_CALL(glad_glGetActiveUniformsiv(_id, uniformCount, uniformIndices.data(), GL_UNIFORM_OFFSET, offsets.data()));
+
+        _reflection.reserve(uniformCount);
+        std::vector<char> nameBuffer(maxNameLength + 1, '\0');
+        for(int i = 0; i < uniformCount; i++)
         {
-            case ShaderUniformType::INT:
-            case ShaderUniformType::BOOL:
-                value = (void*)new int;
-                GL_CALL(glad_glGetUniformiv(_id, uniformIndex, (int*)value));
-            break;
-            case ShaderUniformType::UINT:
-                value = (void*)new unsigned int;
-                GL_CALL(glad_glGetUniformuiv(_id, uniformIndex, (unsigned int*)value));
-            break;
-            case ShaderUniformType::FLOAT:
-                value = (void*)new float;
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value));
-            break;
-            
+            int nameLength = 0, size = 0;
+            unsigned int type = 0;
+            GL_CALL(glad_glGetActiveUniform(_id, i, (int)nameBuffer.size(), &nameLength, &size, &type, nameBuffer.data()));
+
+            // Arrays are reported as "name[0]", the subscript isn't part of the name used in the shader
+            if(nameLength > 3 && nameBuffer[nameLength - 1] == ']' && nameBuffer[nameLength - 2] == '0' && nameBuffer[nameLength - 3] == '[')
+            {
+                nameLength -= 3;
+                nameBuffer[nameLength] = '\0';
+            }
+
+            ShaderReflectionEntry entry;
+            entry.nameHash = HashName(nameBuffer.data(), nameLength);
+            entry.type = type;
+            entry.size = size;
+            entry.blockIndex = blockIndices[i];
+            entry.offset = offsets[i];
+            // Uniforms inside of blocks don't have a location, they're set through the block's buffer
+            if(entry.blockIndex == -1)
+            {
+                entry.location = GL_CALL(glad_glGetUniformLocation(_id, nameBuffer.data()));
+            }
+            _reflection.push_back(entry);
+
+            // Only single values of the default block can be edited through the UI for now
+            if(entry.blockIndex == -1 && entry.size == 1 && IsSupportedUniformType(type))
+            {
+                // The value pointer gets filled in once the size of the arena is known
+                _uniforms.emplace_back(std::string(nameBuffer.data(), nameLength), (ShaderUniformType)type, nullptr, entry.location);
+            }
+        }
 
-            case ShaderUniformType::VEC2:
-                value = (void*)new float[2];
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value));      
-            break;
-            case ShaderUniformType::VEC3:
-                value = (void*)new float[3];
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value));     
-            break;
-            case ShaderUniformType::VEC4:
-                value = (void*)new float[4];
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value));   
-            break;
-            
+        // Lay the values out one after another, each one aligned so that vectors and matrices can be read directly
+        std::vector<size_t> valueOffsets;
+        valueOffsets.reserve(_uniforms.size());
+        size_t arenaSize = 0;
+        for(const ShaderUniform &uniform: _uniforms)
+        {
+            arenaSize = (arenaSize + UNIFORM_VALUE_ALIGNMENT - 1) & ~(UNIFORM_VALUE_ALIGNMENT - 1);
+            valueOffsets.push_back(arenaSize);
+            arenaSize += ShaderUniform::GetValueSize(uniform.getType());
+        }
+        _uniformValues.assign(arenaSize, 0);
 
-            case ShaderUniformType::MAT2:  
-                value = (void*)new float[2*2];
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value));
-            break;
-            case ShaderUniformType::MAT3:  
-                value = (void*)new float[3*3];
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value));   
-            break;
-            case ShaderUniformType::MAT4:  
-                value = (void*)new float[4*4];
-                GL_CALL(glad_glGetUniformfv(_id, uniformIndex, (float*)value)); 
-            break;
+        for(size_t i = 0; i < _uniforms.size(); i++)
+        {
+            _uniforms[i] = ShaderUniform(_uniforms[i].getName(), _uniforms[i].getType(), _uniformValues.data() + valueOffsets[i], _uniforms[i].getLocation());
+            ReadUniformDefaultValue(_uniforms[i]);
+        }
+        BuildUniformTable();
+    }
 
+    int blockCount = 0, maxBlockNameLength = 0;
+    GL_CALL(glad_glGetProgramiv(_id, GL_ACTIVE_UNIFORM_BLOCKS, &blockCount));
+    GL_CALL(glad_glGetProgramiv(_id, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxBlockNameLength));
 
-            case ShaderUniformType::TEX2D:
-                value = (void*)new Texture;
-            break;
+    std::vector<char> blockNameBuffer(maxBlockNameLength + 1, '\0');
+    for(int i = 0; i < blockCount; i++)
+    {
+        int nameLength = 0;
+        GL_CALL(glad_glGetActiveUniformBlockName(_id, i, (int)blockNameBuffer.size(), &nameLength, blockNameBuffer.data()));
+
+        ShaderUniformBlockInfo block;
+        block.name = std::string(blockNameBuffer.data(), nameLength);
+        block.nameHash = HashName(blockNameBuffer.data(), nameLength);
+        block.index = i;
+        GL_CALL(glad_glGetActiveUniformBlockiv(_id, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.dataSize));
+        GL_CALL(glad_glGetActiveUniformBlockiv(_id, i, GL_UNIFORM_BLOCK_BINDING, &block.binding));
+        _uniformBlocks.push_back(std::move(block));
+    }
+}
+
+void Shader::BuildUniformTable()
+{
+    size_t tableSize = 1;
+    while(tableSize < _uniforms.size() * 2)
+        tableSize *= 2;
+    _uniformTable.assign(tableSize, UniformTableSlot());
+
+    const size_t mask = tableSize - 1;
+    for(size_t i = 0; i < _uniforms.size(); i++)
+    {
+        const ShaderUniformID id = _uniforms[i].getID();
+        size_t slot = id & mask;
+        while(_uniformTable[slot].index != -1)
+        {
+            // Two names hashing to the same ID would make one of the uniforms unreachable
+            if(_uniformTable[slot].id == id)
+                Log::LogWarning("Uniforms '" + _uniforms[_uniformTable[slot].index].getName() + "' and '" + _uniforms[i].getName() + "' have the same ID, only the first one can be set by ID");
+            slot = (slot + 1) & mask;
         }
+        _uniformTable[slot].id = id;
+        _uniformTable[slot].index = (int)i;
+    }
+}
 
-        uniform = new ShaderUniform(name, (ShaderUniformType)type, (void*)value);
-        return uniform;
+bool Shader::IsSupportedUniformType(unsigned int type)
+{
+    switch((ShaderUniformType)type)
+    {
+        case ShaderUniformType::INT:
+        case ShaderUniformType::UINT:
+        case ShaderUniformType::BOOL:
+        case ShaderUniformType::FLOAT:
+        case ShaderUniformType::VEC2:
+        case ShaderUniformType::VEC3:
+        case ShaderUniformType::VEC4:
+        case ShaderUniformType::MAT2:
+        case ShaderUniformType::MAT3:
+        case ShaderUniformType::MAT4:
+        case ShaderUniformType::TEX2D:
+            return true;
+        default:
+            return false;
     }
-    else
-        return nullptr;
-}
\ No newline at end of file
+}
+
+// Initializes the value of the uniform to the default value set in the shader
+void Shader::ReadUniformDefaultValue(const ShaderUniform &uniform)
+{
+    if(uniform.getLocation() == -1)
+        return;
+
+    void *value = (void*)uniform.getValueData();
+    switch(uniform.getType())
+    {
+        case ShaderUniformType::INT:
+        case ShaderUniformType::BOOL:
+            GL_CALL(glad_glGetUniformiv(_id, uniform.getLocation(), (int*)value));
+        break;
+        case ShaderUniformType::UINT:
+            GL_CALL(glad_glGetUniformuiv(_id, uniform.getLocation(), (unsigned int*)value));
+        break;
+
+        case ShaderUniformType::FLOAT:
+        case ShaderUniformType::VEC2:
+        case ShaderUniformType::VEC3:
+        case ShaderUniformType::VEC4:
+        case ShaderUniformType::MAT2:
+        case ShaderUniformType::MAT3:
+        case ShaderUniformType::MAT4:
+            GL_CALL(glad_glGetUniformfv(_id, uniform.getLocation(), (float*)value));
+        break;
+
+        // Textures start out empty, the arena is zeroed so the pointer is already nullptr
+        case ShaderUniformType::TEX2D:
+        break;
+    }
+}
@@ -5,15 +5,65 @@
 #include "shader_uniform.hpp"
 
 #include <vector>
+#include <string>
+#include <cstdint>
+
+// A single active uniform of a linked program, as reported by glGetActiveUniform
+struct ShaderReflectionEntry
+{
+    uint32_t nameHash = 0;
+    unsigned int type = 0;
+    // -1 for uniforms inside of uniform blocks
+    int location = -1;
+    // Amount of array elements, 1 for non-array uniforms
+    int size = 1;
+    // Byte offset inside of the uniform block, -1 for uniforms of the default block
+    int offset = -1;
+    int blockIndex = -1;
+};
+
+struct ShaderUniformBlockInfo
+{
+    std::string name;
+    uint32_t nameHash = 0;
+    unsigned int index = 0;
+    int dataSize = 0;
+    int binding = 0;
+};
 
 class Shader
 {
     private:
     unsigned int _id = 0;
-    std::vector<ShaderUniform*> _uniforms;
+    bool _isLinked = false;
+    // Only the uniforms that can be edited (single values of the default block)
+    std::vector<ShaderUniform> _uniforms;
+    // The values of all of the uniforms above, each uniform points to its own slot.
+    // Allocated once after reflecting the program and never resized, so the pointers stay valid
+    std::vector<unsigned char> _uniformValues;
+    // Open addressing hash table (linear probing) from uniform ID to the uniform's index in _uniforms.
+    // Its size is a power of two of at least twice the amount of uniforms, so a lookup usually hits on the first probe
+    // and there's always an empty slot to end the probing at
+    struct UniformTableSlot
+    {
+        ShaderUniformID id = 0;
+        int index = -1;
+    };
+    std::vector<UniformTableSlot> _uniformTable;
+    // Every active uniform and uniform block of the program
+    std::vector<ShaderReflectionEntry> _reflection;
+    std::vector<ShaderUniformBlockInfo> _uniformBlocks;
+
+    // Amount of glUniform* calls issued by all shaders since the last reset, used for profiling
+    inline static unsigned int _uniformUploadCount = 0;
 
     public:
     Shader(const char *vertSource, const char *fragSource);
+    // Creates the program from a binary previously retrieved with getProgramBinary().
+    // The driver may reject the binary (eg. after a driver update), check isLinked() afterwards
+    Shader(unsigned int binaryFormat, const void* const binary, int length);
+    // Takes ownership of a program that was already linked elsewhere (eg. by the ShaderCompiler)
+    explicit Shader(unsigned int linkedProgram);
     // Copy
     Shader(const Shader& other);
     Shader& operator=(Shader other);
@@ -27,22 +77,71 @@ class Shader
     void Unbind() const;
 
     inline const unsigned int &getID() const { return _id; }
-    inline const std::vector<ShaderUniform*> &getUniforms() const { return _uniforms; };
-    inline const std::vector<ShaderUniform*> getUniformsOfType(const ShaderUniformType &type) const 
+    inline bool isLinked() const { return _isLinked; }
+    // Retrieves the linked program in the driver's binary format so that it can be cached on disk
+    std::vector<unsigned char> getProgramBinary(unsigned int &binaryFormat) const;
+    inline std::vector<ShaderUniform> &getUniforms() { return _uniforms; }
+    inline const std::vector<ShaderUniform> &getUniforms() const { return _uniforms; }
+    inline const std::vector<ShaderReflectionEntry> &getReflection() const { return _reflection; }
+    inline const std::vector<ShaderUniformBlockInfo> &getUniformBlocks() const { return _uniformBlocks; }
+    inline std::vector<ShaderUniform*> getUniformsOfType(const ShaderUniformType &type)
     {
-        std::vector<ShaderUniform*> uniformsOfSpecifiedType;; 
-        for(ShaderUniform* const uniform: _uniforms)
+        std::vector<ShaderUniform*> uniformsOfSpecifiedType;
+        for(ShaderUniform &uniform: _uniforms)
         {
-            if(uniform->getType() == type)
-                uniformsOfSpecifiedType.push_back(uniform);
+            if(uniform.getType() == type)
+                uniformsOfSpecifiedType.push_back(&uniform);
         }
-        return std::move(uniformsOfSpecifiedType);
+        return uniformsOfSpecifiedType;
     }
 
-    void SetUniform(const std::string &name, const void* value);
+    // Returns nullptr if the shader doesn't have an editable uniform with the given ID
+    inline ShaderUniform *FindUniform(ShaderUniformID id) { return const_cast<ShaderUniform*>(static_cast<const Shader*>(this)->FindUniform(id)); }
+    inline const ShaderUniform *FindUniform(ShaderUniformID id) const
+    {
+        if(_uniformTable.empty())
+            return nullptr;
+
+        const size_t mask = _uniformTable.size() - 1;
+        for(size_t slot = id & mask;; slot = (slot + 1) & mask)
+        {
+            const UniformTableSlot &entry = _uniformTable[slot];
+            if(entry.index == -1)
+                return nullptr;
+            if(entry.id == id)
+                return &_uniforms[entry.index];
+        }
+    }
+
+    // The value is copied into the shader and uploaded on the next Bind() if it changed.
+    // Setting a uniform with a C++ type that doesn't map to a GLSL type fails to compile.
+    // Returns false if the shader doesn't have the uniform or it's of a different type
+    template<typename T>
+    bool SetUniform(ShaderUniformID id, const T &value)
+    {
+        static_assert(ShaderUniformTypeOf<T>::isSupported, "Unsupported shader uniform type");
+        ShaderUniform *uniform = FindUniform(id);
+        return uniform != nullptr && uniform->SetValue<T>(value);
+    }
+    // Hashes the name on every call, prefer the ID version with UNIFORM_ID() for anything that runs every frame
+    template<typename T>
+    bool SetUniform(const std::string &name, const T &value) { return SetUniform<T>(GetUniformID(name), value); }
+
+    // Exchanges the programs of the two shaders along with their uniforms and reflection data.
+    // Used by hot-reloading so that everything holding a pointer to this shader picks up the new program
+    void SwapProgram(Shader &other);
+
+    // Report on the potential compile/link errors, return whether the shader/program is usable
+    static bool CheckShaderForErrors(unsigned int shader);
+    static bool CheckProgramForErrors(unsigned int program);
+
+    inline static unsigned int getUniformUploadCount() { return _uniformUploadCount; }
+    inline static void ResetUniformUploadCount() { _uniformUploadCount = 0; }
 
     private:
     void UpdateUniforms() const;
-    void CheckShaderForErrors(unsigned int shader);
-    ShaderUniform* const ParseShaderUniformLine(const std::string &line);
+    void ReflectProgram();
+    static bool IsSupportedUniformType(unsigned int type);
+    void ReadUniformDefaultValue(const ShaderUniform &uniform);
+    void BuildUniformTable();
 };
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "shader_cache.hpp"
+
+#include "core/log.hpp"
+#include "misc/hash.hpp"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <cstdio>
+
+// Header written at the start of every cached binary
+struct ShaderCacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t driverHash;
+    uint32_t binaryFormat;
+    uint32_t binaryLength;
+};
+static constexpr uint32_t SHADER_CACHE_MAGIC = 0x4250564D; // "MVPB"
+static constexpr uint32_t SHADER_CACHE_VERSION = 1;
+
+void ShaderCache::Init(const std::string &directory)
+{
+    _directory = directory;
+
+    int formatCount = 0;
+    GL_CALL(glad_glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount));
+    if(formatCount <= 0)
+    {
+        Log::LogInfo("Driver doesn't support any program binary formats, shader cache disabled");
+        _enabled = false;
+        return;
+    }
+    _supportedFormats.resize(formatCount);
+    GL_CALL(glad_glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, _supportedFormats.data()));
+
+    // The binaries are only valid for the exact driver that created them
+    std::string renderer = (const char*)glad_glGetString(GL_RENDERER);
+    std::string version = (const char*)glad_glGetString(GL_VERSION);
+    std::string driver = renderer + "|" + version;
+    _driverHash = Hash64(driver.data(), driver.size());
+
+    std::error_code error;
+    std::filesystem::create_directories(_directory, error);
+    if(error)
+    {
+        Log::LogWarning("Couldn't create shader cache directory '" + _directory + "', shader cache disabled");
+        _enabled = false;
+        return;
+    }
+
+    _enabled = true;
+}
+
+Shader *ShaderCache::LoadOrCompile(const std::string &vertSource, const std::string &fragSource)
+{
+    Shader *shader = TryLoad(vertSource, fragSource);
+    if(shader != nullptr)
+        return shader;
+
+    shader = new Shader(vertSource.c_str(), fragSource.c_str());
+    Store(vertSource, fragSource, *shader);
+    return shader;
+}
+
+Shader *ShaderCache::TryLoad(const std::string &vertSource, const std::string &fragSource)
+{
+    if(!_enabled)
+        return nullptr;
+
+    Shader *shader = LoadFromFile(GetCacheFilePath(GetKey(vertSource, fragSource)));
+    if(shader != nullptr)
+        _stats.hits++;
+    else
+        _stats.misses++;
+    return shader;
+}
+void ShaderCache::Store(const std::string &vertSource, const std::string &fragSource, const Shader &shader)
+{
+    if(!_enabled || !shader.isLinked())
+        return;
+
+    SaveToFile(GetCacheFilePath(GetKey(vertSource, fragSource)), shader);
+}
+
+uint64_t ShaderCache::GetKey(const std::string &vertSource, const std::string &fragSource) const
+{
+    uint64_t key = Hash64(vertSource.data(), vertSource.size(), _driverHash);
+    return Hash64(fragSource.data(), fragSource.size(), key);
+}
+
+std::string ShaderCache::GetCacheFilePath(uint64_t key) const
+{
+    char fileName[32];
+    snprintf(fileName, sizeof(fileName), "%016llx.bin", (unsigned long long)key);
+    return _directory + "/" + fileName;
+}
+
+Shader *ShaderCache::LoadFromFile(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if(!file.is_open())
+        return nullptr;
+
+    ShaderCacheFileHeader header;
+    if(!file.read((char*)&header, sizeof(header)))
+        return nullptr;
+
+    bool isFormatSupported = std::find(_supportedFormats.begin(), _supportedFormats.end(), (int)header.binaryFormat) != _supportedFormats.end();
+    if(header.magic != SHADER_CACHE_MAGIC || header.version != SHADER_CACHE_VERSION || header.driverHash != _driverHash || !isFormatSupported)
+        return nullptr;
+
+    std::vector<unsigned char> binary(header.binaryLength);
+    if(!file.read((char*)binary.data(), binary.size()))
+        return nullptr;
+    file.close();
+
+    Shader *shader = new Shader(header.binaryFormat, binary.data(), (int)binary.size());
+    if(!shader->isLinked())
+    {
+        // The driver is free to reject binaries at any time, get rid of the stale one and compile from source instead
+        Log::LogInfo("Driver rejected cached shader binary '" + path + "', recompiling");
+        _stats.rejected++;
+        delete shader;
+
+        std::error_code error;
+        std::filesystem::remove(path, error);
+        return nullptr;
+    }
+    return shader;
+}
+
+void ShaderCache::SaveToFile(const std::string &path, const Shader &shader)
+{
+    unsigned int binaryFormat = 0;
+    std::vector<unsigned char> binary = shader.getProgramBinary(binaryFormat);
+    if(binary.empty())
+        return;
+
+    ShaderCacheFileHeader header;
+    header.magic = SHADER_CACHE_MAGIC;
+    header.version = SHADER_CACHE_VERSION;
+    header.driverHash = _driverHash;
+    header.binaryFormat = binaryFormat;
+    header.binaryLength = (uint32_t)binary.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if(!file.is_open())
+    {
+        Log::LogWarning("Couldn't write shader cache file '" + path + "'");
+        return;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)binary.data(), binary.size());
+}
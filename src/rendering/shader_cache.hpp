@@ -0,0 +1,56 @@
+#pragma once
+
+#include "misc/singleton.hpp"
+#include "shader.hpp"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct ShaderCacheStats
+{
+    unsigned int hits = 0;
+    unsigned int misses = 0;
+    // Cached binaries the driver refused to load (eg. after a driver update)
+    unsigned int rejected = 0;
+};
+
+// Caches linked programs on disk using glGetProgramBinary so that later launches
+// can skip compiling and linking the shaders from source.
+// Binaries are keyed by the hash of the shader sources and the GL_RENDERER/GL_VERSION strings,
+// the binary format is stored alongside them and checked against the formats the driver supports
+class ShaderCache final : public Singleton<ShaderCache>
+{
+    friend class Singleton<ShaderCache>;
+
+    private:
+    std::string _directory;
+    bool _enabled = false;
+    uint64_t _driverHash = 0;
+    std::vector<int> _supportedFormats;
+    ShaderCacheStats _stats;
+
+    private:
+    ShaderCache() = default;
+    ~ShaderCache() = default;
+
+    public:
+    // Must be called after the GL context was created
+    void Init(const std::string &directory = "cache/shaders");
+
+    // Returns the cached program if there's a valid one, otherwise compiles the program from source and caches it
+    Shader *LoadOrCompile(const std::string &vertSource, const std::string &fragSource);
+    // Returns the cached program or nullptr if there's no valid one
+    Shader *TryLoad(const std::string &vertSource, const std::string &fragSource);
+    // Caches the binary of a program that was compiled from the given sources
+    void Store(const std::string &vertSource, const std::string &fragSource, const Shader &shader);
+
+    inline bool isEnabled() const { return _enabled; }
+    inline const ShaderCacheStats &getStats() const { return _stats; }
+
+    private:
+    uint64_t GetKey(const std::string &vertSource, const std::string &fragSource) const;
+    std::string GetCacheFilePath(uint64_t key) const;
+    Shader *LoadFromFile(const std::string &path);
+    void SaveToFile(const std::string &path, const Shader &shader);
+};
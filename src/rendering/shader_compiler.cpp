@@ -0,0 +1,155 @@
+#include "shader_compiler.hpp"
+
+#include "core/log.hpp"
+#include "core/cpu_profiler.hpp"
+
+#include <cstring>
+
+// KHR_parallel_shader_compile isn't part of the generated glad loader
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+void ShaderCompiler::Init(GLADloadproc loader)
+{
+    int extensionCount = 0;
+    GL_CALL(glad_glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount));
+    for(int i = 0; i < extensionCount; i++)
+    {
+        const char *extension = (const char*)glad_glGetStringi(GL_EXTENSIONS, i);
+        if(strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)
+        {
+            _hasParallelCompile = true;
+            break;
+        }
+    }
+
+    if(_hasParallelCompile)
+    {
+        // Let the driver decide how many threads to use
+        auto maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsKHR");
+        if(maxShaderCompilerThreads == nullptr)
+            maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)loader("glMaxShaderCompilerThreadsARB");
+        if(maxShaderCompilerThreads != nullptr)
+            maxShaderCompilerThreads(0xFFFFFFFF);
+        
+        Log::LogInfo("Parallel shader compilation available");
+    }
+}
+
+void ShaderCompiler::Submit(const std::string &vertSource, const std::string &fragSource, ShaderCompiledCallback onCompiled)
+{
+    Job job;
+    job.vertSource = vertSource;
+    job.fragSource = fragSource;
+    job.onCompiled = std::move(onCompiled);
+
+    // With the extension the compile and link calls return right away, so everything can be issued at once
+    if(_hasParallelCompile)
+    {
+        CompileVertex(job);
+        CompileFragment(job);
+        Link(job);
+    }
+    _jobs.push_back(std::move(job));
+}
+
+void ShaderCompiler::Update()
+{
+    PROFILE_ZONE("ShaderCompiler::Update");
+    // The callbacks get called only after the loop because they are free to submit new jobs
+    std::vector<std::pair<ShaderCompiledCallback, Shader*>> finishedJobs;
+    for(auto it = _jobs.begin(); it != _jobs.end();)
+    {
+        Job &job = *it;
+        bool isFinished = false;
+        Shader *shader = nullptr;
+        switch(job.state)
+        {
+            case JobState::COMPILE_VERTEX:      CompileVertex(job);                break;
+            case JobState::COMPILE_FRAGMENT:    CompileFragment(job);              break;
+            case JobState::LINK:                Link(job);                         break;
+            case JobState::WAIT_FOR_COMPLETION: isFinished = Finish(job, shader);  break;
+        }
+
+        if(isFinished)
+        {
+            finishedJobs.push_back(std::make_pair(std::move(job.onCompiled), shader));
+            it = _jobs.erase(it);
+        }
+        else
+            it++;
+    }
+
+    for(auto &finishedJob: finishedJobs)
+    {
+        if(finishedJob.first)
+            finishedJob.first(finishedJob.second);
+    }
+}
+
+void ShaderCompiler::CompileVertex(Job &job)
+{
+    const char *source = job.vertSource.c_str();
+    job.vertShader = GL_CALL(glad_glCreateShader(GL_VERTEX_SHADER));
+    GL_CALL(glad_glShaderSource(job.vertShader, 1, &source, 0));
+    GL_CALL(glad_glCompileShader(job.vertShader));
+    job.state = JobState::COMPILE_FRAGMENT;
+}
+void ShaderCompiler::CompileFragment(Job &job)
+{
+    const char *source = job.fragSource.c_str();
+    job.fragShader = GL_CALL(glad_glCreateShader(GL_FRAGMENT_SHADER));
+    GL_CALL(glad_glShaderSource(job.fragShader, 1, &source, 0));
+    GL_CALL(glad_glCompileShader(job.fragShader));
+    job.state = JobState::LINK;
+}
+void ShaderCompiler::Link(Job &job)
+{
+    job.program = GL_CALL(glad_glCreateProgram());
+    GL_CALL(glad_glAttachShader(job.program, job.vertShader));
+    GL_CALL(glad_glAttachShader(job.program, job.fragShader));
+    GL_CALL(glad_glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    GL_CALL(glad_glLinkProgram(job.program));
+    job.state = JobState::WAIT_FOR_COMPLETION;
+}
+bool ShaderCompiler::Finish(Job &job, Shader *&shader)
+{
+    // Querying anything other than the completion status would block until the driver is done
+    if(_hasParallelCompile)
+    {
+        int isComplete = 0;
+        GL_CALL(glad_glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &isComplete));
+        if(!isComplete)
+            return false;
+    }
+
+    bool compiled = Shader::CheckShaderForErrors(job.vertShader);
+    compiled = Shader::CheckShaderForErrors(job.fragShader) && compiled;
+
+    GL_CALL(glad_glDetachShader(job.program, job.vertShader));
+    GL_CALL(glad_glDetachShader(job.program, job.fragShader));
+    GL_CALL(glad_glDeleteShader(job.vertShader));
+    GL_CALL(glad_glDeleteShader(job.fragShader));
+
+    shader = nullptr;
+    if(compiled)
+    {
+        shader = new Shader(job.program);
+        if(!shader->isLinked())
+        {
+            delete shader;
+            shader = nullptr;
+        }
+    }
+    else
+    {
+        GL_CALL(glad_glDeleteProgram(job.program));
+    }
+
+    return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "misc/singleton.hpp"
+#include "shader.hpp"
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// Called once the program finished linking, the shader is nullptr if compiling or linking failed
+using ShaderCompiledCallback = std::function<void(Shader*)>;
+
+// Compiles shaders without blocking the frame.
+// If the driver supports KHR_parallel_shader_compile, everything gets submitted right away and the driver
+// compiles on its own threads, the jobs are then polled with GL_COMPLETION_STATUS_KHR every frame.
+// Otherwise every job advances by one step (compile vert, compile frag, link) per frame
+class ShaderCompiler final : public Singleton<ShaderCompiler>
+{
+    friend class Singleton<ShaderCompiler>;
+
+    private:
+    enum class JobState
+    {
+        COMPILE_VERTEX,
+        COMPILE_FRAGMENT,
+        LINK,
+        WAIT_FOR_COMPLETION
+    };
+    struct Job
+    {
+        JobState state = JobState::COMPILE_VERTEX;
+        std::string vertSource;
+        std::string fragSource;
+        unsigned int vertShader = 0;
+        unsigned int fragShader = 0;
+        unsigned int program = 0;
+        ShaderCompiledCallback onCompiled;
+    };
+
+    bool _hasParallelCompile = false;
+    std::vector<Job> _jobs;
+
+    private:
+    ShaderCompiler() = default;
+    ~ShaderCompiler() = default;
+
+    public:
+    // Must be called after the GL context was created, the loader is used to get the extension's entry points
+    void Init(GLADloadproc loader);
+
+    void Submit(const std::string &vertSource, const std::string &fragSource, ShaderCompiledCallback onCompiled);
+    // Advances/polls the submitted jobs, must be called once per frame on the GL thread
+    void Update();
+
+    inline bool hasParallelCompile() const { return _hasParallelCompile; }
+    inline size_t getPendingJobCount() const { return _jobs.size(); }
+
+    private:
+    void CompileVertex(Job &job);
+    void CompileFragment(Job &job);
+    void Link(Job &job);
+    // Returns true if the job is finished, the shader is nullptr if the job failed
+    bool Finish(Job &job, Shader *&shader);
+};
@@ -0,0 +1,142 @@
+#include "shader_preprocessor.hpp"
+
+#include "core/log.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+
+static std::string TrimLeadingWhitespace(const std::string &line)
+{
+    size_t start = line.find_first_not_of(" \t");
+    return start == std::string::npos ? "" : line.substr(start);
+}
+
+static std::string CanonicalizeIncludePath(const std::filesystem::path &path)
+{
+    std::error_code error;
+    std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, error);
+    return error ? path.lexically_normal().generic_string() : canonicalPath.generic_string();
+}
+
+PreprocessedShader ShaderPreprocessor::Process(const std::string &path)
+{
+    PreprocessedShader result;
+    std::vector<std::string> processedFiles;
+    result.succeeded = ProcessFile(CanonicalizeIncludePath(path), result, processedFiles);
+
+    // The shader itself is always the first processed file, everything after it got included
+    if(processedFiles.size() > 1)
+        result.includedFiles.assign(processedFiles.begin() + 1, processedFiles.end());
+
+    if(result.variantKeys.size() > MAX_VARIANT_KEYS)
+    {
+        Log::LogWarning("Shader '" + path + "' declares more than " + std::to_string(MAX_VARIANT_KEYS) + " variant keys, the extra keys are ignored");
+        result.variantKeys.resize(MAX_VARIANT_KEYS);
+    }
+    return result;
+}
+
+bool ShaderPreprocessor::ProcessFile(const std::string &path, PreprocessedShader &result, std::vector<std::string> &processedFiles)
+{
+    std::ifstream fileStream(path);
+    if(!fileStream.is_open())
+    {
+        Log::LogError("Couldn't read shader file, path: " + path);
+        return false;
+    }
+
+    const int sourceStringNumber = (int)processedFiles.size();
+    processedFiles.push_back(path);
+    const std::filesystem::path directory = std::filesystem::path(path).parent_path();
+
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(fileStream, line))
+    {
+        lineNumber++;
+        std::string directive = TrimLeadingWhitespace(line);
+
+        if(directive.rfind("#include", 0) == 0)
+        {
+            size_t pathStart = directive.find_first_of("\"<");
+            size_t pathEnd = pathStart != std::string::npos ? directive.find_first_of("\">", pathStart + 1) : std::string::npos;
+            if(pathEnd == std::string::npos)
+            {
+                Log::LogError("Malformed #include in '" + path + "' on line " + std::to_string(lineNumber));
+                return false;
+            }
+
+            std::string includePath = CanonicalizeIncludePath(directory / directive.substr(pathStart + 1, pathEnd - pathStart - 1));
+            // Every file only gets pasted in once, which also stops files that include each other from recursing forever
+            if(std::find(processedFiles.begin(), processedFiles.end(), includePath) == processedFiles.end())
+            {
+                result.source += "#line 1 " + std::to_string(processedFiles.size()) + "\n";
+                if(!ProcessFile(includePath, result, processedFiles))
+                    return false;
+                result.source += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceStringNumber) + "\n";
+            }
+            else
+            {
+                result.source += "\n";
+            }
+            continue;
+        }
+
+        if(directive.rfind("#pragma", 0) == 0)
+        {
+            std::istringstream tokens(directive);
+            std::string pragma, type, key;
+            tokens >> pragma >> type >> key;
+            if(type == "variant")
+            {
+                if(key.empty())
+                    Log::LogWarning("'#pragma variant' without a key in '" + path + "' on line " + std::to_string(lineNumber));
+                else if(std::find(result.variantKeys.begin(), result.variantKeys.end(), key) == result.variantKeys.end())
+                    result.variantKeys.push_back(key);
+
+                // Keep the line count intact so that the line numbers in compile errors still match
+                result.source += "\n";
+                continue;
+            }
+        }
+
+        result.source += line + "\n";
+    }
+
+    return true;
+}
+
+std::string ShaderPreprocessor::InjectDefines(const std::string &source, const std::vector<std::string> &defines)
+{
+    if(defines.empty())
+        return source;
+
+    std::string defineLines;
+    for(const std::string &define: defines)
+        defineLines += "#define " + define + "\n";
+
+    // Put the defines right after the #version line and reset the line number so the error messages stay correct
+    size_t versionPos = source.find("#version");
+    if(versionPos == std::string::npos)
+        return defineLines + "#line 1 0\n" + source;
+
+    size_t versionLineEnd = source.find('\n', versionPos);
+    if(versionLineEnd == std::string::npos)
+        return source + "\n" + defineLines;
+
+    int versionLine = (int)std::count(source.begin(), source.begin() + versionLineEnd, '\n') + 1;
+    return source.substr(0, versionLineEnd + 1) + defineLines + "#line " + std::to_string(versionLine + 1) + " 0\n" + source.substr(versionLineEnd + 1);
+}
+
+std::vector<std::string> ShaderPreprocessor::GetEnabledKeys(const std::vector<std::string> &keys, uint32_t mask)
+{
+    std::vector<std::string> enabledKeys;
+    for(size_t i = 0; i < keys.size() && i < MAX_VARIANT_KEYS; i++)
+    {
+        if(mask & (1u << i))
+            enabledKeys.push_back(keys[i]);
+    }
+    return enabledKeys;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+struct PreprocessedShader
+{
+    std::string source;
+    // Canonical paths of every file pulled in through #include, used to rebuild the shader when one of them changes
+    std::vector<std::string> includedFiles;
+    // Keys declared with '#pragma variant KEY', in the order they were declared
+    std::vector<std::string> variantKeys;
+    bool succeeded = true;
+};
+
+// Runs before the GLSL sources get handed to the driver and adds what plain GLSL is missing:
+//  - #include "file" pastes the file in, the path is relative to the file that includes it.
+//    Every file is only included once per shader, so shared uniform blocks can be included from multiple files
+//  - #pragma variant KEY declares a permutation key. Every combination of keys is compiled as its own program
+//    with the enabled keys #define'd, see InjectDefines()
+// Included files get their own source string number in #line directives, so compile errors point at
+// the right line (file 0 is the shader itself, the included files are numbered in the order they were included)
+class ShaderPreprocessor final
+{
+    public:
+    // A variant mask is a uint32_t, which limits the amount of keys a shader can declare
+    static constexpr size_t MAX_VARIANT_KEYS = 32;
+
+    public:
+    static PreprocessedShader Process(const std::string &path);
+    // Adds a #define for every given name right after the #version directive, which has to stay the first line
+    static std::string InjectDefines(const std::string &source, const std::vector<std::string> &defines);
+    // Returns the keys whose bits are set in the mask
+    static std::vector<std::string> GetEnabledKeys(const std::vector<std::string> &keys, uint32_t mask);
+
+    private:
+    static bool ProcessFile(const std::string &path, PreprocessedShader &result, std::vector<std::string> &processedFiles);
+};
@@ -3,7 +3,21 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "misc/hash.hpp"
+
 #include <string>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+class Texture;
+
+// Uniforms are identified by the hash of their name so that setting one doesn't involve any string compares
+using ShaderUniformID = uint32_t;
+
+inline ShaderUniformID GetUniformID(const std::string &name) { return HashName(name.data(), name.size()); }
+// Hashes a string literal at compile time, eg. shader->SetUniform(UNIFORM_ID("u_Color"), color)
+#define UNIFORM_ID(name) (std::integral_constant<ShaderUniformID, HashName(name, sizeof(name) - 1)>::value)
 
 enum class ShaderUniformType
 {
@@ -27,31 +41,104 @@ enum class ShaderUniformType
     TEX3D = GL_SAMPLER_3D
 };
 
+// Maps the C++ types a uniform can be set with to the matching ShaderUniformType,
+// setting a uniform with any other type fails to compile.
+// Storage is the type the value is kept as in the shader's value arena
+template<typename T> struct ShaderUniformTypeOf { static constexpr bool isSupported = false; };
+#define SHADER_UNIFORM_TYPE_OF(cppType, storageType, uniformType) \
+    template<> struct ShaderUniformTypeOf<cppType> \
+    { \
+        static constexpr bool isSupported = true; \
+        static constexpr ShaderUniformType type = uniformType; \
+        using Storage = storageType; \
+    };
+SHADER_UNIFORM_TYPE_OF(int,          int,          ShaderUniformType::INT)
+SHADER_UNIFORM_TYPE_OF(unsigned int, unsigned int, ShaderUniformType::UINT)
+// GLSL bools are 4 bytes wide, which is what glGetUniformiv/glUniform1i work with
+SHADER_UNIFORM_TYPE_OF(bool,         int,          ShaderUniformType::BOOL)
+SHADER_UNIFORM_TYPE_OF(float,        float,        ShaderUniformType::FLOAT)
+SHADER_UNIFORM_TYPE_OF(glm::vec2,    glm::vec2,    ShaderUniformType::VEC2)
+SHADER_UNIFORM_TYPE_OF(glm::vec3,    glm::vec3,    ShaderUniformType::VEC3)
+SHADER_UNIFORM_TYPE_OF(glm::vec4,    glm::vec4,    ShaderUniformType::VEC4)
+SHADER_UNIFORM_TYPE_OF(glm::mat2,    glm::mat2,    ShaderUniformType::MAT2)
+SHADER_UNIFORM_TYPE_OF(glm::mat3,    glm::mat3,    ShaderUniformType::MAT3)
+SHADER_UNIFORM_TYPE_OF(glm::mat4,    glm::mat4,    ShaderUniformType::MAT4)
+// Textures are owned by the ResourceManager, the uniform only points to them. nullptr means no texture was picked
+SHADER_UNIFORM_TYPE_OF(Texture*,     Texture*,     ShaderUniformType::TEX2D)
+#undef SHADER_UNIFORM_TYPE_OF
+
+// Describes a single editable uniform of a shader.
+// The value itself lives in the value arena of the shader that owns the uniform (see Shader::ReflectProgram)
+// so that all values of a shader sit next to each other in memory and nothing gets allocated per uniform
 struct ShaderUniform final
 {
     private:
     std::string _name = "";
+    ShaderUniformID _id = 0;
     ShaderUniformType _type = ShaderUniformType::UNDEFINED;
-    public:
-    void* value = nullptr;
+    // Resolved once after the program gets linked so it doesn't have to be looked up by name on every upload
+    int _location = -1;
+    // Points into the owning shader's value arena
+    unsigned char *_value = nullptr;
+    // Set whenever the value changes so that only changed uniforms get uploaded on Bind().
+    // Mutable because uploading the value (which clears the flag) doesn't change the shader
+    mutable bool _dirty = true;
 
     public: 
-    ShaderUniform();
-    ShaderUniform(const std::string name, const ShaderUniformType type, void* value);
-    // Copy
-    ShaderUniform(const ShaderUniform& other);
-    ShaderUniform& operator=(ShaderUniform other);
-    // Move
-    ShaderUniform(ShaderUniform&& other);
-    ShaderUniform& operator=(ShaderUniform&& other);
-    ~ShaderUniform();
+    ShaderUniform() = default;
+    ShaderUniform(const std::string name, const ShaderUniformType type, unsigned char *value, int location = -1);
 
     inline const std::string &getName()       const { return _name; }
+    inline ShaderUniformID getID()            const { return _id; }
     inline const ShaderUniformType &getType() const { return _type; }
+    inline const int &getLocation()           const { return _location; }
+    inline bool isDirty()                     const { return _dirty; }
+    inline const unsigned char *getValueData() const { return _value; }
 
-    private:
-    // Util func: Handles casting the pointer to the appropriate type before copying
-    void CopyValuePtr(void* const src);
-    // Util func: Handles casting the pointer to the appropriate type before deleting 
-    void DeleteValuePtr();
+    // Must be called after changing the value through getValuePtr(), otherwise the change never reaches the GPU
+    inline void MarkDirty()  { _dirty = true; }
+    inline void ClearDirty() const { _dirty = false; }
+
+    // Returns nullptr if the uniform isn't of the given type
+    template<typename T>
+    typename ShaderUniformTypeOf<T>::Storage *getValuePtr()
+    {
+        static_assert(ShaderUniformTypeOf<T>::isSupported, "Unsupported shader uniform type");
+        if(_type != ShaderUniformTypeOf<T>::type)
+            return nullptr;
+        return (typename ShaderUniformTypeOf<T>::Storage*)_value;
+    }
+    template<typename T>
+    T getValue() const
+    {
+        static_assert(ShaderUniformTypeOf<T>::isSupported, "Unsupported shader uniform type");
+        typename ShaderUniformTypeOf<T>::Storage value{};
+        if(_type == ShaderUniformTypeOf<T>::type)
+            memcpy(&value, _value, sizeof(value));
+        return (T)value;
+    }
+    // Only marks the uniform dirty if the value actually changed. Returns false if the uniform isn't of the given type
+    template<typename T>
+    bool SetValue(const T &value)
+    {
+        static_assert(ShaderUniformTypeOf<T>::isSupported, "Unsupported shader uniform type");
+        if(_type != ShaderUniformTypeOf<T>::type)
+            return false;
+
+        typename ShaderUniformTypeOf<T>::Storage storedValue = (typename ShaderUniformTypeOf<T>::Storage)value;
+        if(memcmp(_value, &storedValue, sizeof(storedValue)) != 0)
+        {
+            memcpy(_value, &storedValue, sizeof(storedValue));
+            _dirty = true;
+        }
+        return true;
+    }
+
+    // Copies the value of a uniform of the same type, eg. from the previous program of a hot-reloaded shader
+    void TakeValueFrom(const ShaderUniform &other);
+    // Points the uniform at its value in a different arena, used when the arena gets copied
+    inline void RebaseValue(const unsigned char *oldArena, unsigned char *newArena) { _value = newArena + (_value - oldArena); }
+
+    // Amount of bytes the value of a uniform of the given type takes up in the arena
+    static size_t GetValueSize(ShaderUniformType type);
 };
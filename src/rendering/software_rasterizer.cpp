@@ -0,0 +1,570 @@
+#include "software_rasterizer.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SOFTWARE_RASTERIZER_SSE2
+    #include <emmintrin.h>
+#endif
+
+SoftwareRasterizer::SoftwareRasterizer(unsigned int threadCount)
+{
+    if(threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    _threadData.resize(threadCount);
+    for(ThreadData &data: _threadData)
+        data.triangleIDs.resize(TILE_SIZE * TILE_SIZE);
+
+    for(unsigned int thread = 1; thread < threadCount; thread++)
+        _threads.emplace_back(&SoftwareRasterizer::ThreadLoop, this, thread);
+}
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _stopping = true;
+    }
+    _jobStarted.notify_all();
+    for(std::thread &thread: _threads)
+        thread.join();
+}
+
+void SoftwareRasterizer::Resize(const glm::uvec2 &size)
+{
+    if(size == _size)
+        return;
+
+    _size = size;
+    _tileCount = (size + glm::uvec2(TILE_SIZE - 1)) / TILE_SIZE;
+    _color.assign((size_t)_size.x * _size.y * 4, 0);
+    _depth.assign((size_t)_tileCount.x * _tileCount.y * TILE_SIZE * TILE_SIZE, 1.0f);
+    for(ThreadData &data: _threadData)
+    {
+        data.bins.clear();
+        data.bins.resize((size_t)_tileCount.x * _tileCount.y);
+    }
+}
+
+void SoftwareRasterizer::Clear(const glm::vec4 &color)
+{
+    unsigned char clearColor[4];
+    for(int channel = 0; channel < 4; channel++)
+        clearColor[channel] = (unsigned char)(glm::clamp(color[channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+    for(size_t pixel = 0; pixel < _color.size(); pixel += 4)
+        memcpy(_color.data() + pixel, clearColor, 4);
+
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+    _stats = SoftwareRasterizerStats();
+}
+
+void SoftwareRasterizer::SetCamera(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &position)
+{
+    _viewProjection = projection * view;
+    _viewPosition = position;
+}
+
+void SoftwareRasterizer::DrawMesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const glm::mat4 &modelMatrix, const SoftwareMaterial &material)
+{
+    const unsigned int vertexCount = (unsigned int)vertices.size();
+    const unsigned int triangleCount = (unsigned int)(indices.empty() ? vertices.size() : indices.size()) / 3;
+    if(triangleCount == 0 || _size.x == 0 || _size.y == 0)
+        return;
+    _stats.triangles += triangleCount;
+
+    // Vertex phase, same transforms as phong.vs
+    auto phaseStart = std::chrono::high_resolution_clock::now();
+    _vertices.resize(vertexCount);
+    _clipPositions.resize(vertexCount);
+    const glm::mat4 mvp = _viewProjection * modelMatrix;
+    const glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+    std::atomic<unsigned int> nextChunk = 0;
+    RunOnAllThreads([&](unsigned int thread)
+    {
+        for(unsigned int first; (first = nextChunk++ * CHUNK_SIZE) < vertexCount;)
+        {
+            unsigned int last = std::min(first + CHUNK_SIZE, vertexCount);
+            for(unsigned int i = first; i < last; i++)
+            {
+                glm::vec4 position = glm::vec4(vertices[i].position, 1.0f);
+                _clipPositions[i] = mvp * position;
+                _vertices[i] = ToRasterVertex(_clipPositions[i], glm::vec3(modelMatrix * position), normalMatrix * vertices[i].normal);
+            }
+        }
+    });
+    auto binStart = std::chrono::high_resolution_clock::now();
+    _stats.vertexTimeMs += std::chrono::duration<float, std::milli>(binStart - phaseStart).count();
+
+    // Bin phase, every thread fills bins of its own
+    nextChunk = 0;
+    RunOnAllThreads([&](unsigned int thread)
+    {
+        ThreadData &data = _threadData[thread];
+        for(std::vector<BinnedTriangle> &bin: data.bins)
+            bin.clear();
+        data.clippedVertices.clear();
+        data.culledTriangles = data.clippedTriangles = data.binnedTriangles = 0;
+
+        for(unsigned int first; (first = (data.chunk = nextChunk++) * CHUNK_SIZE) < triangleCount;)
+        {
+            unsigned int last = std::min(first + CHUNK_SIZE, triangleCount);
+            for(unsigned int triangle = first; triangle < last; triangle++)
+            {
+                unsigned int i0 = triangle * 3, i1 = triangle * 3 + 1, i2 = triangle * 3 + 2;
+                if(!indices.empty())
+                {
+                    i0 = indices[i0];
+                    i1 = indices[i1];
+                    i2 = indices[i2];
+                }
+                if(i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+                {
+                    data.culledTriangles++;
+                    continue;
+                }
+                ProcessTriangle(data, i0, i1, i2);
+            }
+        }
+    });
+    auto rasterStart = std::chrono::high_resolution_clock::now();
+    _stats.binTimeMs += std::chrono::duration<float, std::milli>(rasterStart - binStart).count();
+    for(const ThreadData &data: _threadData)
+    {
+        _stats.culledTriangles += data.culledTriangles;
+        _stats.clippedTriangles += data.clippedTriangles;
+        _stats.binnedTriangles += data.binnedTriangles;
+    }
+
+    // Raster phase, the threads take one tile at a time so the ones with lots of triangles don't hold up the rest
+    const unsigned int tileCount = _tileCount.x * _tileCount.y;
+    std::atomic<unsigned int> nextTile = 0;
+    RunOnAllThreads([&](unsigned int thread)
+    {
+        for(unsigned int tile; (tile = nextTile++) < tileCount;)
+            RasterizeTile(_threadData[thread], tile, material);
+    });
+    _stats.rasterTimeMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - rasterStart).count();
+}
+
+std::vector<unsigned char> SoftwareRasterizer::ReadPixels() const
+{
+    std::vector<unsigned char> pixels(_color.size());
+    size_t rowSize = (size_t)_size.x * 4;
+    for(size_t y = 0; y < _size.y; y++)
+        memcpy(pixels.data() + y * rowSize, _color.data() + (_size.y - 1 - y) * rowSize, rowSize);
+    return pixels;
+}
+
+#pragma region Threads
+void SoftwareRasterizer::RunOnAllThreads(const std::function<void(unsigned int thread)> &job)
+{
+    {
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        _job = &job;
+        _busyThreads = (unsigned int)_threads.size();
+        _jobGeneration++;
+    }
+    _jobStarted.notify_all();
+
+    job(0);
+
+    std::unique_lock<std::mutex> lock(_jobMutex);
+    _jobFinished.wait(lock, [this]() { return _busyThreads == 0; });
+    _job = nullptr;
+}
+void SoftwareRasterizer::ThreadLoop(unsigned int thread)
+{
+    unsigned long long finishedGeneration = 0;
+    while(true)
+    {
+        const std::function<void(unsigned int)> *job = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_jobMutex);
+            _jobStarted.wait(lock, [&]() { return _stopping || _jobGeneration != finishedGeneration; });
+            if(_stopping)
+                return;
+            finishedGeneration = _jobGeneration;
+            job = _job;
+        }
+
+        (*job)(thread);
+
+        std::lock_guard<std::mutex> lock(_jobMutex);
+        if(--_busyThreads == 0)
+            _jobFinished.notify_one();
+    }
+}
+#pragma endregion
+
+#pragma region Geometry
+SoftwareRasterizer::RasterVertex SoftwareRasterizer::ToRasterVertex(const glm::vec4 &clipPosition, const glm::vec3 &position, const glm::vec3 &normal) const
+{
+    RasterVertex vertex;
+    vertex.position = position;
+    vertex.normal = normal;
+
+    // Vertices behind the camera never reach the screen, triangles using them get clipped first
+    if(clipPosition.w <= 0.0f)
+        return vertex;
+
+    vertex.invW = 1.0f / clipPosition.w;
+    vertex.x = std::round((clipPosition.x * vertex.invW * 0.5f + 0.5f) * (float)_size.x * 16.0f) / 16.0f;
+    vertex.y = std::round((clipPosition.y * vertex.invW * 0.5f + 0.5f) * (float)_size.y * 16.0f) / 16.0f;
+    vertex.z = clipPosition.z * vertex.invW * 0.5f + 0.5f;
+    return vertex;
+}
+
+void SoftwareRasterizer::ProcessTriangle(ThreadData &data, unsigned int i0, unsigned int i1, unsigned int i2)
+{
+    const glm::vec4 &c0 = _clipPositions[i0], &c1 = _clipPositions[i1], &c2 = _clipPositions[i2];
+
+    // Completely outside of one of the frustum planes
+    if((c0.x >  c0.w && c1.x >  c1.w && c2.x >  c2.w) || (c0.x < -c0.w && c1.x < -c1.w && c2.x < -c2.w) ||
+       (c0.y >  c0.w && c1.y >  c1.w && c2.y >  c2.w) || (c0.y < -c0.w && c1.y < -c1.w && c2.y < -c2.w) ||
+       (c0.z >  c0.w && c1.z >  c1.w && c2.z >  c2.w) || (c0.z < -c0.w && c1.z < -c1.w && c2.z < -c2.w))
+    {
+        data.culledTriangles++;
+        return;
+    }
+
+    // Only the near plane needs real clipping, the other planes are taken care of by limiting the triangle's bounds to the screen
+    bool inside0 = c0.z >= -c0.w && c0.w > 0.0f, inside1 = c1.z >= -c1.w && c1.w > 0.0f, inside2 = c2.z >= -c2.w && c2.w > 0.0f;
+    if(inside0 && inside1 && inside2)
+    {
+        BinTriangle(data, &_vertices[i0], &_vertices[i1], &_vertices[i2]);
+        return;
+    }
+
+    struct ClipVertex
+    {
+        glm::vec4 clipPosition;
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+    const ClipVertex input[3] =
+    {
+        { c0, _vertices[i0].position, _vertices[i0].normal },
+        { c1, _vertices[i1].position, _vertices[i1].normal },
+        { c2, _vertices[i2].position, _vertices[i2].normal }
+    };
+    // Cutting a triangle with a plane leaves at most a quad
+    ClipVertex output[4];
+    int outputCount = 0;
+    for(int i = 0; i < 3; i++)
+    {
+        const ClipVertex &current = input[i], &next = input[(i + 1) % 3];
+        float currentDistance = current.clipPosition.z + current.clipPosition.w;
+        float nextDistance = next.clipPosition.z + next.clipPosition.w;
+        if(currentDistance >= 0.0f)
+            output[outputCount++] = current;
+        if((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+        {
+            float t = currentDistance / (currentDistance - nextDistance);
+            output[outputCount++] =
+            {
+                glm::mix(current.clipPosition, next.clipPosition, t),
+                glm::mix(current.position, next.position, t),
+                glm::mix(current.normal, next.normal, t)
+            };
+        }
+    }
+    if(outputCount < 3)
+    {
+        data.culledTriangles++;
+        return;
+    }
+
+    data.clippedTriangles++;
+    const RasterVertex *clipped[4];
+    for(int i = 0; i < outputCount; i++)
+    {
+        data.clippedVertices.push_back(ToRasterVertex(output[i].clipPosition, output[i].position, output[i].normal));
+        clipped[i] = &data.clippedVertices.back();
+    }
+    for(int i = 1; i + 1 < outputCount; i++)
+        BinTriangle(data, clipped[0], clipped[i], clipped[i + 1]);
+}
+
+void SoftwareRasterizer::BinTriangle(ThreadData &data, const RasterVertex *v0, const RasterVertex *v1, const RasterVertex *v2)
+{
+    // Both faces get drawn, clockwise triangles are flipped around so that every triangle's edge functions are positive inside
+    float area = (v1->x - v0->x) * (v2->y - v0->y) - (v1->y - v0->y) * (v2->x - v0->x);
+    if(area < 0.0f)
+        std::swap(v1, v2);
+
+    BinnedTriangle triangle = { { v0, v1, v2 }, data.chunk };
+    TriangleSetup setup;
+    if(!SetupTriangle(triangle, setup))
+    {
+        data.culledTriangles++;
+        return;
+    }
+
+    const int firstTileX = setup.minX / (int)TILE_SIZE, lastTileX = setup.maxX / (int)TILE_SIZE;
+    const int firstTileY = setup.minY / (int)TILE_SIZE, lastTileY = setup.maxY / (int)TILE_SIZE;
+    // Most triangles of dense meshes are smaller than a tile
+    if(firstTileX == lastTileX && firstTileY == lastTileY)
+    {
+        data.bins[firstTileY * _tileCount.x + firstTileX].push_back(triangle);
+        data.binnedTriangles++;
+        return;
+    }
+
+    for(int tileY = firstTileY; tileY <= lastTileY; tileY++)
+    {
+        for(int tileX = firstTileX; tileX <= lastTileX; tileX++)
+        {
+            // Skips the tiles completely outside of one of the edges, which long diagonal triangles have plenty of.
+            // Every edge is tested at the pixel center of the tile that lies furthest towards its inside
+            float left = (float)(tileX * TILE_SIZE) + 0.5f, right = (float)std::min((tileX + 1) * TILE_SIZE, _size.x) - 0.5f;
+            float bottom = (float)(tileY * TILE_SIZE) + 0.5f, top = (float)std::min((tileY + 1) * TILE_SIZE, _size.y) - 0.5f;
+            bool isOutside = false;
+            for(int edge = 0; edge < 3 && !isOutside; edge++)
+            {
+                float x = setup.a[edge] > 0.0f ? right : left;
+                float y = setup.b[edge] > 0.0f ? top : bottom;
+                isOutside = setup.a[edge] * x + setup.b[edge] * y + setup.c[edge] < 0.0f;
+            }
+            if(isOutside)
+                continue;
+
+            data.bins[tileY * _tileCount.x + tileX].push_back(triangle);
+            data.binnedTriangles++;
+        }
+    }
+}
+
+bool SoftwareRasterizer::SetupTriangle(const BinnedTriangle &triangle, TriangleSetup &setup) const
+{
+    const RasterVertex &v0 = *triangle.vertices[0], &v1 = *triangle.vertices[1], &v2 = *triangle.vertices[2];
+
+    // Edge i lies opposite of vertex i, so its function divided by the area is the barycentric weight of that vertex.
+    // The top-left rule decides who gets the pixels whose centers lie exactly on an edge shared by two triangles
+    auto setEdge = [&setup](int edge, const RasterVertex &from, const RasterVertex &to)
+    {
+        setup.a[edge] = from.y - to.y;
+        setup.b[edge] = to.x - from.x;
+        setup.c[edge] = from.x * to.y - from.y * to.x;
+        setup.topLeft[edge] = setup.a[edge] > 0.0f || (setup.a[edge] == 0.0f && setup.b[edge] < 0.0f);
+    };
+    setEdge(0, v1, v2);
+    setEdge(1, v2, v0);
+    setEdge(2, v0, v1);
+
+    float area = setup.a[2] * v2.x + setup.b[2] * v2.y + setup.c[2];
+    // Also catches NaNs
+    if(!(area > 0.0f))
+        return false;
+    setup.inverseArea = 1.0f / area;
+
+    // Depth is linear in screen space, unlike the other attributes
+    setup.zA = (v0.z * setup.a[0] + v1.z * setup.a[1] + v2.z * setup.a[2]) * setup.inverseArea;
+    setup.zB = (v0.z * setup.b[0] + v1.z * setup.b[1] + v2.z * setup.b[2]) * setup.inverseArea;
+    setup.zC = (v0.z * setup.c[0] + v1.z * setup.c[1] + v2.z * setup.c[2]) * setup.inverseArea;
+
+    // Pixels whose centers may lie inside, limited to the screen before converting so that huge coordinates don't overflow
+    float minX = std::max(std::min({ v0.x, v1.x, v2.x }), 0.0f), maxX = std::min(std::max({ v0.x, v1.x, v2.x }), (float)_size.x);
+    float minY = std::max(std::min({ v0.y, v1.y, v2.y }), 0.0f), maxY = std::min(std::max({ v0.y, v1.y, v2.y }), (float)_size.y);
+    setup.minX = (int)std::ceil(minX - 0.5f);
+    setup.maxX = std::min((int)std::floor(maxX - 0.5f), (int)_size.x - 1);
+    setup.minY = (int)std::ceil(minY - 0.5f);
+    setup.maxY = std::min((int)std::floor(maxY - 0.5f), (int)_size.y - 1);
+    return setup.minX <= setup.maxX && setup.minY <= setup.maxY;
+}
+#pragma endregion
+
+#pragma region Rasterization
+void SoftwareRasterizer::RasterizeTile(ThreadData &data, unsigned int tile, const SoftwareMaterial &material)
+{
+    const int tileX = (int)((tile % _tileCount.x) * TILE_SIZE), tileY = (int)((tile / _tileCount.x) * TILE_SIZE);
+    const int tileMaxX = std::min(tileX + (int)TILE_SIZE, (int)_size.x) - 1, tileMaxY = std::min(tileY + (int)TILE_SIZE, (int)_size.y) - 1;
+
+    data.tileTriangles.clear();
+    data.tileSetups.clear();
+    // The chunks a thread claimed only ever go up, so every bin is sorted by chunk already. Taking the chunks from the bins
+    // lowest first gives back the order the triangles were submitted in, which the depth test needs to resolve ties like GL
+    // does, and keeps the image the same no matter which thread binned what
+    std::vector<size_t> &cursors = data.binCursors;
+    cursors.assign(_threadData.size(), 0);
+    while(true)
+    {
+        const std::vector<BinnedTriangle> *nextBin = nullptr;
+        size_t *nextCursor = nullptr;
+        for(size_t thread = 0; thread < _threadData.size(); thread++)
+        {
+            const std::vector<BinnedTriangle> &bin = _threadData[thread].bins[tile];
+            if(cursors[thread] < bin.size() && (nextBin == nullptr || bin[cursors[thread]].chunk < (*nextBin)[*nextCursor].chunk))
+            {
+                nextBin = &bin;
+                nextCursor = &cursors[thread];
+            }
+        }
+        if(nextBin == nullptr)
+            break;
+
+        // A chunk is binned by a single thread, so all of its triangles are in a row
+        const unsigned int chunk = (*nextBin)[*nextCursor].chunk;
+        for(size_t &i = *nextCursor; i < nextBin->size() && (*nextBin)[i].chunk == chunk; i++)
+        {
+            const BinnedTriangle &triangle = (*nextBin)[i];
+            TriangleSetup setup;
+            if(!SetupTriangle(triangle, setup))
+                continue;
+            setup.minX = std::max(setup.minX, tileX);
+            setup.maxX = std::min(setup.maxX, tileMaxX);
+            setup.minY = std::max(setup.minY, tileY);
+            setup.maxY = std::min(setup.maxY, tileMaxY);
+            if(setup.minX > setup.maxX || setup.minY > setup.maxY)
+                continue;
+
+            data.tileTriangles.push_back(&triangle);
+            data.tileSetups.push_back(setup);
+        }
+    }
+    if(data.tileTriangles.empty())
+        return;
+
+    // Visibility first: only the depth is tested and written, and each pixel remembers the triangle that won it
+    float *depth = _depth.data() + (size_t)tile * TILE_SIZE * TILE_SIZE;
+    int *triangleIDs = data.triangleIDs.data();
+    std::fill(triangleIDs, triangleIDs + TILE_SIZE * TILE_SIZE, -1);
+
+    for(int id = 0; id < (int)data.tileSetups.size(); id++)
+    {
+        const TriangleSetup &setup = data.tileSetups[id];
+        // Groups of 4 pixels start at multiples of 4 from the tile's edge, so they're aligned in the depth block and never leave the tile.
+        // Pixels past the right edge of the screen only ever land in the padding of the edge tiles
+        const int firstX = tileX + ((setup.minX - tileX) & ~3);
+
+#ifdef SOFTWARE_RASTERIZER_SSE2
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 a0 = _mm_set1_ps(setup.a[0]), a1 = _mm_set1_ps(setup.a[1]), a2 = _mm_set1_ps(setup.a[2]), zA = _mm_set1_ps(setup.zA);
+        const __m128 topLeft0 = _mm_castsi128_ps(_mm_set1_epi32(setup.topLeft[0] ? -1 : 0));
+        const __m128 topLeft1 = _mm_castsi128_ps(_mm_set1_epi32(setup.topLeft[1] ? -1 : 0));
+        const __m128 topLeft2 = _mm_castsi128_ps(_mm_set1_epi32(setup.topLeft[2] ? -1 : 0));
+        const __m128i idVector = _mm_set1_epi32(id);
+
+        for(int y = setup.minY; y <= setup.maxY; y++)
+        {
+            const float pixelY = (float)y + 0.5f;
+            const __m128 row0 = _mm_set1_ps(setup.b[0] * pixelY + setup.c[0]);
+            const __m128 row1 = _mm_set1_ps(setup.b[1] * pixelY + setup.c[1]);
+            const __m128 row2 = _mm_set1_ps(setup.b[2] * pixelY + setup.c[2]);
+            const __m128 rowZ = _mm_set1_ps(setup.zB * pixelY + setup.zC);
+            float *depthRow = depth + (y - tileY) * TILE_SIZE - tileX;
+            int *idRow = triangleIDs + (y - tileY) * TILE_SIZE - tileX;
+
+            for(int x = firstX; x <= setup.maxX; x += 4)
+            {
+                const __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+                // Each pixel's edge values are computed from its own position rather than stepped from the start of the row,
+                // which keeps them exactly opposite for the two triangles sharing an edge
+                const __m128 edge0 = _mm_add_ps(_mm_mul_ps(a0, pixelX), row0);
+                const __m128 edge1 = _mm_add_ps(_mm_mul_ps(a1, pixelX), row1);
+                const __m128 edge2 = _mm_add_ps(_mm_mul_ps(a2, pixelX), row2);
+                __m128 covered = _mm_or_ps(_mm_cmpgt_ps(edge0, zero), _mm_and_ps(_mm_cmpeq_ps(edge0, zero), topLeft0));
+                covered = _mm_and_ps(covered, _mm_or_ps(_mm_cmpgt_ps(edge1, zero), _mm_and_ps(_mm_cmpeq_ps(edge1, zero), topLeft1)));
+                covered = _mm_and_ps(covered, _mm_or_ps(_mm_cmpgt_ps(edge2, zero), _mm_and_ps(_mm_cmpeq_ps(edge2, zero), topLeft2)));
+                if(_mm_movemask_ps(covered) == 0)
+                    continue;
+
+                const __m128 z = _mm_add_ps(_mm_mul_ps(zA, pixelX), rowZ);
+                const __m128 oldDepth = _mm_load_ps(depthRow + x);
+                const __m128 passed = _mm_and_ps(covered, _mm_cmplt_ps(z, oldDepth));
+                if(_mm_movemask_ps(passed) == 0)
+                    continue;
+
+                _mm_store_ps(depthRow + x, _mm_or_ps(_mm_and_ps(passed, z), _mm_andnot_ps(passed, oldDepth)));
+                const __m128i passedMask = _mm_castps_si128(passed);
+                const __m128i oldIDs = _mm_load_si128((const __m128i*)(idRow + x));
+                _mm_store_si128((__m128i*)(idRow + x), _mm_or_si128(_mm_and_si128(passedMask, idVector), _mm_andnot_si128(passedMask, oldIDs)));
+            }
+        }
+#else
+        for(int y = setup.minY; y <= setup.maxY; y++)
+        {
+            const float pixelY = (float)y + 0.5f;
+            const float row0 = setup.b[0] * pixelY + setup.c[0];
+            const float row1 = setup.b[1] * pixelY + setup.c[1];
+            const float row2 = setup.b[2] * pixelY + setup.c[2];
+            const float rowZ = setup.zB * pixelY + setup.zC;
+            float *depthRow = depth + (y - tileY) * TILE_SIZE - tileX;
+            int *idRow = triangleIDs + (y - tileY) * TILE_SIZE - tileX;
+
+            for(int x = firstX; x <= setup.maxX; x++)
+            {
+                const float pixelX = (float)x + 0.5f;
+                const float edge0 = setup.a[0] * pixelX + row0;
+                const float edge1 = setup.a[1] * pixelX + row1;
+                const float edge2 = setup.a[2] * pixelX + row2;
+                if(!(edge0 > 0.0f || (edge0 == 0.0f && setup.topLeft[0])) ||
+                   !(edge1 > 0.0f || (edge1 == 0.0f && setup.topLeft[1])) ||
+                   !(edge2 > 0.0f || (edge2 == 0.0f && setup.topLeft[2])))
+                    continue;
+
+                const float z = setup.zA * pixelX + rowZ;
+                if(z < depthRow[x])
+                {
+                    depthRow[x] = z;
+                    idRow[x] = id;
+                }
+            }
+        }
+#endif
+    }
+
+    // Then every pixel covered by this mesh gets shaded once, with perspective correct attributes and the lighting of phong.fs
+    const float ambientStrength = 0.1f, specularStrength = 0.5f;
+    for(int y = tileY; y <= tileMaxY; y++)
+    {
+        const int *idRow = triangleIDs + (y - tileY) * TILE_SIZE - tileX;
+        unsigned char *colorRow = _color.data() + (size_t)y * _size.x * 4;
+        for(int x = tileX; x <= tileMaxX; x++)
+        {
+            const int id = idRow[x];
+            if(id < 0)
+                continue;
+
+            const TriangleSetup &setup = data.tileSetups[id];
+            const RasterVertex &v0 = *data.tileTriangles[id]->vertices[0];
+            const RasterVertex &v1 = *data.tileTriangles[id]->vertices[1];
+            const RasterVertex &v2 = *data.tileTriangles[id]->vertices[2];
+
+            const float pixelX = (float)x + 0.5f, pixelY = (float)y + 0.5f;
+            float weight0 = (setup.a[0] * pixelX + setup.b[0] * pixelY + setup.c[0]) * v0.invW;
+            float weight1 = (setup.a[1] * pixelX + setup.b[1] * pixelY + setup.c[1]) * v1.invW;
+            float weight2 = (setup.a[2] * pixelX + setup.b[2] * pixelY + setup.c[2]) * v2.invW;
+            const float weightSum = weight0 + weight1 + weight2;
+            weight0 /= weightSum;
+            weight1 /= weightSum;
+            weight2 /= weightSum;
+
+            const glm::vec3 position = v0.position * weight0 + v1.position * weight1 + v2.position * weight2;
+            glm::vec3 normal = v0.normal * weight0 + v1.normal * weight1 + v2.normal * weight2;
+            const float normalLength = glm::length(normal);
+            normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+            const glm::vec3 lightDir = glm::normalize(material.lightPos - position);
+            const float diffuseImpact = std::max(glm::dot(normal, lightDir), 0.0f);
+            const glm::vec3 viewDir = glm::normalize(_viewPosition - position);
+            const glm::vec3 reflectDir = -lightDir + normal * (2.0f * glm::dot(normal, lightDir));
+            // pow(x, 32) as five squares
+            float spec = std::max(glm::dot(viewDir, reflectDir), 0.0f);
+            spec *= spec; spec *= spec; spec *= spec; spec *= spec; spec *= spec;
+
+            const glm::vec4 lighting = material.lightColor * (ambientStrength + diffuseImpact + spec * specularStrength);
+            const glm::vec4 color = material.color * lighting;
+            unsigned char *pixel = colorRow + (size_t)x * 4;
+            for(int channel = 0; channel < 4; channel++)
+                pixel[channel] = (unsigned char)(glm::clamp(color[channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    }
+}
+#pragma endregion
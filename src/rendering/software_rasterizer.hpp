@@ -0,0 +1,169 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "model.hpp"
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// The values phong.fs reads from its uniforms, the defaults match the ones in lighting.glsl
+struct SoftwareMaterial
+{
+    glm::vec4 color = glm::vec4(1.0f);
+    glm::vec3 lightPos = glm::vec3(1.2f, 1.0f, 2.0f);
+    glm::vec4 lightColor = glm::vec4(1.0f);
+};
+
+// Counters gathered since the last Clear()
+struct SoftwareRasterizerStats
+{
+    unsigned int triangles = 0;
+    // Triangles outside of the view frustum or without any area on screen
+    unsigned int culledTriangles = 0;
+    // Triangles crossing the near plane, cut into one or two smaller ones
+    unsigned int clippedTriangles = 0;
+    // Entries in the tile bins, a triangle covering several tiles is counted once per tile
+    unsigned int binnedTriangles = 0;
+    float vertexTimeMs = 0.0f;
+    float binTimeMs = 0.0f;
+    float rasterTimeMs = 0.0f;
+};
+
+// Renders meshes on the CPU, for machines without a usable GPU.
+// Every mesh goes through three phases that all run on every core: the vertices get transformed, the triangles get clipped,
+// set up and sorted into the screen tiles they touch, and then every tile is rasterized on its own. Within a tile the triangles
+// are first only depth tested (4 pixels at a time with SSE2) while remembering which triangle won each pixel, afterwards
+// every covered pixel is shaded exactly once with the same lighting as phong.fs. Tiles never share pixels, so nothing has to be locked
+class SoftwareRasterizer
+{
+    public:
+    static constexpr unsigned int TILE_SIZE = 64;
+    // Vertices and triangles are handed out to the threads in chunks of this many
+    static constexpr unsigned int CHUNK_SIZE = 4096;
+
+    private:
+    // A vertex after transformation. The screen position is snapped to 1/16 of a pixel like GPUs do,
+    // so the edges shared by two triangles give exactly opposite results and no pixel is drawn twice or skipped
+    struct RasterVertex
+    {
+        float x = 0.0f, y = 0.0f;
+        // Depth in the 0 to 1 range
+        float z = 0.0f;
+        float invW = 0.0f;
+        // World space, for lighting
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 normal = glm::vec3(0.0f);
+    };
+    struct BinnedTriangle
+    {
+        const RasterVertex *vertices[3];
+        // The chunk the triangle was binned in, the tiles merge the threads' bins by it to draw in submission order
+        unsigned int chunk;
+    };
+    // Edge functions of a counterclockwise triangle, positive inside. The depth is a plane over the screen
+    struct TriangleSetup
+    {
+        float a[3], b[3], c[3];
+        bool topLeft[3];
+        float inverseArea;
+        float zA, zB, zC;
+        int minX, minY, maxX, maxY;
+    };
+
+    // Everything a thread writes to on its own
+    struct ThreadData
+    {
+        // One bin per tile
+        std::vector<std::vector<BinnedTriangle>> bins;
+        // Vertices created by near plane clipping, a deque so that the triangles can point at them while it grows
+        std::deque<RasterVertex> clippedVertices;
+        // The chunk being binned
+        unsigned int chunk = 0;
+        // Scratch memory of the tile being rasterized
+        std::vector<const BinnedTriangle*> tileTriangles;
+        std::vector<TriangleSetup> tileSetups;
+        std::vector<int> triangleIDs;
+        // Position in every thread's bin of the tile while merging them
+        std::vector<size_t> binCursors;
+
+        unsigned int culledTriangles = 0;
+        unsigned int clippedTriangles = 0;
+        unsigned int binnedTriangles = 0;
+    };
+
+    glm::uvec2 _size = glm::uvec2(0);
+    glm::uvec2 _tileCount = glm::uvec2(0);
+    // RGBA8, bottom row first like GL framebuffers
+    std::vector<unsigned char> _color;
+    // Stored tile by tile so that a tile's depth is one contiguous block, the edge tiles are padded out to the full tile size
+    std::vector<float> _depth;
+
+    glm::mat4 _viewProjection = glm::mat4(1.0f);
+    glm::vec3 _viewPosition = glm::vec3(0.0f);
+
+    // Vertices of the mesh being drawn
+    std::vector<RasterVertex> _vertices;
+    std::vector<glm::vec4> _clipPositions;
+
+    std::vector<ThreadData> _threadData;
+    // The thread calling DrawMesh() works along as thread 0, these are the others
+    std::vector<std::thread> _threads;
+    std::mutex _jobMutex;
+    std::condition_variable _jobStarted;
+    std::condition_variable _jobFinished;
+    const std::function<void(unsigned int)> *_job = nullptr;
+    unsigned long long _jobGeneration = 0;
+    unsigned int _busyThreads = 0;
+    bool _stopping = false;
+
+    SoftwareRasterizerStats _stats;
+
+    public:
+    // 0 uses one thread per core
+    explicit SoftwareRasterizer(unsigned int threadCount = 0);
+    ~SoftwareRasterizer();
+    SoftwareRasterizer(const SoftwareRasterizer &other) = delete;
+    SoftwareRasterizer &operator=(const SoftwareRasterizer &other) = delete;
+
+    public:
+    // The contents are lost when the size changes
+    void Resize(const glm::uvec2 &size);
+    // Clears the color and depth and resets the stats, call at the start of every frame
+    void Clear(const glm::vec4 &color);
+    void SetCamera(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &position);
+
+    // Draws a triangle list, leaving out the indices draws the vertices in order like Model does.
+    // Both faces of the triangles are drawn, same as the GL path which doesn't cull back faces either
+    void DrawMesh(const std::vector<Vertex> &vertices, const std::vector<unsigned int> &indices, const glm::mat4 &modelMatrix, const SoftwareMaterial &material);
+
+    // Tightly packed RGBA8 rows, top row first like image files expect
+    std::vector<unsigned char> ReadPixels() const;
+
+    // Bottom row first, can be uploaded into a GL texture as it is
+    inline const std::vector<unsigned char> &getPixels() const { return _color; }
+    inline const glm::uvec2 &getSize() const { return _size; }
+    inline unsigned int getThreadCount() const { return (unsigned int)_threadData.size(); }
+    inline const SoftwareRasterizerStats &getStats() const { return _stats; }
+
+    private:
+    // Runs the job on every thread (including the calling one) and returns once all of them are done
+    void RunOnAllThreads(const std::function<void(unsigned int thread)> &job);
+    void ThreadLoop(unsigned int thread);
+
+    RasterVertex ToRasterVertex(const glm::vec4 &clipPosition, const glm::vec3 &position, const glm::vec3 &normal) const;
+    // Culls, clips against the near plane and bins the triangle made of the given vertices of the mesh
+    void ProcessTriangle(ThreadData &data, unsigned int i0, unsigned int i1, unsigned int i2);
+    void BinTriangle(ThreadData &data, const RasterVertex *v0, const RasterVertex *v1, const RasterVertex *v2);
+    // Returns false if the triangle has no area
+    bool SetupTriangle(const BinnedTriangle &triangle, TriangleSetup &setup) const;
+
+    void RasterizeTile(ThreadData &data, unsigned int tile, const SoftwareMaterial &material);
+};
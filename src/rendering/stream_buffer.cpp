@@ -0,0 +1,198 @@
+#include "stream_buffer.hpp"
+
+#include "core/log.hpp"
+
+#include <chrono>
+#include <cstring>
+
+StreamBuffer::StreamBuffer(size_t frameSize, GLADloadproc loader)
+{
+    // glBufferStorage is core since 4.4, older contexts may still have the extension
+    int majorVersion = 0, minorVersion = 0;
+    GL_CALL(glad_glGetIntegerv(GL_MAJOR_VERSION, &majorVersion));
+    GL_CALL(glad_glGetIntegerv(GL_MINOR_VERSION, &minorVersion));
+    bool hasBufferStorage = majorVersion > 4 || (majorVersion == 4 && minorVersion >= 4);
+    if(!hasBufferStorage)
+    {
+        int extensionCount = 0;
+        GL_CALL(glad_glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount));
+        for(int i = 0; i < extensionCount && !hasBufferStorage; i++)
+            hasBufferStorage = strcmp((const char*)glad_glGetStringi(GL_EXTENSIONS, i), "GL_ARB_buffer_storage") == 0;
+    }
+
+    if(hasBufferStorage && loader != nullptr)
+    {
+        _bufferStorage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorage");
+        if(_bufferStorage == nullptr)
+            _bufferStorage = (PFNGLBUFFERSTORAGEPROC)loader("glBufferStorageARB");
+    }
+    _isPersistent = _bufferStorage != nullptr;
+    _stats.persistent = _isPersistent;
+
+    if(_isPersistent)
+        Log::LogInfo("Streaming per-frame data through a persistently mapped buffer");
+    else
+        Log::LogInfo("Buffer storage not available, streaming per-frame data by orphaning");
+
+    Create(frameSize);
+}
+StreamBuffer::~StreamBuffer()
+{
+    Destroy();
+}
+
+void StreamBuffer::BeginFrame(size_t requiredSize)
+{
+    _stats.usedBytes = 0;
+    _head = 0;
+
+    // Growing throws the whole buffer away, so every region must be done being read first
+    if(requiredSize > _frameSize)
+    {
+        for(GLsync &fence: _fences)
+            WaitForFence(fence);
+
+        size_t newSize = requiredSize + requiredSize / 2;
+        Log::LogInfo("Growing the stream buffer to " + std::to_string(newSize / 1024) + " KB per frame");
+        Destroy();
+        Create(newSize);
+        return;
+    }
+
+    if(_isPersistent)
+    {
+        _frame = (_frame + 1) % FRAME_COUNT;
+        WaitForFence(_fences[_frame]);
+    }
+}
+
+StreamAllocation StreamBuffer::Allocate(size_t size, size_t alignment)
+{
+    StreamAllocation allocation;
+
+    // The fallback always writes to the first region, which is the only one it has
+    size_t regionStart = _isPersistent ? _frameSize * _frame : 0;
+    size_t offset = regionStart + _head;
+    if(alignment > 1)
+        offset = ((offset + alignment - 1) / alignment) * alignment;
+
+    if(offset + size > regionStart + _frameSize)
+    {
+        Log::LogError("Stream buffer ran out of space this frame (" + std::to_string(size) + " bytes requested)");
+        return allocation;
+    }
+
+    allocation.data = _mappedData + offset;
+    allocation.offset = offset;
+    _head = offset + size - regionStart;
+    _stats.usedBytes = _head;
+    return allocation;
+}
+
+void StreamBuffer::Commit()
+{
+    // Coherent mappings make the writes visible without doing anything
+    if(_isPersistent || _head == 0)
+        return;
+
+    // Orphaning gives the buffer fresh storage, so the upload never waits for the draws still reading the old one
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, _id));
+    GL_CALL(glad_glBufferData(GL_COPY_WRITE_BUFFER, _frameSize, nullptr, GL_STREAM_DRAW));
+    GL_CALL(glad_glBufferSubData(GL_COPY_WRITE_BUFFER, 0, _head, _staging.data()));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+
+void StreamBuffer::EndFrame()
+{
+    if(!_isPersistent)
+        return;
+
+    if(_fences[_frame] != nullptr)
+    {
+        GL_CALL(glad_glDeleteSync(_fences[_frame]));
+    }
+    GL_CALL(_fences[_frame] = glad_glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void StreamBuffer::Create(size_t frameSize)
+{
+    _frameSize = ((frameSize + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT) * REGION_ALIGNMENT;
+    _stats.frameSize = _frameSize;
+    _frame = 0;
+    _head = 0;
+
+    GL_CALL(glad_glGenBuffers(1, &_id));
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, _id));
+    if(_isPersistent)
+    {
+        // The mapping stays valid while the buffer is being drawn from, for as long as the buffer exists
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GL_CALL(_bufferStorage(GL_COPY_WRITE_BUFFER, _frameSize * FRAME_COUNT, nullptr, flags));
+        GL_CALL(_mappedData = (unsigned char*)glad_glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, _frameSize * FRAME_COUNT, flags));
+    }
+    if(_mappedData == nullptr)
+    {
+        if(_isPersistent)
+        {
+            // Can't go back to glBufferData on immutable storage, so the buffer is made again
+            Log::LogError("Failed persistently mapping the stream buffer, falling back to orphaning");
+            GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+            GL_CALL(glad_glDeleteBuffers(1, &_id));
+            GL_CALL(glad_glGenBuffers(1, &_id));
+            GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, _id));
+            _isPersistent = false;
+            _stats.persistent = false;
+        }
+        GL_CALL(glad_glBufferData(GL_COPY_WRITE_BUFFER, _frameSize, nullptr, GL_STREAM_DRAW));
+        _staging.resize(_frameSize);
+        _mappedData = _staging.data();
+    }
+    GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+}
+void StreamBuffer::Destroy()
+{
+    for(GLsync &fence: _fences)
+    {
+        if(fence != nullptr)
+        {
+            GL_CALL(glad_glDeleteSync(fence));
+        }
+        fence = nullptr;
+    }
+
+    if(_isPersistent && _mappedData != nullptr)
+    {
+        GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, _id));
+        GL_CALL(glad_glUnmapBuffer(GL_COPY_WRITE_BUFFER));
+        GL_CALL(glad_glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    }
+    _mappedData = nullptr;
+    _staging.clear();
+
+    GL_CALL(glad_glDeleteBuffers(1, &_id));
+    _id = 0;
+}
+
+void StreamBuffer::WaitForFence(GLsync &fence)
+{
+    if(fence == nullptr)
+        return;
+
+    // A zero timeout only checks whether the GPU is done, anything else means the CPU caught up with it
+    GLenum result;
+    GL_CALL(result = glad_glClientWaitSync(fence, 0, 0));
+    if(result == GL_TIMEOUT_EXPIRED)
+    {
+        _stats.stalls++;
+        auto stallStart = std::chrono::high_resolution_clock::now();
+        do
+        {
+            // The flush makes sure the fence itself was actually sent to the GPU
+            GL_CALL(result = glad_glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+        } while(result == GL_TIMEOUT_EXPIRED);
+        _stats.stallTimeMs += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - stallStart).count();
+    }
+
+    GL_CALL(glad_glDeleteSync(fence));
+    fence = nullptr;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <vector>
+#include <cstddef>
+
+// ARB_buffer_storage (core since 4.4) isn't part of the generated glad loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+// Memory handed out for the current frame, valid until the next BeginFrame()
+struct StreamAllocation
+{
+    // Where to write the data to, nullptr if the frame ran out of space
+    void *data = nullptr;
+    // Offset from the start of the buffer, used when binding or drawing from the data
+    size_t offset = 0;
+};
+
+struct StreamBufferStats
+{
+    // Frames that had to wait for the GPU to finish reading their part of the buffer
+    unsigned int stalls = 0;
+    float stallTimeMs = 0.0f;
+    // Bytes handed out during the last frame
+    size_t usedBytes = 0;
+    size_t frameSize = 0;
+    bool persistent = false;
+};
+
+// Buffer for data that's written once per frame and thrown away afterwards (per-frame uniforms, instance transforms, draw commands).
+// With buffer storage the buffer stays persistently mapped and is split into FRAME_COUNT regions, the CPU writes into one of them
+// while the GPU still reads from the ones of the earlier frames. A fence at the end of every frame tells when a region can be written again.
+// Without buffer storage the frame's data is staged on the CPU and uploaded by orphaning the buffer on Commit()
+class StreamBuffer
+{
+    public:
+    static constexpr unsigned int FRAME_COUNT = 3;
+
+    private:
+    unsigned int _id = 0;
+    // Size of a single frame's region, a multiple of REGION_ALIGNMENT so every region starts out aligned
+    size_t _frameSize = 0;
+    static constexpr size_t REGION_ALIGNMENT = 4096;
+
+    PFNGLBUFFERSTORAGEPROC _bufferStorage = nullptr;
+    bool _isPersistent = false;
+    // The whole persistently mapped buffer, or the staging memory of the orphaning fallback
+    unsigned char *_mappedData = nullptr;
+    std::vector<unsigned char> _staging;
+
+    std::array<GLsync, FRAME_COUNT> _fences = {};
+    unsigned int _frame = 0;
+    // Next free byte in the current frame's region
+    size_t _head = 0;
+
+    StreamBufferStats _stats;
+
+    public:
+    // The loader is used to get glBufferStorage, which glad doesn't load
+    StreamBuffer(size_t frameSize, GLADloadproc loader);
+    ~StreamBuffer();
+    StreamBuffer(const StreamBuffer &other) = delete;
+    StreamBuffer &operator=(const StreamBuffer &other) = delete;
+
+    public:
+    // Moves on to the next region, waiting for the GPU if it's still reading from it.
+    // The buffer gets recreated if a frame needs more than requiredSize bytes, which changes its ID
+    void BeginFrame(size_t requiredSize);
+    // Hands out size bytes of the current frame's region. The offset is aligned from the start of the buffer
+    StreamAllocation Allocate(size_t size, size_t alignment);
+    // Makes the data written this frame visible to the GPU, must be called before drawing with it
+    void Commit();
+    // Fences the frame's region so it doesn't get written again before the GPU is done with it
+    void EndFrame();
+
+    inline unsigned int getID() const { return _id; }
+    inline const StreamBufferStats &getStats() const { return _stats; }
+
+    private:
+    void Create(size_t frameSize);
+    void Destroy();
+    void WaitForFence(GLsync &fence);
+};
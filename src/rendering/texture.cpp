@@ -1,28 +1,29 @@
 #include "texture.hpp"
 
 #include "core/log.hpp"
+#include "texture_streamer.hpp"
+#include "gl_state_cache.hpp"
 
 #include <glad/glad.h>
 #include <cstring>
+#include <cmath>
+#include <algorithm>
 
-Texture::Texture(): _id(0), _target(0), _imageUnit(0), _size(glm::vec2(0.0f)), _internalFormat(0), _format(0), data(nullptr) {}
-Texture::Texture(int target, glm::uvec2 size, int internalFormat, int format, void* const data, int imageUnit)
-    : _id(0), _target(target), _imageUnit(0), _size(size), _internalFormat(internalFormat), _format(format)
+Texture::Texture(): _id(0), _target(0), _imageUnit(0), _size(glm::vec2(0.0f)), _internalFormat(0), _format(0), data(nullptr),
+    _isStreamed(false), _mipCount(1), _baseLevel(0), _maxLevel(0) {}
+Texture::Texture(int target, glm::uvec2 size, int internalFormat, int format, void* const data, int imageUnit, bool streamed)
+    : _id(0), _target(target), _imageUnit(0), _size(size), _internalFormat(internalFormat), _format(format),
+    _isStreamed(streamed), _mipCount(1), _baseLevel(0), _maxLevel(0)
 {
     this->data = const_cast<void*>(data);
-
-    GL_CALL(glad_glGenTextures(1, &_id));
-    Bind();
-    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
-    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
-    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
-    GL_CALL(glad_glTexImage2D(_target, 0, _internalFormat, _size.x, _size.y, 0, _format, GL_UNSIGNED_BYTE, data));
-    Unbind();
+    CreateGLTexture();
 }
 Texture::~Texture()
 {
+    if(_isStreamed)
+        TextureStreamer::getInstance().Unregister(this);
 
+    GLStateCache::getInstance().ForgetTexture(_id);
     GL_CALL(glad_glDeleteTextures(1, &_id));
 } 
 
@@ -36,6 +37,10 @@ Texture::Texture(const Texture &other)
     this->_size           = other._size;
     this->_internalFormat = other._internalFormat;
     this->_format         = other._format;
+    this->_isStreamed     = other._isStreamed;
+    this->_mipCount       = other._mipCount;
+    this->_baseLevel      = other._baseLevel;
+    this->_maxLevel       = other._maxLevel;
 }
 Texture& Texture::operator=(Texture other)
 {
@@ -46,6 +51,10 @@ Texture& Texture::operator=(Texture other)
     this->_size           = other._size;
     this->_internalFormat = other._internalFormat;
     this->_format         = other._format;
+    this->_isStreamed     = other._isStreamed;
+    this->_mipCount       = other._mipCount;
+    this->_baseLevel      = other._baseLevel;
+    this->_maxLevel       = other._maxLevel;
 
     return *this;
 }
@@ -62,6 +71,10 @@ Texture::Texture(Texture&& other)
     this->_size           = std::move(other._size);
     this->_internalFormat = std::move(other._internalFormat);
     this->_format         = std::move(other._format);
+    this->_isStreamed     = std::move(other._isStreamed);
+    this->_mipCount       = std::move(other._mipCount);
+    this->_baseLevel      = std::move(other._baseLevel);
+    this->_maxLevel       = std::move(other._maxLevel);
 }
 Texture& Texture::operator=(Texture&& other)
 {
@@ -74,15 +87,108 @@ Texture& Texture::operator=(Texture&& other)
     this->_size           = std::move(other._size);
     this->_internalFormat = std::move(other._internalFormat);
     this->_format         = std::move(other._format);
+    this->_isStreamed     = std::move(other._isStreamed);
+    this->_mipCount       = std::move(other._mipCount);
+    this->_baseLevel      = std::move(other._baseLevel);
+    this->_maxLevel       = std::move(other._maxLevel);
     
     return *this;
 }
 
+int Texture::getChannelCount() const
+{
+    switch(_format)
+    {
+        case GL_RED:  return 1;
+        case GL_RG:   return 2;
+        case GL_RGB:  return 3;
+        case GL_RGBA: return 4;
+        default:      return 0;
+    }
+}
+
+void Texture::Respecify(glm::uvec2 size, int internalFormat, int format, void* const data)
+{
+    // The new image can have a different size and format, so rather than patching up the old levels
+    // the GL texture gets recreated. Anything holding a pointer to this texture picks up the new one right away
+    if(_isStreamed)
+        TextureStreamer::getInstance().Unregister(this);
+    GLStateCache::getInstance().ForgetTexture(_id);
+    GL_CALL(glad_glDeleteTextures(1, &_id));
+
+    this->data = const_cast<void*>(data);
+    _size = size;
+    _internalFormat = internalFormat;
+    _format = format;
+    _mipCount = 1;
+    _baseLevel = 0;
+    _maxLevel = 0;
+    CreateGLTexture();
+}
+
+void Texture::CreateGLTexture()
+{
+    GL_CALL(glad_glGenTextures(1, &_id));
+    Bind();
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+    GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+    if(!_isStreamed)
+    {
+        GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+        GL_CALL(glad_glTexImage2D(_target, 0, _internalFormat, _size.x, _size.y, 0, _format, GL_UNSIGNED_BYTE, data));
+    }
+    else
+    {
+        // Nothing gets uploaded here, the TextureStreamer uploads the levels over the next frames
+        // starting with the smallest ones. Until then, the texture has an empty resident range
+        _mipCount = (int)std::floor(std::log2((float)std::max(_size.x, _size.y))) + 1;
+        _baseLevel = _mipCount;
+        _maxLevel = _mipCount - 1;
+        GL_CALL(glad_glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR));
+    }
+    Unbind();
+
+    if(_isStreamed)
+        TextureStreamer::getInstance().Register(this);
+}
+
 void Texture::Bind() const
 {
-    GL_CALL(glad_glBindTexture(_target, _id));
+    GLStateCache::getInstance().BindTexture(_target, _id);
+}
+void Texture::BindToUnit(unsigned int unit) const
+{
+    GLStateCache::getInstance().BindTextureToUnit(unit, _target, _id);
 }
 void Texture::Unbind() const
 {
-    GL_CALL(glad_glBindTexture(_target, 0));
+    GLStateCache::getInstance().BindTexture(_target, 0);
+}
+
+glm::uvec2 Texture::getMipLevelSize(int level) const
+{
+    return glm::uvec2(std::max(1u, _size.x >> level), std::max(1u, _size.y >> level));
+}
+
+void Texture::UploadMipLevel(int level, const void* const pixels)
+{
+    glm::uvec2 levelSize = getMipLevelSize(level);
+    // Rows of the smaller levels of RGB textures aren't 4-byte aligned
+    GL_CALL(glad_glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+    GL_CALL(glad_glTexImage2D(_target, level, _internalFormat, levelSize.x, levelSize.y, 0, _format, GL_UNSIGNED_BYTE, pixels));
+    GL_CALL(glad_glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+}
+void Texture::ReleaseMipLevel(int level)
+{
+    // Respecifying a level with a size of 0 lets the driver free its storage
+    GL_CALL(glad_glTexImage2D(_target, level, _internalFormat, 0, 0, 0, _format, GL_UNSIGNED_BYTE, nullptr));
+}
+void Texture::SetResidentMipRange(int baseLevel, int maxLevel)
+{
+    _baseLevel = baseLevel;
+    _maxLevel = maxLevel;
+    // The texture stays complete as long as every level between the base and max level is specified
+    GL_CALL(glad_glTexParameteri(_target, GL_TEXTURE_BASE_LEVEL, std::min(_baseLevel, _maxLevel)));
+    GL_CALL(glad_glTexParameteri(_target, GL_TEXTURE_MAX_LEVEL, _maxLevel));
 }
\ No newline at end of file
@@ -14,11 +14,19 @@ class Texture final
     glm::uvec2 _size;
     int _internalFormat;
     int _format;
+
+    // Mip streaming
+    // Streamed textures start out with no levels in VRAM and get their mips uploaded by the TextureStreamer.
+    // Only the levels between the base and max level are resident
+    bool _isStreamed;
+    int _mipCount;
+    int _baseLevel;
+    int _maxLevel;
     
     public:
     // TODO: Adjustable tex params
     Texture();
-    Texture(int target, glm::uvec2 size, int internalFormat, int format, void* const data = nullptr, int imageUnit = 0);
+    Texture(int target, glm::uvec2 size, int internalFormat, int format, void* const data = nullptr, int imageUnit = 0, bool streamed = false);
     ~Texture();
     // Copy
     Texture(const Texture &other);
@@ -34,9 +42,34 @@ class Texture final
     inline const glm::uvec2   &getSize()             const { return _size; }
     inline const int          &getInternalFormat()   const { return _internalFormat; }
     inline const int          &getFormat()           const { return _format; }
+    // Returns the amount of color channels per pixel based on the pixel format
+    int getChannelCount() const;
+    inline bool               isStreamed()           const { return _isStreamed; }
+    inline int                getMipCount()          const { return _mipCount; }
+    inline int                getBaseLevel()         const { return _baseLevel; }
+    // A streamed texture can only be sampled once at least one of its levels has been uploaded
+    inline bool               isResident()           const { return !_isStreamed || _baseLevel <= _maxLevel; }
 
     inline void               setTextureImageUnit(int imageUnit) { _imageUnit = imageUnit; }
 
+    // Binds to the active texture unit
     void Bind() const;
+    void BindToUnit(unsigned int unit) const;
     void Unbind() const;
+
+    // Uploads the pixels of a single mip level. The texture must be bound
+    void UploadMipLevel(int level, const void* const pixels);
+    // Frees the VRAM used by a single mip level. The texture must be bound
+    void ReleaseMipLevel(int level);
+    // Clamps sampling to the given range of levels using GL_TEXTURE_BASE_LEVEL and GL_TEXTURE_MAX_LEVEL
+    void SetResidentMipRange(int baseLevel, int maxLevel);
+
+    // Returns the size of the given mip level in pixels
+    glm::uvec2 getMipLevelSize(int level) const;
+
+    // Replaces the image of the texture, eg. after its file changed on disk. Streamed textures start streaming again from the smallest level
+    void Respecify(glm::uvec2 size, int internalFormat, int format, void* const data);
+
+    private:
+    void CreateGLTexture();
 };
\ No newline at end of file
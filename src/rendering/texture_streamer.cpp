@@ -0,0 +1,286 @@
+#include "texture_streamer.hpp"
+
+#include "core/log.hpp"
+#include "core/cpu_profiler.hpp"
+
+#include <algorithm>
+
+// How many frames a texture may go without being drawn before it gets streamed back down to its smallest level
+static constexpr unsigned long long UNUSED_TEXTURE_FRAMES = 120;
+
+void TextureStreamer::Init()
+{
+    _worker = std::thread(&TextureStreamer::WorkerLoop, this);
+}
+void TextureStreamer::DeInit()
+{
+    _jobs.Close();
+    if(_worker.joinable())
+        _worker.join();
+}
+
+void TextureStreamer::Register(Texture *texture)
+{
+    if(texture == nullptr || texture->data == nullptr)
+        return;
+
+    StreamedTexture entry;
+    entry.texture = texture;
+    entry.requestedLevel = texture->getMipCount() - 1;
+    entry.generation = _nextGeneration++;
+    _textures[texture] = std::move(entry);
+
+    MipChainJob job;
+    job.texture = texture;
+    job.size = texture->getSize();
+    job.channels = texture->getChannelCount();
+    job.mipCount = texture->getMipCount();
+    job.pixels = (const unsigned char*)texture->data;
+    job.generation = _textures[texture].generation;
+    _jobs.Push(std::move(job));
+}
+void TextureStreamer::Unregister(Texture *texture)
+{
+    auto it = _textures.find(texture);
+    if(it != _textures.end())
+    {
+        _stats.residentBytes -= it->second.residentBytes;
+        _textures.erase(it);
+    }
+}
+
+void TextureStreamer::RequestMipLevel(const Texture *texture, int level)
+{
+    auto it = _textures.find(texture);
+    if(it == _textures.end())
+        return;
+
+    StreamedTexture &entry = it->second;
+    level = std::clamp(level, 0, texture->getMipCount() - 1);
+    if(entry.lastRequestFrame != _frame)
+        entry.requestedLevel = level;
+    else
+        entry.requestedLevel = std::min(entry.requestedLevel, level);
+    entry.lastRequestFrame = _frame;
+}
+
+void TextureStreamer::Update()
+{
+    PROFILE_ZONE("TextureStreamer::Update");
+    size_t uploadedBytes = 0;
+
+    // Take the mip chains the worker thread finished building
+    // and upload the small levels right away so the texture can be drawn as soon as possible
+    std::vector<MipChainResult> finishedJobs;
+    {
+        std::lock_guard<std::mutex> lock(_finishedJobsMutex);
+        finishedJobs.swap(_finishedJobs);
+    }
+    for(MipChainResult &result: finishedJobs)
+    {
+        auto it = _textures.find(result.texture);
+        // The texture might have been deleted or respecified while its mips were being built
+        if(it == _textures.end() || it->second.generation != result.generation)
+            continue;
+
+        StreamedTexture &entry = it->second;
+        Texture &tex = *entry.texture;
+        entry.mips = std::move(result.mips);
+        entry.ready = true;
+
+        tex.Bind();
+        int coarsestLevel = tex.getMipCount() - 1;
+        int baseLevel = coarsestLevel;
+        UploadLevel(entry, coarsestLevel);
+        uploadedBytes += GetMipLevelBytes(tex, coarsestLevel);
+        while(baseLevel > 0)
+        {
+            glm::uvec2 nextLevelSize = tex.getMipLevelSize(baseLevel - 1);
+            if(nextLevelSize.x > settings.initialResidentSize || nextLevelSize.y > settings.initialResidentSize)
+                break;
+
+            baseLevel--;
+            UploadLevel(entry, baseLevel);
+            uploadedBytes += GetMipLevelBytes(tex, baseLevel);
+        }
+        tex.SetResidentMipRange(baseLevel, coarsestLevel);
+        tex.Unbind();
+    }
+
+    // Work out which level every texture should have resident based on what the renderer asked for
+    std::vector<std::pair<StreamedTexture*, int>> texturesToRaise;
+    unsigned int pendingTextures = 0;
+    for(auto &it: _textures)
+    {
+        StreamedTexture &entry = it.second;
+        if(!entry.ready)
+        {
+            pendingTextures++;
+            continue;
+        }
+
+        Texture &tex = *entry.texture;
+        int coarsestLevel = tex.getMipCount() - 1;
+        bool recentlyUsed = _frame - entry.lastRequestFrame < UNUSED_TEXTURE_FRAMES;
+        int targetLevel = recentlyUsed ? entry.requestedLevel : coarsestLevel;
+
+        // Free the levels that are more detailed than the texture currently needs
+        if(tex.getBaseLevel() < targetLevel)
+        {
+            tex.Bind();
+            int baseLevel = tex.getBaseLevel();
+            while(baseLevel < targetLevel)
+            {
+                ReleaseLevel(entry, baseLevel);
+                baseLevel++;
+            }
+            tex.SetResidentMipRange(baseLevel, coarsestLevel);
+            tex.Unbind();
+        }
+        else if(tex.getBaseLevel() > targetLevel)
+        {
+            texturesToRaise.push_back(std::make_pair(&entry, targetLevel));
+        }
+    }
+
+    // Upload the missing levels, starting with the textures that are the furthest away from the level they need
+    std::sort(texturesToRaise.begin(), texturesToRaise.end(), [](const auto &a, const auto &b)
+    {
+        return (a.first->texture->getBaseLevel() - a.second) > (b.first->texture->getBaseLevel() - b.second);
+    });
+    for(auto &toRaise: texturesToRaise)
+    {
+        StreamedTexture &entry = *toRaise.first;
+        Texture &tex = *entry.texture;
+        int baseLevel = tex.getBaseLevel();
+
+        tex.Bind();
+        while(baseLevel > toRaise.second)
+        {
+            size_t levelBytes = GetMipLevelBytes(tex, baseLevel - 1);
+            if(_stats.residentBytes + levelBytes > settings.vramBudget)
+                break;
+            if(uploadedBytes > 0 && uploadedBytes + levelBytes > settings.uploadBudgetPerFrame)
+                break;
+
+            baseLevel--;
+            UploadLevel(entry, baseLevel);
+            uploadedBytes += levelBytes;
+        }
+        if(baseLevel != tex.getBaseLevel())
+            tex.SetResidentMipRange(baseLevel, tex.getMipCount() - 1);
+        tex.Unbind();
+
+        if(uploadedBytes >= settings.uploadBudgetPerFrame)
+            break;
+    }
+
+    // In case the budget got lowered, drop the finest levels of the largest textures until everything fits again
+    while(_stats.residentBytes > settings.vramBudget)
+    {
+        StreamedTexture *largest = nullptr;
+        for(auto &it: _textures)
+        {
+            StreamedTexture &entry = it.second;
+            if(entry.ready && entry.texture->getBaseLevel() < entry.texture->getMipCount() - 1 && (largest == nullptr || entry.residentBytes > largest->residentBytes))
+                largest = &entry;
+        }
+        if(largest == nullptr)
+            break;
+
+        Texture &tex = *largest->texture;
+        tex.Bind();
+        ReleaseLevel(*largest, tex.getBaseLevel());
+        tex.SetResidentMipRange(tex.getBaseLevel() + 1, tex.getMipCount() - 1);
+        tex.Unbind();
+    }
+
+    _stats.streamedTextures = _textures.size();
+    _stats.pendingTextures = pendingTextures;
+    _stats.uploadedBytesLastFrame = uploadedBytes;
+    _frame++;
+}
+
+void TextureStreamer::WorkerLoop()
+{
+    CPUProfiler::getInstance().SetThreadName("Texture streamer");
+
+    MipChainJob job;
+    while(_jobs.Pop(job))
+    {
+        MipChainResult result;
+        result.texture = job.texture;
+        result.generation = job.generation;
+        result.mips = BuildMipChain(job);
+
+        std::lock_guard<std::mutex> lock(_finishedJobsMutex);
+        _finishedJobs.push_back(std::move(result));
+    }
+}
+
+// Builds every level of the mip chain except for level 0 using a 2x2 box filter.
+// Level 0 is left empty because its pixels are the texture's own data
+std::vector<std::vector<unsigned char>> TextureStreamer::BuildMipChain(const MipChainJob &job)
+{
+    PROFILE_ZONE("TextureStreamer::BuildMipChain");
+    std::vector<std::vector<unsigned char>> mips(job.mipCount);
+    const int channels = job.channels;
+
+    for(int level = 1; level < job.mipCount; level++)
+    {
+        const unsigned char *src = level == 1 ? job.pixels : mips[level - 1].data();
+        unsigned int srcWidth = std::max(1u, job.size.x >> (level - 1));
+        unsigned int srcHeight = std::max(1u, job.size.y >> (level - 1));
+        unsigned int dstWidth = std::max(1u, job.size.x >> level);
+        unsigned int dstHeight = std::max(1u, job.size.y >> level);
+
+        std::vector<unsigned char> &dst = mips[level];
+        dst.resize((size_t)dstWidth * dstHeight * channels);
+
+        for(unsigned int y = 0; y < dstHeight; y++)
+        {
+            // Clamp the sampled rows and columns so odd sizes don't read past the edge of the image
+            unsigned int y0 = std::min(2 * y, srcHeight - 1);
+            unsigned int y1 = std::min(2 * y + 1, srcHeight - 1);
+            for(unsigned int x = 0; x < dstWidth; x++)
+            {
+                unsigned int x0 = std::min(2 * x, srcWidth - 1);
+                unsigned int x1 = std::min(2 * x + 1, srcWidth - 1);
+                for(int c = 0; c < channels; c++)
+                {
+                    unsigned int sum = src[((size_t)y0 * srcWidth + x0) * channels + c]
+                                     + src[((size_t)y0 * srcWidth + x1) * channels + c]
+                                     + src[((size_t)y1 * srcWidth + x0) * channels + c]
+                                     + src[((size_t)y1 * srcWidth + x1) * channels + c];
+                    dst[((size_t)y * dstWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+    }
+
+    return mips;
+}
+
+size_t TextureStreamer::GetMipLevelBytes(const Texture &texture, int level)
+{
+    glm::uvec2 levelSize = texture.getMipLevelSize(level);
+    return (size_t)levelSize.x * levelSize.y * texture.getChannelCount();
+}
+
+void TextureStreamer::UploadLevel(StreamedTexture &entry, int level)
+{
+    const void *pixels = level == 0 ? entry.texture->data : (const void*)entry.mips[level].data();
+    entry.texture->UploadMipLevel(level, pixels);
+
+    size_t levelBytes = GetMipLevelBytes(*entry.texture, level);
+    entry.residentBytes += levelBytes;
+    _stats.residentBytes += levelBytes;
+}
+void TextureStreamer::ReleaseLevel(StreamedTexture &entry, int level)
+{
+    entry.texture->ReleaseMipLevel(level);
+
+    size_t levelBytes = GetMipLevelBytes(*entry.texture, level);
+    entry.residentBytes -= levelBytes;
+    _stats.residentBytes -= levelBytes;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "misc/singleton.hpp"
+#include "misc/concurrent_queue.hpp"
+#include "texture.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+
+struct TextureStreamerSettings
+{
+    // Only applies to textures loaded after the setting was changed
+    bool enabled = true;
+    // Upper bound of how much VRAM all streamed textures may use together
+    size_t vramBudget = 256 * 1024 * 1024;
+    // How many bytes of mip data may get uploaded during a single frame
+    size_t uploadBudgetPerFrame = 8 * 1024 * 1024;
+    // Levels with both dimensions at or below this size are uploaded as soon as they're ready
+    // so that the texture can be drawn right away
+    unsigned int initialResidentSize = 64;
+};
+
+struct TextureStreamerStats
+{
+    unsigned int streamedTextures = 0;
+    unsigned int pendingTextures = 0;
+    size_t residentBytes = 0;
+    size_t uploadedBytesLastFrame = 0;
+};
+
+// Streams the mip levels of textures in and out of VRAM depending on how large they appear on screen.
+// A background thread builds the mip chain on the CPU, the GL thread then uploads only the levels
+// the renderer asked for, within the VRAM and per-frame upload budgets.
+class TextureStreamer final : public Singleton<TextureStreamer>
+{
+    friend class Singleton<TextureStreamer>;
+
+    public:
+    TextureStreamerSettings settings;
+
+    private:
+    struct StreamedTexture
+    {
+        Texture *texture = nullptr;
+        std::vector<std::vector<unsigned char>> mips;
+        bool ready = false;
+        // The finest level the renderer asked for, lower is more detailed
+        int requestedLevel = 0;
+        unsigned long long lastRequestFrame = 0;
+        size_t residentBytes = 0;
+        // Increases every time a texture gets registered, so that a mip chain built
+        // for the previous image of a respecified texture doesn't get uploaded
+        unsigned long long generation = 0;
+    };
+    struct MipChainJob
+    {
+        Texture *texture = nullptr;
+        glm::uvec2 size;
+        int channels = 0;
+        int mipCount = 0;
+        const unsigned char *pixels = nullptr;
+        unsigned long long generation = 0;
+    };
+    struct MipChainResult
+    {
+        Texture *texture = nullptr;
+        std::vector<std::vector<unsigned char>> mips;
+        unsigned long long generation = 0;
+    };
+
+    std::unordered_map<const Texture*, StreamedTexture> _textures;
+    ConcurrentQueue<MipChainJob> _jobs;
+    std::vector<MipChainResult> _finishedJobs;
+    std::mutex _finishedJobsMutex;
+    std::thread _worker;
+
+    unsigned long long _frame = 0;
+    unsigned long long _nextGeneration = 1;
+    TextureStreamerStats _stats;
+
+    private:
+    TextureStreamer() = default;
+    ~TextureStreamer() = default;
+
+    public:
+    void Init();
+    void DeInit();
+
+    void Register(Texture *texture);
+    void Unregister(Texture *texture);
+
+    // Lets the streamer know which mip level the texture needs this frame. Can be called multiple times per frame,
+    // the most detailed request wins
+    void RequestMipLevel(const Texture *texture, int level);
+    // Uploads and frees mip levels, must be called once per frame on the GL thread
+    void Update();
+
+    inline const TextureStreamerStats &getStats() const { return _stats; }
+
+    private:
+    void WorkerLoop();
+    static std::vector<std::vector<unsigned char>> BuildMipChain(const MipChainJob &job);
+    static size_t GetMipLevelBytes(const Texture &texture, int level);
+
+    void UploadLevel(StreamedTexture &entry, int level);
+    void ReleaseLevel(StreamedTexture &entry, int level);
+};